@@ -84,6 +84,10 @@
 #ifdef HAVE_AER
 #include <linux/aer.h>
 #endif
+#ifdef _HAS_XDP_INIT_BUFF
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
+#endif
 
 #if (LINUX_VERSION_CODE >= 0x020610)
 #define BCM_CNIC 1
@@ -448,20 +452,20 @@ bnx2_reg_rd_ind(struct bnx2 *bp, u32 offset)
 {
 	u32 val;
 
-	spin_lock_bh(&bp->indirect_lock);
+	spin_lock_bh(&bp->reg_win_lock);
 	BNX2_WR(bp, BNX2_PCICFG_REG_WINDOW_ADDRESS, offset);
 	val = BNX2_RD(bp, BNX2_PCICFG_REG_WINDOW);
-	spin_unlock_bh(&bp->indirect_lock);
+	spin_unlock_bh(&bp->reg_win_lock);
 	return val;
 }
 
 static void
 bnx2_reg_wr_ind(struct bnx2 *bp, u32 offset, u32 val)
 {
-	spin_lock_bh(&bp->indirect_lock);
+	spin_lock_bh(&bp->reg_win_lock);
 	BNX2_WR(bp, BNX2_PCICFG_REG_WINDOW_ADDRESS, offset);
 	BNX2_WR(bp, BNX2_PCICFG_REG_WINDOW, val);
-	spin_unlock_bh(&bp->indirect_lock);
+	spin_unlock_bh(&bp->reg_win_lock);
 }
 
 #if defined(__VMKLNX__)
@@ -470,10 +474,10 @@ bnx2_reg_wr_ind_cfg(struct bnx2 *bp, u32 offset, u32 val)
 {
 	struct pci_dev *pdev = bp->pdev;
 
-	spin_lock_bh(&bp->indirect_lock);
+	spin_lock_bh(&bp->reg_win_lock);
 	pci_write_config_dword(pdev, BNX2_PCICFG_REG_WINDOW_ADDRESS, offset);
 	pci_write_config_dword(pdev, BNX2_PCICFG_REG_WINDOW, val);
-	spin_unlock_bh(&bp->indirect_lock);
+	spin_unlock_bh(&bp->reg_win_lock);
 }
 #endif /* defined(__VMKLNX__) */
 
@@ -493,7 +497,7 @@ static void
 bnx2_ctx_wr(struct bnx2 *bp, u32 cid_addr, u32 offset, u32 val)
 {
 	offset += cid_addr;
-	spin_lock_bh(&bp->indirect_lock);
+	spin_lock_bh(&bp->ctx_lock);
 	if (BNX2_CHIP(bp) == BNX2_CHIP_5709) {
 		int i;
 
@@ -510,7 +514,7 @@ bnx2_ctx_wr(struct bnx2 *bp, u32 cid_addr, u32 offset, u32 val)
 		BNX2_WR(bp, BNX2_CTX_DATA_ADR, offset);
 		BNX2_WR(bp, BNX2_CTX_DATA, val);
 	}
-	spin_unlock_bh(&bp->indirect_lock);
+	spin_unlock_bh(&bp->ctx_lock);
 }
 
 #ifdef BCM_CNIC
@@ -962,11 +966,33 @@ bnx2_netif_stop(struct bnx2 *bp, bool stop_cnic)
 
 #else
 
+#ifdef BNX2_XDP
+static void
+bnx2_xdp_tx_start(struct bnx2 *bp)
+{
+	if (bp->num_xdp_tx_rings)
+		WRITE_ONCE(bp->xdp_tx_ready, 1);
+}
+
+/* Wait out any ndo_xdp_xmit() still queueing on the XDP tx ring */
+static void
+bnx2_xdp_tx_stop(struct bnx2 *bp)
+{
+	if (bp->xdp_tx_ready) {
+		WRITE_ONCE(bp->xdp_tx_ready, 0);
+		synchronize_net();
+	}
+}
+#endif
+
 static void
 bnx2_netif_stop(struct bnx2 *bp, bool stop_cnic)
 {
 	if (stop_cnic)
 		bnx2_cnic_stop(bp);
+#ifdef BNX2_XDP
+	bnx2_xdp_tx_stop(bp);
+#endif
 	if (netif_running(bp->dev)) {
 		bnx2_napi_disable(bp);
 		bnx2_disable_int_sync(bp);
@@ -982,6 +1008,9 @@ bnx2_netif_start(struct bnx2 *bp, bool start_cnic)
 {
 	if (atomic_dec_and_test(&bp->intr_sem)) {
 		if (netif_running(bp->dev)) {
+#ifdef BNX2_XDP
+			bnx2_xdp_tx_start(bp);
+#endif
 			netif_tx_wake_all_queues(bp->dev);
 			spin_lock_bh(&bp->phy_lock);
 			if (bp->link_up)
@@ -1067,6 +1096,13 @@ bnx2_free_rx_mem(struct bnx2 *bp)
 		}
 		vfree(rxr->rx_pg_ring);
 		rxr->rx_pg_ring = NULL;
+		vfree(rxr->rx_pg_cache);
+		rxr->rx_pg_cache = NULL;
+
+#ifdef BNX2_XDP
+		if (xdp_rxq_info_is_reg(&rxr->xdp_rxq))
+			xdp_rxq_info_unreg(&rxr->xdp_rxq);
+#endif
 	}
 }
 
@@ -1140,6 +1176,16 @@ bnx2_alloc_rx_mem(struct bnx2 *bp)
 
 			memset(rxr->rx_pg_ring, 0, SW_RXPG_RING_SIZE *
 			       bp->rx_max_pg_ring);
+
+			rxr->rx_pg_cache = vmalloc(sizeof(struct bnx2_sw_pg) *
+						   BNX2_RX_PG_CACHE_SIZE);
+			if (rxr->rx_pg_cache == NULL)
+				return -ENOMEM;
+
+			memset(rxr->rx_pg_cache, 0, sizeof(struct bnx2_sw_pg) *
+			       BNX2_RX_PG_CACHE_SIZE);
+			rxr->rx_pg_cache_head = 0;
+			rxr->rx_pg_cache_tail = 0;
 		}
 
 		for (j = 0; j < bp->rx_max_pg_ring; j++) {
@@ -1157,6 +1203,16 @@ bnx2_alloc_rx_mem(struct bnx2 *bp)
 				return -ENOMEM;
 
 		}
+
+#ifdef BNX2_XDP
+		if (xdp_rxq_info_reg(&rxr->xdp_rxq, bp->dev, i,
+				     bnapi->napi.napi_id) < 0)
+			return -ENOMEM;
+
+		if (xdp_rxq_info_reg_mem_model(&rxr->xdp_rxq,
+					       MEM_TYPE_PAGE_SHARED, NULL) < 0)
+			return -ENOMEM;
+#endif
 	}
 	return 0;
 }
@@ -2327,12 +2383,12 @@ bnx2_send_heart_beat(struct bnx2 *bp)
 	u32 msg;
 	u32 addr;
 
-	spin_lock(&bp->indirect_lock);
+	spin_lock(&bp->reg_win_lock);
 	msg = (u32) (++bp->fw_drv_pulse_wr_seq & BNX2_DRV_PULSE_SEQ_MASK);
 	addr = bp->shmem_base + BNX2_DRV_PULSE_MB;
 	BNX2_WR(bp, BNX2_PCICFG_REG_WINDOW_ADDRESS, addr);
 	BNX2_WR(bp, BNX2_PCICFG_REG_WINDOW, msg);
-	spin_unlock(&bp->indirect_lock);
+	spin_unlock(&bp->reg_win_lock);
 }
 
 static void
@@ -2422,11 +2478,11 @@ bnx2_set_remote_link(struct bnx2 *bp)
 {
 	u32 evt_code;
 
-	spin_lock(&bp->indirect_lock);
+	spin_lock(&bp->reg_win_lock);
 	BNX2_WR(bp, BNX2_PCICFG_REG_WINDOW_ADDRESS,
 		bp->shmem_base + BNX2_FW_EVT_CODE_MB);
 	evt_code = BNX2_RD(bp, BNX2_PCICFG_REG_WINDOW);
-	spin_unlock(&bp->indirect_lock);
+	spin_unlock(&bp->reg_win_lock);
 	switch (evt_code) {
 		case BNX2_FW_EVT_CODE_LINK_EVENT:
 			bnx2_remote_phy_event(bp);
@@ -3091,6 +3147,112 @@ bnx2_set_mac_addr(struct bnx2 *bp, u8 *mac_addr, u32 pos)
 	BNX2_WR(bp, BNX2_EMAC_MAC_MATCH1 + (pos * 8), val);
 }
 
+static inline void
+bnx2_rx_alloc_fail(struct bnx2_rx_ring_info *rxr)
+{
+	u64_stats_update_begin(&rxr->rx_syncp);
+	rxr->rx_buf_alloc_fail++;
+	u64_stats_update_end(&rxr->rx_syncp);
+}
+
+/* Unmap and release the oldest page of the recycle cache. */
+static void
+bnx2_rx_pg_cache_evict(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr)
+{
+	struct bnx2_sw_pg *pg;
+
+	pg = &rxr->rx_pg_cache[rxr->rx_pg_cache_head & BNX2_RX_PG_CACHE_MASK];
+	rxr->rx_pg_cache_head++;
+#if (LINUX_VERSION_CODE >= 0x02061b)
+	dma_unmap_page(&bp->pdev->dev, dma_unmap_addr(pg, mapping),
+		       PAGE_SIZE, PCI_DMA_FROMDEVICE);
+#else
+	pci_unmap_page(bp->pdev, dma_unmap_addr(pg, mapping),
+		       PAGE_SIZE, PCI_DMA_FROMDEVICE);
+#endif
+	put_page(pg->page);
+	pg->page = NULL;
+}
+
+/* Take the oldest page from the recycle cache if the stack is done with
+ * it.  A page that is still in use stays at the head, and the caller
+ * allocates a new page; it is only released by bnx2_rx_pg_cache_put()
+ * once the cache is full.
+ */
+static struct page *
+bnx2_rx_pg_cache_get(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr,
+		     dma_addr_t *mapping)
+{
+	struct bnx2_sw_pg *pg;
+	struct page *page;
+
+	if (rxr->rx_pg_cache_head == rxr->rx_pg_cache_tail)
+		return NULL;
+
+	pg = &rxr->rx_pg_cache[rxr->rx_pg_cache_head & BNX2_RX_PG_CACHE_MASK];
+	page = pg->page;
+	if (page_count(page) != 1)
+		return NULL;
+
+	rxr->rx_pg_cache_head++;
+	pg->page = NULL;
+	*mapping = dma_unmap_addr(pg, mapping);
+
+#if (LINUX_VERSION_CODE >= 0x02061b)
+	dma_sync_single_for_device(&bp->pdev->dev, *mapping, PAGE_SIZE,
+				   PCI_DMA_FROMDEVICE);
+#else
+	pci_dma_sync_single_for_device(bp->pdev, *mapping, PAGE_SIZE,
+				       PCI_DMA_FROMDEVICE);
+#endif
+	return page;
+}
+
+/* The page has been attached to an skb.  Keep it mapped, with an extra
+ * reference, so it can go back on the ring once the skb is freed.  When
+ * the cache is full its oldest page, which the stack has held the
+ * longest, is released to make room.  Returns 0 if there is no cache and
+ * the caller must unmap the page.
+ */
+static int
+bnx2_rx_pg_cache_put(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr,
+		     struct page *page, dma_addr_t mapping, unsigned int len)
+{
+	struct bnx2_sw_pg *pg;
+
+	if (!rxr->rx_pg_cache)
+		return 0;
+
+	if ((u16) (rxr->rx_pg_cache_tail - rxr->rx_pg_cache_head) >=
+	    BNX2_RX_PG_CACHE_SIZE)
+		bnx2_rx_pg_cache_evict(bp, rxr);
+
+#if (LINUX_VERSION_CODE >= 0x02061b)
+	dma_sync_single_for_cpu(&bp->pdev->dev, mapping, len,
+				PCI_DMA_FROMDEVICE);
+#else
+	pci_dma_sync_single_for_cpu(bp->pdev, mapping, len,
+				    PCI_DMA_FROMDEVICE);
+#endif
+	get_page(page);
+
+	pg = &rxr->rx_pg_cache[rxr->rx_pg_cache_tail & BNX2_RX_PG_CACHE_MASK];
+	rxr->rx_pg_cache_tail++;
+	pg->page = page;
+	dma_unmap_addr_set(pg, mapping, mapping);
+	return 1;
+}
+
+static void
+bnx2_rx_pg_cache_drain(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr)
+{
+	if (!rxr->rx_pg_cache)
+		return;
+
+	while (rxr->rx_pg_cache_head != rxr->rx_pg_cache_tail)
+		bnx2_rx_pg_cache_evict(bp, rxr);
+}
+
 static inline int
 bnx2_alloc_rx_page(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr, u16 index, gfp_t gfp)
 {
@@ -3098,10 +3260,20 @@ bnx2_alloc_rx_page(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr, u16 index, gf
 	struct bnx2_sw_pg *rx_pg = &rxr->rx_pg_ring[index];
 	struct bnx2_rx_bd *rxbd =
 		&rxr->rx_pg_desc_ring[BNX2_RX_RING(index)][BNX2_RX_IDX(index)];
-	struct page *page = alloc_page(gfp);
+	struct page *page;
 
-	if (!page)
+	page = bnx2_rx_pg_cache_get(bp, rxr, &mapping);
+	if (page) {
+		rxr->rx_pg_cache_hit++;
+		goto done;
+	}
+
+	rxr->rx_pg_cache_miss++;
+	page = alloc_page(gfp);
+	if (!page) {
+		bnx2_rx_alloc_fail(rxr);
 		return -ENOMEM;
+	}
 #if (LINUX_VERSION_CODE >= 0x02061b)
 	mapping = dma_map_page(&bp->pdev->dev, page, 0, PAGE_SIZE,
 			       PCI_DMA_FROMDEVICE);
@@ -3112,9 +3284,11 @@ bnx2_alloc_rx_page(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr, u16 index, gf
 	if (pci_dma_mapping_error(mapping)) {
 #endif
 		__free_page(page);
+		bnx2_rx_alloc_fail(rxr);
 		return -EIO;
 	}
 
+done:
 	rx_pg->page = page;
 	dma_unmap_addr_set(rx_pg, mapping, mapping);
 	rxbd->rx_bd_haddr_hi = (u64) mapping >> 32;
@@ -3143,6 +3317,76 @@ bnx2_free_rx_page(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr, u16 index)
 	rx_pg->page = NULL;
 }
 
+#ifdef BNX2_BUILD_SKB
+static inline struct l2_fhdr *
+bnx2_get_l2_fhdr(struct bnx2 *bp, u8 *data)
+{
+	return (struct l2_fhdr *) PTR_ALIGN(data + bp->rx_headroom,
+					    BNX2_RX_ALIGN);
+}
+
+static u8 *
+bnx2_frag_alloc(struct bnx2 *bp, gfp_t gfp)
+{
+	if (bp->rx_frag_size) {
+		/* GFP_KERNEL allocations are used only when filling the ring */
+		if (unlikely(gfpflags_allow_blocking(gfp)))
+			return (u8 *) __get_free_page(gfp);
+
+		return netdev_alloc_frag(bp->rx_frag_size);
+	}
+
+	return kmalloc(bp->rx_buf_size, gfp);
+}
+
+static void
+bnx2_frag_free(struct bnx2 *bp, u8 *data)
+{
+	if (bp->rx_frag_size)
+		skb_free_frag(data);
+	else
+		kfree(data);
+}
+
+/* The rx ring holds raw buffers; the skb is only built around the buffer
+ * once a packet has landed in it (see bnx2_rx_skb()).
+ */
+static inline int
+bnx2_alloc_rx_data(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr, u16 index, gfp_t gfp)
+{
+	u8 *data;
+	struct bnx2_sw_bd *rx_buf = &rxr->rx_buf_ring[index];
+	dma_addr_t mapping;
+	struct bnx2_rx_bd *rxbd =
+		&rxr->rx_desc_ring[BNX2_RX_RING(index)][BNX2_RX_IDX(index)];
+
+	data = bnx2_frag_alloc(bp, gfp);
+	if (!data) {
+		bnx2_rx_alloc_fail(rxr);
+		return -ENOMEM;
+	}
+
+	mapping = dma_map_single(&bp->pdev->dev, bnx2_get_l2_fhdr(bp, data),
+				 bp->rx_buf_use_size, bp->rx_dma_dir);
+	if (dma_mapping_error(&bp->pdev->dev, mapping)) {
+		bnx2_frag_free(bp, data);
+		bnx2_rx_alloc_fail(rxr);
+		return -EIO;
+	}
+
+	rx_buf->data = data;
+	rx_buf->desc = bnx2_get_l2_fhdr(bp, data);
+	dma_unmap_addr_set(rx_buf, mapping, mapping);
+
+	rxbd->rx_bd_haddr_hi = (u64) mapping >> 32;
+	rxbd->rx_bd_haddr_lo = (u64) mapping & 0xffffffff;
+
+	rxr->rx_prod_bseq += bp->rx_buf_use_size;
+	rxr->rx_buf_alloc++;
+
+	return 0;
+}
+#else
 static inline int
 bnx2_alloc_rx_skb(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr, u16 index, gfp_t gfp)
 {
@@ -3155,6 +3399,7 @@ bnx2_alloc_rx_skb(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr, u16 index, gfp
 
 	skb = __netdev_alloc_skb(bp->dev, bp->rx_buf_size, gfp);
 	if (skb == NULL) {
+		bnx2_rx_alloc_fail(rxr);
 		return -ENOMEM;
 	}
 
@@ -3171,6 +3416,7 @@ bnx2_alloc_rx_skb(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr, u16 index, gfp
 	if (pci_dma_mapping_error(mapping)) {
 #endif
 		dev_kfree_skb(skb);
+		bnx2_rx_alloc_fail(rxr);
 		return -EIO;
 	}
 
@@ -3182,9 +3428,11 @@ bnx2_alloc_rx_skb(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr, u16 index, gfp
 	rxbd->rx_bd_haddr_lo = (u64) mapping & 0xffffffff;
 
 	rxr->rx_prod_bseq += bp->rx_buf_use_size;
+	rxr->rx_buf_alloc++;
 
 	return 0;
 }
+#endif
 
 static int
 bnx2_phy_event_is_set(struct bnx2 *bp, struct bnx2_napi *bnapi, u32 event)
@@ -3234,6 +3482,141 @@ bnx2_get_hw_tx_cons(struct bnx2_napi *bnapi)
 	return cons;
 }
 
+/* Tell the chip about every BD queued on the ring so far. */
+static inline void
+bnx2_tx_doorbell(struct bnx2 *bp, struct bnx2_tx_ring_info *txr)
+{
+	/* Sync BD data before updating TX mailbox */
+	wmb();
+
+	BNX2_WR16(bp, txr->tx_bidx_addr, txr->tx_prod);
+	BNX2_WR(bp, txr->tx_bseq_addr, txr->tx_prod_bseq);
+
+	mmiowb();
+
+	txr->tx_db_pending = 0;
+	txr->tx_db_writes++;
+}
+
+#ifdef BNX2_XDP
+/* XDP needs the whole frame in one page, see bnx2_set_rx_ring_size() */
+static inline int
+bnx2_xdp_max_mtu(void)
+{
+	return PAGE_SIZE - SKB_DATA_ALIGN(sizeof(struct skb_shared_info)) -
+	       XDP_PACKET_HEADROOM - BNX2_RX_ALIGN - ETH_HLEN -
+	       BNX2_RX_OFFSET - 8;
+}
+
+static inline bool
+bnx2_is_xdp_tx_ring(struct bnx2 *bp, struct bnx2_napi *bnapi)
+{
+	return bp->num_xdp_tx_rings &&
+	       bnapi == &bp->bnx2_napi[bp->num_tx_rings - 1];
+}
+
+static inline struct bnx2_tx_ring_info *
+bnx2_xdp_tx_ring(struct bnx2 *bp)
+{
+	return &bp->bnx2_napi[bp->num_tx_rings - 1].tx_ring;
+}
+
+/* Queue one frame on the XDP tx ring, with xdp_tx_lock held.  mapping is
+ * what gets unmapped on completion and the frame starts at offset in it.
+ * The doorbell is left to the caller.
+ */
+static int
+bnx2_xdp_xmit_frame(struct bnx2 *bp, struct bnx2_tx_ring_info *txr,
+		    struct xdp_frame *xdpf, dma_addr_t mapping, u32 offset,
+		    bool rx_buf)
+{
+	struct bnx2_sw_tx_bd *tx_buf;
+	struct bnx2_tx_bd *txbd;
+	u16 prod = txr->tx_prod, ring_prod = BNX2_TX_RING_IDX(prod);
+
+	if (unlikely(bnx2_tx_avail(bp, txr) < 1)) {
+		txr->xdp_xmit_err++;
+		return -ENOSPC;
+	}
+
+	tx_buf = &txr->tx_buf_ring[ring_prod];
+	tx_buf->xdpf = xdpf;
+	tx_buf->xdp_rx_buf = rx_buf;
+	tx_buf->nr_frags = 0;
+	tx_buf->is_gso = 0;
+	dma_unmap_addr_set(tx_buf, mapping, mapping);
+
+	mapping += offset;
+	txbd = &txr->tx_desc_ring[ring_prod];
+	txbd->tx_bd_haddr_hi = (u64) mapping >> 32;
+	txbd->tx_bd_haddr_lo = (u64) mapping & 0xffffffff;
+	txbd->tx_bd_mss_nbytes = xdpf->len;
+	txbd->tx_bd_vlan_tag_flags = TX_BD_FLAGS_START | TX_BD_FLAGS_END;
+
+	txr->tx_prod = BNX2_NEXT_TX_BD(prod);
+	txr->tx_prod_bseq += xdpf->len;
+	txr->tx_db_pending++;
+	txr->tx_db_pkts++;
+	txr->xdp_xmit++;
+	return 0;
+}
+
+static void
+bnx2_xdp_free_tx_buf(struct bnx2 *bp, struct bnx2_sw_tx_bd *tx_buf)
+{
+	struct xdp_frame *xdpf = tx_buf->xdpf;
+
+	if (tx_buf->xdp_rx_buf)
+		dma_unmap_single(&bp->pdev->dev,
+				 dma_unmap_addr(tx_buf, mapping),
+				 bp->rx_buf_use_size, bp->rx_dma_dir);
+	else
+		dma_unmap_single(&bp->pdev->dev,
+				 dma_unmap_addr(tx_buf, mapping),
+				 xdpf->len, DMA_TO_DEVICE);
+	tx_buf->xdpf = NULL;
+	xdp_return_frame(xdpf);
+}
+
+/* Completions on the XDP tx ring.  Nothing here is seen by the stack, so
+ * there is no queue to wake and no BQL accounting.
+ */
+static int
+bnx2_xdp_tx_int(struct bnx2 *bp, struct bnx2_napi *bnapi)
+{
+	struct bnx2_tx_ring_info *txr = &bnapi->tx_ring;
+	u16 hw_cons, sw_cons;
+	unsigned int tx_bytes = 0;
+	int tx_pkt = 0;
+
+	hw_cons = bnx2_get_hw_tx_cons(bnapi);
+	sw_cons = txr->tx_cons;
+
+	while (sw_cons != hw_cons) {
+		struct bnx2_sw_tx_bd *tx_buf;
+
+		tx_buf = &txr->tx_buf_ring[BNX2_TX_RING_IDX(sw_cons)];
+		tx_bytes += tx_buf->xdpf->len;
+		bnx2_xdp_free_tx_buf(bp, tx_buf);
+		tx_pkt++;
+
+		sw_cons = BNX2_NEXT_TX_BD(sw_cons);
+		if (hw_cons == sw_cons)
+			hw_cons = bnx2_get_hw_tx_cons(bnapi);
+	}
+
+	txr->hw_tx_cons = hw_cons;
+	txr->tx_cons = sw_cons;
+
+	u64_stats_update_begin(&txr->tx_syncp);
+	txr->tx_packets += tx_pkt;
+	txr->tx_bytes += tx_bytes;
+	u64_stats_update_end(&txr->tx_syncp);
+
+	return tx_pkt;
+}
+#endif
+
 static int
 #if defined(__VMKLNX__)
 bnx2_tx_int(struct bnx2 *bp, struct bnx2_napi *bnapi, int budget,
@@ -3244,6 +3627,7 @@ bnx2_tx_int(struct bnx2 *bp, struct bnx2_napi *bnapi, int budget)
 {
 	struct bnx2_tx_ring_info *txr = &bnapi->tx_ring;
 	u16 hw_cons, sw_cons, sw_ring_cons;
+	unsigned int tx_bytes = 0;
 #ifndef BCM_HAVE_MULTI_QUEUE
 	int tx_pkt = 0;
 #else
@@ -3254,6 +3638,11 @@ bnx2_tx_int(struct bnx2 *bp, struct bnx2_napi *bnapi, int budget)
 	txq = netdev_get_tx_queue(bp->dev, index);
 #endif
 
+#ifdef BNX2_XDP
+	if (unlikely(bnx2_is_xdp_tx_ring(bp, bnapi)))
+		return bnx2_xdp_tx_int(bp, bnapi);
+#endif
+
 	hw_cons = bnx2_get_hw_tx_cons(bnapi);
 	sw_cons = txr->tx_cons;
 
@@ -3314,6 +3703,7 @@ bnx2_tx_int(struct bnx2 *bp, struct bnx2_napi *bnapi, int budget)
 
 		sw_cons = BNX2_NEXT_TX_BD(sw_cons);
 
+		tx_bytes += skb->len;
 		dev_kfree_skb(skb);
 #if defined(BNX2_ENABLE_NETQUEUE)
 		bnapi->stats.tx_packets++;
@@ -3332,6 +3722,15 @@ bnx2_tx_int(struct bnx2 *bp, struct bnx2_napi *bnapi, int budget)
 	txr->hw_tx_cons = hw_cons;
 	txr->tx_cons = sw_cons;
 
+	u64_stats_update_begin(&txr->tx_syncp);
+	txr->tx_packets += tx_pkt;
+	txr->tx_bytes += tx_bytes;
+	u64_stats_update_end(&txr->tx_syncp);
+
+#ifdef BCM_HAVE_MULTI_QUEUE
+	netdev_tx_completed_queue(txq, tx_pkt, tx_bytes);
+#endif
+
 	/* Need to make the tx_cons update visible to bnx2_start_xmit()
 	 * before checking for netif_tx_queue_stopped().  Without the
 	 * memory barrier, there is a small possibility that bnx2_start_xmit()
@@ -3424,9 +3823,12 @@ bnx2_reuse_rx_skb_pages(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr,
 	rxr->rx_pg_cons = cons;
 }
 
+/* Hand the still-mapped buffer at cons back to the chip at prod.  The
+ * caller has already stored the buffer pointer in the prod entry.
+ */
 static inline void
-bnx2_reuse_rx_skb(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr,
-		  struct sk_buff *skb, u16 cons, u16 prod)
+bnx2_reuse_rx_bd(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr,
+		 u16 cons, u16 prod)
 {
 	struct bnx2_sw_bd *cons_rx_buf, *prod_rx_buf;
 	struct bnx2_rx_bd *cons_bd, *prod_bd;
@@ -3440,12 +3842,10 @@ bnx2_reuse_rx_skb(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr,
 	pci_dma_sync_single_for_device(bp->pdev,
 #endif
  		dma_unmap_addr(cons_rx_buf, mapping),
- 		BNX2_RX_OFFSET + BNX2_RX_COPY_THRESH, PCI_DMA_FROMDEVICE);
+ 		BNX2_RX_OFFSET + BNX2_RX_COPY_THRESH, bp->rx_dma_dir);
 
 	rxr->rx_prod_bseq += bp->rx_buf_use_size;
-
-	prod_rx_buf->skb = skb;
-	prod_rx_buf->desc = (struct l2_fhdr *) skb->data;
+	rxr->rx_buf_recycle++;
 
 	if (cons == prod)
 		return;
@@ -3459,26 +3859,77 @@ bnx2_reuse_rx_skb(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr,
 	prod_bd->rx_bd_haddr_lo = cons_bd->rx_bd_haddr_lo;
 }
 
-static int
-bnx2_rx_skb(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr, struct sk_buff *skb,
+#ifdef BNX2_BUILD_SKB
+static inline void
+bnx2_reuse_rx_data(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr,
+		   u8 *data, u16 cons, u16 prod)
+{
+	struct bnx2_sw_bd *prod_rx_buf = &rxr->rx_buf_ring[prod];
+
+	prod_rx_buf->data = data;
+	prod_rx_buf->desc = bnx2_get_l2_fhdr(bp, data);
+	bnx2_reuse_rx_bd(bp, rxr, cons, prod);
+}
+#else
+static inline void
+bnx2_reuse_rx_skb(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr,
+		  struct sk_buff *skb, u16 cons, u16 prod)
+{
+	struct bnx2_sw_bd *prod_rx_buf = &rxr->rx_buf_ring[prod];
+
+	prod_rx_buf->skb = skb;
+	prod_rx_buf->desc = (struct l2_fhdr *) skb->data;
+	bnx2_reuse_rx_bd(bp, rxr, cons, prod);
+}
+#endif
+
+static struct sk_buff *
+bnx2_rx_skb(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr,
+#ifdef BNX2_BUILD_SKB
+	    u8 *data, int pad,
+#else
+	    struct sk_buff *skb,
+#endif
 	    unsigned int len, unsigned int hdr_len, dma_addr_t dma_addr,
 	    u32 ring_idx)
 {
 	int err;
 	u16 prod = ring_idx & 0xffff;
+#ifdef BNX2_BUILD_SKB
+	struct sk_buff *skb;
 
+	err = bnx2_alloc_rx_data(bp, rxr, prod, GFP_ATOMIC);
+#else
 	err = bnx2_alloc_rx_skb(bp, rxr, prod, GFP_ATOMIC);
+#endif
 	if (unlikely(err)) {
+#ifdef BNX2_BUILD_SKB
+		bnx2_reuse_rx_data(bp, rxr, data, (u16) (ring_idx >> 16), prod);
+error:
+#else
 		bnx2_reuse_rx_skb(bp, rxr, skb, (u16) (ring_idx >> 16), prod);
+#endif
 		if (hdr_len) {
 			unsigned int raw_len = len + 4;
 			int pages = PAGE_ALIGN(raw_len - hdr_len) >> PAGE_SHIFT;
 
 			bnx2_reuse_rx_skb_pages(bp, rxr, NULL, pages);
 		}
-		return err;
+		return NULL;
 	}
 
+#ifdef BNX2_BUILD_SKB
+	dma_unmap_single(&bp->pdev->dev, dma_addr, bp->rx_buf_use_size,
+			 bp->rx_dma_dir);
+
+	skb = build_skb(data, bp->rx_frag_size);
+	if (unlikely(!skb)) {
+		bnx2_frag_free(bp, data);
+		goto error;
+	}
+	skb_reserve(skb, ((u8 *) bnx2_get_l2_fhdr(bp, data) - data) +
+			 BNX2_RX_OFFSET + pad);
+#else
 	skb_reserve(skb, BNX2_RX_OFFSET);
 #if (LINUX_VERSION_CODE >= 0x02061b)
 	dma_unmap_single(&bp->pdev->dev, dma_addr, bp->rx_buf_use_size,
@@ -3486,11 +3937,12 @@ bnx2_rx_skb(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr, struct sk_buff *skb,
 #else
 	pci_unmap_single(bp->pdev, dma_addr, bp->rx_buf_use_size,
 			 PCI_DMA_FROMDEVICE);
+#endif
 #endif
 
 	if (hdr_len == 0) {
 		skb_put(skb, len);
-		return 0;
+		return skb;
 	} else {
 		unsigned int i, frag_len, frag_size, pages;
 		struct bnx2_sw_pg *rx_pg;
@@ -3503,6 +3955,7 @@ bnx2_rx_skb(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr, struct sk_buff *skb,
 
 		for (i = 0; i < pages; i++) {
 			dma_addr_t mapping_old;
+			struct page *page;
 
 			frag_len = min(frag_size, (unsigned int) PAGE_SIZE);
 			if (unlikely(frag_len <= 4)) {
@@ -3521,7 +3974,7 @@ bnx2_rx_skb(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr, struct sk_buff *skb,
 					skb_frag_size_sub(frag, tail);
 					skb->data_len -= tail;
 				}
-				return 0;
+				return skb;
 			}
 			rx_pg = &rxr->rx_pg_ring[pg_cons];
 
@@ -3532,8 +3985,8 @@ bnx2_rx_skb(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr, struct sk_buff *skb,
 			if (i == pages - 1)
 				frag_len -= 4;
 
-			bnx2_skb_fill_page_desc(skb, i, rx_pg->page, 0,
-						frag_len);
+			page = rx_pg->page;
+			bnx2_skb_fill_page_desc(skb, i, page, 0, frag_len);
 			rx_pg->page = NULL;
 
 			err = bnx2_alloc_rx_page(bp, rxr,
@@ -3544,15 +3997,17 @@ bnx2_rx_skb(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr, struct sk_buff *skb,
 				rxr->rx_pg_prod = pg_prod;
 				bnx2_reuse_rx_skb_pages(bp, rxr, skb,
 							pages - i);
-				return err;
+				return NULL;
 			}
 
+			if (!bnx2_rx_pg_cache_put(bp, rxr, page, mapping_old,
+						  frag_len))
 #if (LINUX_VERSION_CODE >= 0x02061b)
-			dma_unmap_page(&bp->pdev->dev, mapping_old,
- 				       PAGE_SIZE, PCI_DMA_FROMDEVICE);
+				dma_unmap_page(&bp->pdev->dev, mapping_old,
+					       PAGE_SIZE, PCI_DMA_FROMDEVICE);
 #else
-			pci_unmap_page(bp->pdev, mapping_old,
-				       PAGE_SIZE, PCI_DMA_FROMDEVICE);
+				pci_unmap_page(bp->pdev, mapping_old,
+					       PAGE_SIZE, PCI_DMA_FROMDEVICE);
 #endif
 
 			frag_size -= frag_len;
@@ -3566,7 +4021,7 @@ bnx2_rx_skb(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr, struct sk_buff *skb,
 		rxr->rx_pg_prod = pg_prod;
 		rxr->rx_pg_cons = pg_cons;
 	}
-	return 0;
+	return skb;
 }
 
 static inline u16
@@ -3583,23 +4038,175 @@ bnx2_get_hw_rx_cons(struct bnx2_napi *bnapi)
 	return cons;
 }
 
+#ifdef BNX2_XDP
+#define BNX2_XDP_PASS		0
+#define BNX2_XDP_DROP		1
+#define BNX2_XDP_ERR		2
+#define BNX2_XDP_TX		4
+#define BNX2_XDP_REDIR		8
+
+static void
+bnx2_xdp_recycle(struct bnx2 *bp, struct bnx2_rx_ring_info *rxr, u8 *data,
+		 dma_addr_t dma_addr, u16 cons, u16 prod)
+{
+	/* the program may have written anywhere in the buffer */
+	dma_sync_single_for_device(&bp->pdev->dev, dma_addr,
+				   bp->rx_buf_use_size, bp->rx_dma_dir);
+	bnx2_reuse_rx_data(bp, rxr, data, cons, prod);
+}
+
+/* Run the program on the frame in the rx buffer at cons.  On XDP_PASS the
+ * frame goes up the stack as usual, with len and pad describing what the
+ * program left of it.  Otherwise the buffer is consumed here: it is either
+ * recycled to prod, or handed to the XDP tx ring or a redirect target with
+ * prod refilled from a fresh buffer.
+ */
 static int
-bnx2_rx_int(struct bnx2 *bp, struct bnx2_napi *bnapi, int budget)
+bnx2_rx_xdp(struct bnx2 *bp, struct bnx2_napi *bnapi, struct bpf_prog *prog,
+	    u8 *data, dma_addr_t dma_addr, u16 cons, u16 prod,
+	    unsigned int *len, int *pad)
 {
 	struct bnx2_rx_ring_info *rxr = &bnapi->rx_ring;
-	u16 hw_cons, sw_cons, sw_ring_cons, sw_prod, sw_ring_prod;
-	struct l2_fhdr *rx_hdr;
-	int rx_pkt = 0, pg_ring_used = 0;
-#if defined(BNX2_ENABLE_NETQUEUE)
-	int index = (bnapi - bp->bnx2_napi);
-#endif
+	u8 *fhdr = (u8 *) bnx2_get_l2_fhdr(bp, data);
+	u8 *pkt = fhdr + BNX2_RX_OFFSET;
+	struct bnx2_tx_ring_info *txr;
+	struct xdp_frame *xdpf;
+	struct xdp_buff xdp;
+	dma_addr_t mapping;
+	bool in_place;
+	u32 act;
+	long off;
+	int err;
 
-	hw_cons = bnx2_get_hw_rx_cons(bnapi);
-	sw_cons = rxr->rx_cons;
-	sw_prod = rxr->rx_prod;
+	dma_sync_single_for_cpu(&bp->pdev->dev, dma_addr,
+				BNX2_RX_OFFSET + *len, bp->rx_dma_dir);
 
-	/* Memory barrier necessary as speculative reads of the rx
-	 * buffer can be ahead of the index in the status block
+	xdp_init_buff(&xdp, bp->rx_frag_size, &rxr->xdp_rxq);
+	xdp_prepare_buff(&xdp, data, pkt - data, *len, false);
+
+	act = bpf_prog_run_xdp(prog, &xdp);
+	switch (act) {
+	case XDP_PASS:
+		*pad = (u8 *) xdp.data - pkt;
+		*len = (u8 *) xdp.data_end - (u8 *) xdp.data;
+		return BNX2_XDP_PASS;
+
+	case XDP_TX:
+		if (!bp->num_xdp_tx_rings)
+			goto exception;
+
+		xdpf = xdp_convert_buff_to_frame(&xdp);
+		if (unlikely(!xdpf))
+			goto exception;
+
+		if (bnx2_alloc_rx_data(bp, rxr, prod, GFP_ATOMIC))
+			goto err;
+
+		/* Send from the rx mapping unless the program moved the head
+		 * in front of it.
+		 */
+		off = (u8 *) xdpf->data - fhdr;
+		in_place = off >= 0 && off + xdpf->len <= bp->rx_buf_use_size;
+		if (in_place) {
+			dma_sync_single_for_device(&bp->pdev->dev,
+						   dma_addr + off, xdpf->len,
+						   bp->rx_dma_dir);
+			mapping = dma_addr;
+		} else {
+			dma_unmap_single(&bp->pdev->dev, dma_addr,
+					 bp->rx_buf_use_size, bp->rx_dma_dir);
+			mapping = dma_map_single(&bp->pdev->dev, xdpf->data,
+						 xdpf->len, DMA_TO_DEVICE);
+			if (dma_mapping_error(&bp->pdev->dev, mapping)) {
+				bnx2_frag_free(bp, data);
+				goto dropped;
+			}
+			off = 0;
+		}
+
+		txr = bnx2_xdp_tx_ring(bp);
+		spin_lock(&txr->xdp_tx_lock);
+		err = bnx2_xdp_xmit_frame(bp, txr, xdpf, mapping, off,
+					  in_place);
+		spin_unlock(&txr->xdp_tx_lock);
+		if (unlikely(err)) {
+			if (in_place)
+				dma_unmap_single(&bp->pdev->dev, mapping,
+						 bp->rx_buf_use_size,
+						 bp->rx_dma_dir);
+			else
+				dma_unmap_single(&bp->pdev->dev, mapping,
+						 xdpf->len, DMA_TO_DEVICE);
+			bnx2_frag_free(bp, data);
+			goto dropped;
+		}
+		rxr->xdp_tx++;
+		return BNX2_XDP_TX;
+
+	case XDP_REDIRECT:
+		if (bnx2_alloc_rx_data(bp, rxr, prod, GFP_ATOMIC))
+			goto err;
+
+		dma_unmap_single(&bp->pdev->dev, dma_addr,
+				 bp->rx_buf_use_size, bp->rx_dma_dir);
+		if (xdp_do_redirect(bp->dev, &xdp, prog)) {
+			bnx2_frag_free(bp, data);
+			goto dropped;
+		}
+		rxr->xdp_redirect++;
+		return BNX2_XDP_REDIR;
+
+	default:
+		bpf_warn_invalid_xdp_action(bp->dev, prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+		trace_xdp_exception(bp->dev, prog, act);
+		rxr->xdp_aborted++;
+		break;
+
+	case XDP_DROP:
+		rxr->xdp_drop++;
+		break;
+	}
+	bnx2_xdp_recycle(bp, rxr, data, dma_addr, cons, prod);
+	return BNX2_XDP_DROP;
+
+exception:
+	trace_xdp_exception(bp->dev, prog, act);
+err:
+	bnx2_xdp_recycle(bp, rxr, data, dma_addr, cons, prod);
+	return BNX2_XDP_ERR;
+
+dropped:
+	/* prod already holds a fresh buffer, only the frame is lost */
+	trace_xdp_exception(bp->dev, prog, act);
+	return BNX2_XDP_ERR;
+}
+#endif
+
+static int
+bnx2_rx_int(struct bnx2 *bp, struct bnx2_napi *bnapi, int budget)
+{
+	struct bnx2_rx_ring_info *rxr = &bnapi->rx_ring;
+	u16 hw_cons, sw_cons, sw_ring_cons, sw_prod, sw_ring_prod;
+	struct l2_fhdr *rx_hdr;
+	int rx_pkt = 0, pg_ring_used = 0;
+	unsigned int rx_bytes = 0, rx_drops = 0;
+#if defined(BNX2_ENABLE_NETQUEUE)
+	int index = (bnapi - bp->bnx2_napi);
+#endif
+#ifdef BNX2_XDP
+	struct bpf_prog *xdp_prog = READ_ONCE(rxr->xdp_prog);
+	struct l2_fhdr xdp_fhdr;
+	int xdp_flags = 0;
+#endif
+
+	hw_cons = bnx2_get_hw_rx_cons(bnapi);
+	sw_cons = rxr->rx_cons;
+	sw_prod = rxr->rx_prod;
+
+	/* Memory barrier necessary as speculative reads of the rx
+	 * buffer can be ahead of the index in the status block
 	 */
 	rmb();
 	while (sw_cons != hw_cons) {
@@ -3607,6 +4214,10 @@ bnx2_rx_int(struct bnx2 *bp, struct bnx2_napi *bnapi, int budget)
 		u32 status;
 		struct bnx2_sw_bd *rx_buf, *next_rx_buf;
 		struct sk_buff *skb;
+#ifdef BNX2_BUILD_SKB
+		u8 *data;
+		int pad = 0;
+#endif
 		dma_addr_t dma_addr;
 		u16 vtag = 0;
 		int hw_vlan __maybe_unused = 0;
@@ -3616,14 +4227,22 @@ bnx2_rx_int(struct bnx2 *bp, struct bnx2_napi *bnapi, int budget)
 		sw_ring_prod = BNX2_RX_RING_IDX(sw_prod);
 
 		rx_buf = &rxr->rx_buf_ring[sw_ring_cons];
+#ifdef BNX2_BUILD_SKB
+		data = rx_buf->data;
+#else
 		skb = rx_buf->skb;
 		prefetchw(skb);
+#endif
 
 		next_ring_idx = BNX2_RX_RING_IDX(BNX2_NEXT_RX_BD(sw_cons));
 		next_rx_buf = &rxr->rx_buf_ring[next_ring_idx];
 		prefetch(next_rx_buf->desc);
 
+#ifdef BNX2_BUILD_SKB
+		rx_buf->data = NULL;
+#else
 		rx_buf->skb = NULL;
+#endif
 
 		dma_addr = dma_unmap_addr(rx_buf, mapping);
 
@@ -3633,7 +4252,7 @@ bnx2_rx_int(struct bnx2 *bp, struct bnx2_napi *bnapi, int budget)
 		pci_dma_sync_single_for_cpu(bp->pdev, dma_addr,
 #endif
 			BNX2_RX_OFFSET + BNX2_RX_COPY_THRESH,
-			PCI_DMA_FROMDEVICE);
+			bp->rx_dma_dir);
 
 		rx_hdr = rx_buf->desc;
 		len = rx_hdr->l2_fhdr_pkt_len;
@@ -3666,8 +4285,13 @@ bnx2_rx_int(struct bnx2 *bp, struct bnx2_napi *bnapi, int budget)
 				bnapi->stats.rx_frame_errors++;
 #endif
 
+#ifdef BNX2_BUILD_SKB
+			bnx2_reuse_rx_data(bp, rxr, data, sw_ring_cons,
+					   sw_ring_prod);
+#else
 			bnx2_reuse_rx_skb(bp, rxr, skb, sw_ring_cons,
 					  sw_ring_prod);
+#endif
 			if (pg_ring_used) {
 				int pages;
 
@@ -3680,13 +4304,51 @@ bnx2_rx_int(struct bnx2 *bp, struct bnx2_napi *bnapi, int budget)
 
 		len -= 4;
 
+#ifdef BNX2_XDP
+		if (xdp_prog && !hdr_len) {
+			int res;
+
+			/* a program growing the head may overwrite l2_fhdr */
+			xdp_fhdr = *rx_hdr;
+			rx_hdr = &xdp_fhdr;
+
+			res = bnx2_rx_xdp(bp, bnapi, xdp_prog, data, dma_addr,
+					  sw_ring_cons, sw_ring_prod,
+					  &len, &pad);
+			if (res != BNX2_XDP_PASS) {
+				if (res == BNX2_XDP_ERR)
+					rx_drops++;
+				xdp_flags |= res;
+				rx_pkt++;
+				rx_bytes += len;
+				goto next_rx;
+			}
+		}
+#endif
+
 		if (len <= bp->rx_copy_thresh) {
 			struct sk_buff *new_skb;
 
 			new_skb = netdev_alloc_skb(bp->dev, len + 6);
+#ifdef BNX2_BUILD_SKB
+			/* The buffer stays mapped and goes straight back to
+			 * the chip, whether or not the copy succeeded.
+			 */
+			if (new_skb)
+				memcpy(new_skb->data,
+				       (u8 *) rx_hdr + BNX2_RX_OFFSET - 6,
+				       len + 6);
+			bnx2_reuse_rx_data(bp, rxr, data, sw_ring_cons,
+					   sw_ring_prod);
+			if (new_skb == NULL) {
+				rx_drops++;
+				goto next_rx;
+			}
+#else
 			if (new_skb == NULL) {
 				bnx2_reuse_rx_skb(bp, rxr, skb, sw_ring_cons,
 						  sw_ring_prod);
+				rx_drops++;
 				goto next_rx;
 			}
 
@@ -3700,16 +4362,28 @@ bnx2_rx_int(struct bnx2 *bp, struct bnx2_napi *bnapi, int budget)
 			       len + 6);
 #endif
 
-			skb_reserve(new_skb, 6);
-			skb_put(new_skb, len);
-
 			bnx2_reuse_rx_skb(bp, rxr, skb,
 				sw_ring_cons, sw_ring_prod);
+#endif
+
+			skb_reserve(new_skb, 6);
+			skb_put(new_skb, len);
 
 			skb = new_skb;
-		} else if (unlikely(bnx2_rx_skb(bp, rxr, skb, len, hdr_len,
-			   dma_addr, (sw_ring_cons << 16) | sw_ring_prod)))
-			goto next_rx;
+		} else {
+#ifdef BNX2_BUILD_SKB
+			skb = bnx2_rx_skb(bp, rxr, data, pad, len, hdr_len,
+					  dma_addr,
+					  (sw_ring_cons << 16) | sw_ring_prod);
+#else
+			skb = bnx2_rx_skb(bp, rxr, skb, len, hdr_len, dma_addr,
+					  (sw_ring_cons << 16) | sw_ring_prod);
+#endif
+			if (unlikely(!skb)) {
+				rx_drops++;
+				goto next_rx;
+			}
+		}
 
 		if ((status & L2_FHDR_STATUS_L2_VLAN_TAG) &&
 		    !(bp->rx_mode & BNX2_EMAC_RX_MODE_KEEP_VLAN_TAG)) {
@@ -3740,6 +4414,7 @@ bnx2_rx_int(struct bnx2 *bp, struct bnx2_napi *bnapi, int budget)
 			(ntohs(skb->protocol) != 0x8100)) {
 
 			dev_kfree_skb(skb);
+			rx_drops++;
 			goto next_rx;
 
 		}
@@ -3792,6 +4467,8 @@ bnx2_rx_int(struct bnx2 *bp, struct bnx2_napi *bnapi, int budget)
 		bp->dev->last_rx = jiffies;
 #endif
 		rx_pkt++;
+		rx_bytes += len;
+		bnapi->aim_rx_bytes += len;
 
 #if defined(BNX2_ENABLE_NETQUEUE)
 		/*  Update queue specific stats */
@@ -3815,6 +4492,26 @@ next_rx:
 	rxr->rx_cons = sw_cons;
 	rxr->rx_prod = sw_prod;
 
+	u64_stats_update_begin(&rxr->rx_syncp);
+	rxr->rx_packets += rx_pkt;
+	rxr->rx_bytes += rx_bytes;
+	rxr->rx_drops += rx_drops;
+	u64_stats_update_end(&rxr->rx_syncp);
+
+#ifdef BNX2_XDP
+	if (xdp_flags & BNX2_XDP_REDIR)
+		xdp_do_flush();
+
+	if (xdp_flags & BNX2_XDP_TX) {
+		struct bnx2_tx_ring_info *txr = bnx2_xdp_tx_ring(bp);
+
+		spin_lock(&txr->xdp_tx_lock);
+		if (txr->tx_db_pending)
+			bnx2_tx_doorbell(bp, txr);
+		spin_unlock(&txr->xdp_tx_lock);
+	}
+#endif
+
 	if (pg_ring_used)
 		BNX2_WR16(bp, rxr->rx_pg_bidx_addr, rxr->rx_pg_prod);
 
@@ -4019,6 +4716,25 @@ static void bnx2_poll_cnic(struct bnx2 *bp, struct bnx2_napi *bnapi)
 }
 #endif
 
+static void
+bnx2_init_aim(struct bnx2 *bp)
+{
+	int i;
+
+	for (i = 0; i < bp->irq_nvecs; i++) {
+		struct bnx2_napi *bnapi = &bp->bnx2_napi[i];
+
+		bnapi->aim_rx_pkts = 0;
+		bnapi->aim_rx_bytes = 0;
+		bnapi->aim_tx_pkts = 0;
+		bnapi->aim_last = jiffies;
+		bnapi->aim_rx_ticks = bp->rx_ticks;
+		bnapi->aim_rx_trip = bp->rx_quick_cons_trip;
+		bnapi->aim_tx_ticks = bp->tx_ticks;
+		bnapi->aim_tx_trip = bp->tx_quick_cons_trip;
+	}
+}
+
 #ifdef BNX2_NEW_NAPI
 static void bnx2_poll_link(struct bnx2 *bp, struct bnx2_napi *bnapi)
 {
@@ -4040,6 +4756,104 @@ static void bnx2_poll_link(struct bnx2 *bp, struct bnx2_napi *bnapi)
 	}
 }
 
+/* Program one vector's rx/tx coalescing without touching the rest of the
+ * HC block.  Vector 0 uses the global registers, the other MSI-X vectors
+ * of the 5709 have their own status block config.
+ */
+static void
+bnx2_set_vec_coal(struct bnx2 *bp, int vec, u16 rx_ticks, u16 rx_trip,
+		  u16 tx_ticks, u16 tx_trip)
+{
+	u32 base;
+
+	if (vec == 0) {
+		BNX2_WR(bp, BNX2_HC_RX_QUICK_CONS_TRIP,
+			(bp->rx_quick_cons_trip_int << 16) | rx_trip);
+		BNX2_WR(bp, BNX2_HC_RX_TICKS,
+			(bp->rx_ticks_int << 16) | rx_ticks);
+		BNX2_WR(bp, BNX2_HC_TX_QUICK_CONS_TRIP,
+			(bp->tx_quick_cons_trip_int << 16) | tx_trip);
+		BNX2_WR(bp, BNX2_HC_TX_TICKS,
+			(bp->tx_ticks_int << 16) | tx_ticks);
+		return;
+	}
+
+	base = ((vec - 1) * BNX2_HC_SB_CONFIG_SIZE) + BNX2_HC_SB_CONFIG_1;
+	BNX2_WR(bp, base + BNX2_HC_RX_QUICK_CONS_TRIP_OFF,
+		(bp->rx_quick_cons_trip_int << 16) | rx_trip);
+	BNX2_WR(bp, base + BNX2_HC_RX_TICKS_OFF,
+		(bp->rx_ticks_int << 16) | rx_ticks);
+	BNX2_WR(bp, base + BNX2_HC_TX_QUICK_CONS_TRIP_OFF,
+		(bp->tx_quick_cons_trip_int << 16) | tx_trip);
+	BNX2_WR(bp, base + BNX2_HC_TX_TICKS_OFF,
+		(bp->tx_ticks_int << 16) | tx_ticks);
+}
+
+/* Scale ticks and trip linearly between the latency and the throughput
+ * settings.  Small packets at moderate rates are treated as request/response
+ * traffic and keep the low latency settings.
+ */
+static void
+bnx2_aim_scale(u32 rate, u32 avg_size, u16 *ticks, u16 *trip)
+{
+	u32 span = BNX2_AIM_RATE_HIGH - BNX2_AIM_RATE_LOW;
+
+	if (rate <= BNX2_AIM_RATE_LOW ||
+	    (avg_size < BNX2_AIM_SMALL_PKT && rate < BNX2_AIM_RATE_HIGH)) {
+		*ticks = BNX2_AIM_TICKS_LOW;
+		*trip = BNX2_AIM_TRIP_LOW;
+	} else if (rate >= BNX2_AIM_RATE_HIGH) {
+		*ticks = BNX2_AIM_TICKS_HIGH;
+		*trip = BNX2_AIM_TRIP_HIGH;
+	} else {
+		rate -= BNX2_AIM_RATE_LOW;
+		*ticks = BNX2_AIM_TICKS_LOW + rate *
+			 (BNX2_AIM_TICKS_HIGH - BNX2_AIM_TICKS_LOW) / span;
+		*trip = BNX2_AIM_TRIP_LOW + rate *
+			(BNX2_AIM_TRIP_HIGH - BNX2_AIM_TRIP_LOW) / span;
+	}
+}
+
+static void
+bnx2_adapt_coal(struct bnx2 *bp, struct bnx2_napi *bnapi)
+{
+	unsigned long delta = jiffies - bnapi->aim_last;
+	u16 rx_ticks = bnapi->aim_rx_ticks, rx_trip = bnapi->aim_rx_trip;
+	u16 tx_ticks = bnapi->aim_tx_ticks, tx_trip = bnapi->aim_tx_trip;
+	u32 msecs;
+
+	if (delta < BNX2_AIM_INTERVAL)
+		return;
+
+	msecs = jiffies_to_msecs(delta);
+	if (bp->adaptive_rx) {
+		u32 avg = 0;
+
+		if (bnapi->aim_rx_pkts)
+			avg = bnapi->aim_rx_bytes / bnapi->aim_rx_pkts;
+		bnx2_aim_scale(bnapi->aim_rx_pkts / msecs, avg,
+			       &rx_ticks, &rx_trip);
+	}
+	if (bp->adaptive_tx)
+		bnx2_aim_scale(bnapi->aim_tx_pkts / msecs, BNX2_AIM_SMALL_PKT,
+			       &tx_ticks, &tx_trip);
+
+	if (rx_ticks != bnapi->aim_rx_ticks || rx_trip != bnapi->aim_rx_trip ||
+	    tx_ticks != bnapi->aim_tx_ticks || tx_trip != bnapi->aim_tx_trip) {
+		bnx2_set_vec_coal(bp, bnapi - bp->bnx2_napi, rx_ticks, rx_trip,
+				  tx_ticks, tx_trip);
+		bnapi->aim_rx_ticks = rx_ticks;
+		bnapi->aim_rx_trip = rx_trip;
+		bnapi->aim_tx_ticks = tx_ticks;
+		bnapi->aim_tx_trip = tx_trip;
+	}
+
+	bnapi->aim_rx_pkts = 0;
+	bnapi->aim_rx_bytes = 0;
+	bnapi->aim_tx_pkts = 0;
+	bnapi->aim_last = jiffies;
+}
+
 static int bnx2_poll_work(struct bnx2 *bp, struct bnx2_napi *bnapi,
 			  int work_done, int budget)
 {
@@ -4048,13 +4862,20 @@ static int bnx2_poll_work(struct bnx2 *bp, struct bnx2_napi *bnapi,
 
 	if (bnx2_get_hw_tx_cons(bnapi) != txr->hw_tx_cons)
 #if defined(__VMKLNX__)
-		bnx2_tx_int(bp, bnapi, 0, 1);
+		bnapi->aim_tx_pkts += bnx2_tx_int(bp, bnapi, 0, 1);
 #else
-		bnx2_tx_int(bp, bnapi, 0);
+		bnapi->aim_tx_pkts += bnx2_tx_int(bp, bnapi, 0);
 #endif
 
-	if (bnx2_get_hw_rx_cons(bnapi) != rxr->rx_cons)
-		work_done += bnx2_rx_int(bp, bnapi, budget - work_done);
+	if (bnx2_get_hw_rx_cons(bnapi) != rxr->rx_cons) {
+		int rx_done = bnx2_rx_int(bp, bnapi, budget - work_done);
+
+		bnapi->aim_rx_pkts += rx_done;
+		work_done += rx_done;
+	}
+
+	if (bp->adaptive_rx || bp->adaptive_tx)
+		bnx2_adapt_coal(bp, bnapi);
 
 #if defined(__VMKLNX__)
 	wmb();
@@ -4488,11 +5309,87 @@ rv2p_fw_fixup(u32 rv2p_proc, int idx, u32 loc, u32 rv2p_code)
 	return rv2p_code;
 }
 
+/* Number of words written per hold of the register window lock */
+#define BNX2_FW_WR_BURST	256
+
+/* Write a block of words to consecutive indirect register offsets, taking
+ * the register window lock once per burst instead of once per word.  A NULL
+ * buf zero-fills the range.
+ */
 static void
-load_rv2p_fw(struct bnx2 *bp, __le32 *rv2p_code, u32 rv2p_code_len,
+bnx2_reg_wr_ind_blk(struct bnx2 *bp, u32 offset, const u32 *buf, u32 len)
+{
+	u32 i = 0, n = len / 4;
+
+	while (i < n) {
+		u32 end = min_t(u32, n, i + BNX2_FW_WR_BURST);
+
+		spin_lock_bh(&bp->reg_win_lock);
+		for (; i < end; i++, offset += 4) {
+			BNX2_WR(bp, BNX2_PCICFG_REG_WINDOW_ADDRESS, offset);
+			BNX2_WR(bp, BNX2_PCICFG_REG_WINDOW, buf ? buf[i] : 0);
+		}
+		spin_unlock_bh(&bp->reg_win_lock);
+	}
+}
+
+/* Return the decompressed image idx, inflating and caching it in CPU byte
+ * order on first use.  The cache lives until the device is removed.
+ */
+static int
+bnx2_get_fw_img(struct bnx2 *bp, int idx, const u8 *zbuf, int zlen,
+		u32 **img, u32 *img_len)
+{
+	void *text;
+	u32 *buf;
+	int rc, i, text_len;
+
+	if (bp->fw_img[idx])
+		goto done;
+
+	if (!bp->strm) {
+		rc = bnx2_gunzip_init(bp);
+		if (rc)
+			return rc;
+	}
+
+	rc = bnx2_gunzip(bp, zbuf, zlen, &text, &text_len);
+	if (rc)
+		return rc;
+
+	buf = vmalloc(text_len);
+	if (!buf)
+		return -ENOMEM;
+
+	for (i = 0; i < text_len / 4; i++)
+		buf[i] = le32_to_cpu(((__le32 *) text)[i]);
+
+	bp->fw_img[idx] = buf;
+	bp->fw_img_len[idx] = text_len;
+
+done:
+	*img = bp->fw_img[idx];
+	*img_len = bp->fw_img_len[idx];
+	return 0;
+}
+
+static void
+bnx2_free_fw_imgs(struct bnx2 *bp)
+{
+	int i;
+
+	for (i = 0; i < BNX2_FW_IMG_MAX; i++) {
+		vfree(bp->fw_img[i]);
+		bp->fw_img[i] = NULL;
+		bp->fw_img_len[i] = 0;
+	}
+}
+
+static void
+load_rv2p_fw(struct bnx2 *bp, u32 *rv2p_code, u32 rv2p_code_len,
 	u32 rv2p_proc, u32 fixup_loc)
 {
-	__le32 *rv2p_code_start = rv2p_code;
+	u32 *rv2p_code_start = rv2p_code;
 	int i;
 	u32 val, cmd, addr;
 
@@ -4505,9 +5402,9 @@ load_rv2p_fw(struct bnx2 *bp, __le32 *rv2p_code, u32 rv2p_code_len,
 	}
 
 	for (i = 0; i < rv2p_code_len; i += 8) {
-		BNX2_WR(bp, BNX2_RV2P_INSTR_HIGH, le32_to_cpu(*rv2p_code));
+		BNX2_WR(bp, BNX2_RV2P_INSTR_HIGH, *rv2p_code);
 		rv2p_code++;
-		BNX2_WR(bp, BNX2_RV2P_INSTR_LOW, le32_to_cpu(*rv2p_code));
+		BNX2_WR(bp, BNX2_RV2P_INSTR_LOW, *rv2p_code);
 		rv2p_code++;
 
 		val = (i / 8) | cmd;
@@ -4518,9 +5415,9 @@ load_rv2p_fw(struct bnx2 *bp, __le32 *rv2p_code, u32 rv2p_code_len,
 	if (fixup_loc && ((fixup_loc * 4) < rv2p_code_len)) {
 		u32 code;
 
-		code = le32_to_cpu(*(rv2p_code + fixup_loc - 1));
+		code = *(rv2p_code + fixup_loc - 1);
 		BNX2_WR(bp, BNX2_RV2P_INSTR_HIGH, code);
-		code = le32_to_cpu(*(rv2p_code + fixup_loc));
+		code = *(rv2p_code + fixup_loc);
 		code = rv2p_fw_fixup(rv2p_proc, 0, fixup_loc, code);
 		BNX2_WR(bp, BNX2_RV2P_INSTR_LOW, code);
 
@@ -4538,12 +5435,19 @@ load_rv2p_fw(struct bnx2 *bp, __le32 *rv2p_code, u32 rv2p_code_len,
 }
 
 static int
-load_cpu_fw(struct bnx2 *bp, const struct cpu_reg *cpu_reg, struct fw_info *fw)
+load_cpu_fw(struct bnx2 *bp, const struct cpu_reg *cpu_reg, struct fw_info *fw,
+	    int idx)
 {
 	u32 offset;
 	u32 val;
+	u32 *text, text_len;
 	int rc;
 
+	rc = bnx2_get_fw_img(bp, idx, fw->gz_text, fw->gz_text_len, &text,
+			     &text_len);
+	if (rc)
+		return rc;
+
 	/* Halt the CPU. */
 	val = bnx2_reg_rd_ind(bp, cpu_reg->mode);
 	val |= cpu_reg->mode_value_halt;
@@ -4552,65 +5456,29 @@ load_cpu_fw(struct bnx2 *bp, const struct cpu_reg *cpu_reg, struct fw_info *fw)
 
 	/* Load the Text area. */
 	offset = cpu_reg->spad_base + (fw->text_addr - cpu_reg->mips_view_base);
-
-	if (fw->gz_text) {
-		u32 text_len;
-		void *text;
-
-		rc = bnx2_gunzip(bp, fw->gz_text, fw->gz_text_len, &text,
-				 &text_len);
-		if (rc)
-			return rc;
-
-		fw->text = text;
-	}
-	if (fw->text) {
-		int j;
-		for (j = 0; j < (fw->text_len / 4); j++, offset += 4) {
-			bnx2_reg_wr_ind(bp, offset, le32_to_cpu(fw->text[j]));
-	        }
-	}
+	bnx2_reg_wr_ind_blk(bp, offset, text, min_t(u32, text_len,
+						    fw->text_len));
 
 	/* Load the Data area. */
 	offset = cpu_reg->spad_base + (fw->data_addr - cpu_reg->mips_view_base);
-	if (fw->data) {
-		int j;
-
-		for (j = 0; j < (fw->data_len / 4); j++, offset += 4) {
-			bnx2_reg_wr_ind(bp, offset, fw->data[j]);
-		}
-	}
+	if (fw->data)
+		bnx2_reg_wr_ind_blk(bp, offset, fw->data, fw->data_len);
 
 	/* Load the SBSS area. */
 	offset = cpu_reg->spad_base + (fw->sbss_addr - cpu_reg->mips_view_base);
-	if (fw->sbss_len) {
-		int j;
-
-		for (j = 0; j < (fw->sbss_len / 4); j++, offset += 4) {
-			bnx2_reg_wr_ind(bp, offset, 0);
-		}
-	}
+	if (fw->sbss_len)
+		bnx2_reg_wr_ind_blk(bp, offset, NULL, fw->sbss_len);
 
 	/* Load the BSS area. */
 	offset = cpu_reg->spad_base + (fw->bss_addr - cpu_reg->mips_view_base);
-	if (fw->bss_len) {
-		int j;
-
-		for (j = 0; j < (fw->bss_len/4); j++, offset += 4) {
-			bnx2_reg_wr_ind(bp, offset, 0);
-		}
-	}
+	if (fw->bss_len)
+		bnx2_reg_wr_ind_blk(bp, offset, NULL, fw->bss_len);
 
 	/* Load the Read-Only area. */
 	offset = cpu_reg->spad_base +
 		(fw->rodata_addr - cpu_reg->mips_view_base);
-	if (fw->rodata) {
-		int j;
-
-		for (j = 0; j < (fw->rodata_len / 4); j++, offset += 4) {
-			bnx2_reg_wr_ind(bp, offset, fw->rodata[j]);
-		}
-	}
+	if (fw->rodata)
+		bnx2_reg_wr_ind_blk(bp, offset, fw->rodata, fw->rodata_len);
 
 	/* Clear the pre-fetch instruction. */
 	bnx2_reg_wr_ind(bp, cpu_reg->inst, 0);
@@ -4630,13 +5498,10 @@ bnx2_init_cpus(struct bnx2 *bp)
 {
 	struct fw_info *fw;
 	int rc = 0, rv2p_len;
-	void *text;
+	u32 *text;
 	const void *rv2p;
 	u32 text_len, fixup_loc;
 
-	if ((rc = bnx2_gunzip_init(bp)) != 0)
-		return rc;
-
 	/* Initialize the RV2P processor. */
 	if (BNX2_CHIP(bp) == BNX2_CHIP_5709) {
 		if ((BNX2_CHIP_ID(bp) == BNX2_CHIP_ID_5709_A0) ||
@@ -4654,7 +5519,8 @@ bnx2_init_cpus(struct bnx2 *bp)
 		rv2p_len = sizeof(bnx2_rv2p_proc1);
 		fixup_loc = RV2P_PROC1_MAX_BD_PAGE_LOC;
 	}
-	rc = bnx2_gunzip(bp, rv2p, rv2p_len, &text, &text_len);
+	rc = bnx2_get_fw_img(bp, BNX2_FW_IMG_RV2P1, rv2p, rv2p_len, &text,
+			     &text_len);
 	if (rc)
 		goto init_cpu_err;
 
@@ -4676,7 +5542,8 @@ bnx2_init_cpus(struct bnx2 *bp)
 		rv2p_len = sizeof(bnx2_rv2p_proc2);
 		fixup_loc = RV2P_PROC2_MAX_BD_PAGE_LOC;
 	}
-	rc = bnx2_gunzip(bp, rv2p, rv2p_len, &text, &text_len);
+	rc = bnx2_get_fw_img(bp, BNX2_FW_IMG_RV2P2, rv2p, rv2p_len, &text,
+			     &text_len);
 	if (rc)
 		goto init_cpu_err;
 
@@ -4688,7 +5555,7 @@ bnx2_init_cpus(struct bnx2 *bp)
 	else
 		fw = &bnx2_rxp_fw_06;
 
-	rc = load_cpu_fw(bp, &cpu_reg_rxp, fw);
+	rc = load_cpu_fw(bp, &cpu_reg_rxp, fw, BNX2_FW_IMG_RXP);
 	if (rc)
 		goto init_cpu_err;
 
@@ -4698,7 +5565,7 @@ bnx2_init_cpus(struct bnx2 *bp)
 	else
 		fw = &bnx2_txp_fw_06;
 
-	rc = load_cpu_fw(bp, &cpu_reg_txp, fw);
+	rc = load_cpu_fw(bp, &cpu_reg_txp, fw, BNX2_FW_IMG_TXP);
 	if (rc)
 		goto init_cpu_err;
 
@@ -4708,7 +5575,7 @@ bnx2_init_cpus(struct bnx2 *bp)
 	else
 		fw = &bnx2_tpat_fw_06;
 
-	rc = load_cpu_fw(bp, &cpu_reg_tpat, fw);
+	rc = load_cpu_fw(bp, &cpu_reg_tpat, fw, BNX2_FW_IMG_TPAT);
 	if (rc)
 		goto init_cpu_err;
 
@@ -4718,7 +5585,7 @@ bnx2_init_cpus(struct bnx2 *bp)
 	else
 		fw = &bnx2_com_fw_06;
 
-	rc = load_cpu_fw(bp, &cpu_reg_com, fw);
+	rc = load_cpu_fw(bp, &cpu_reg_com, fw, BNX2_FW_IMG_COM);
 	if (rc)
 		goto init_cpu_err;
 
@@ -4728,7 +5595,7 @@ bnx2_init_cpus(struct bnx2 *bp)
 	else
 		fw = &bnx2_cp_fw_06;
 
-	rc = load_cpu_fw(bp, &cpu_reg_cp, fw);
+	rc = load_cpu_fw(bp, &cpu_reg_cp, fw, BNX2_FW_IMG_CP);
 	if (rc)
 		goto init_cpu_err;
 
@@ -4737,7 +5604,9 @@ bnx2_init_cpus(struct bnx2 *bp)
 #endif
 
 init_cpu_err:
-	bnx2_gunzip_end(bp);
+	/* The inflate state is only needed until every image is cached */
+	if (bp->strm)
+		bnx2_gunzip_end(bp);
 	return rc;
 }
 
@@ -5707,6 +6576,7 @@ bnx2_reset_chip(struct bnx2 *bp, u32 reset_code)
 static int
 bnx2_init_chip(struct bnx2 *bp)
 {
+	bnx2_time_t t;
 	u32 val, mtu;
 	int rc, i;
 
@@ -5763,8 +6633,10 @@ bnx2_init_chip(struct bnx2 *bp)
 	} else
 		bnx2_init_context(bp);
 
+	t = bnx2_time_now();
 	if ((rc = bnx2_init_cpus(bp)) != 0)
 		return rc;
+	bp->init_cpus_usecs = bnx2_usecs_since(t);
 
 	bnx2_init_nvram(bp);
 
@@ -5906,6 +6778,7 @@ bnx2_init_chip(struct bnx2 *bp)
 		BNX2_WR(bp, base + BNX2_HC_RX_TICKS_OFF,
 			(bp->rx_ticks_int << 16) | bp->rx_ticks);
 	}
+	bnx2_init_aim(bp);
 
 	/* Clear internal stats counters. */
 	BNX2_WR(bp, BNX2_HC_COMMAND, BNX2_HC_COMMAND_CLR_STAT_NOW);
@@ -5956,6 +6829,64 @@ bnx2_clear_ring_states(struct bnx2 *bp)
 	}
 }
 
+static void
+bnx2_get_ring_stats(struct bnx2_napi *bnapi, struct bnx2_ring_stats *rs)
+{
+	struct bnx2_rx_ring_info *rxr = &bnapi->rx_ring;
+	struct bnx2_tx_ring_info *txr = &bnapi->tx_ring;
+	unsigned int start;
+
+	do {
+		start = u64_stats_fetch_begin(&rxr->rx_syncp);
+		rs->rx_packets = rxr->rx_packets;
+		rs->rx_bytes = rxr->rx_bytes;
+		rs->rx_drops = rxr->rx_drops;
+		rs->rx_buf_alloc_fail = rxr->rx_buf_alloc_fail;
+	} while (u64_stats_fetch_retry(&rxr->rx_syncp, start));
+
+	do {
+		start = u64_stats_fetch_begin(&txr->tx_syncp);
+		rs->tx_packets = txr->tx_packets;
+		rs->tx_bytes = txr->tx_bytes;
+	} while (u64_stats_fetch_retry(&txr->tx_syncp, start));
+
+	do {
+		start = u64_stats_fetch_begin(&txr->tx_drop_syncp);
+		rs->tx_drops = txr->tx_drops;
+	} while (u64_stats_fetch_retry(&txr->tx_drop_syncp, start));
+}
+
+/* The ring counters are kept in bnx2_napi and survive chip resets and
+ * ring count changes.  Like temp_stats_blk, they start over on open.
+ * Called before the rings are filled, with NAPI and xmit stopped.
+ */
+static void
+bnx2_clear_ring_stats(struct bnx2 *bp)
+{
+	int i;
+
+	for (i = 0; i < BNX2_MAX_MSIX_VEC; i++) {
+		struct bnx2_rx_ring_info *rxr = &bp->bnx2_napi[i].rx_ring;
+		struct bnx2_tx_ring_info *txr = &bp->bnx2_napi[i].tx_ring;
+
+		u64_stats_update_begin(&rxr->rx_syncp);
+		rxr->rx_packets = 0;
+		rxr->rx_bytes = 0;
+		rxr->rx_drops = 0;
+		rxr->rx_buf_alloc_fail = 0;
+		u64_stats_update_end(&rxr->rx_syncp);
+
+		u64_stats_update_begin(&txr->tx_syncp);
+		txr->tx_packets = 0;
+		txr->tx_bytes = 0;
+		u64_stats_update_end(&txr->tx_syncp);
+
+		u64_stats_update_begin(&txr->tx_drop_syncp);
+		txr->tx_drops = 0;
+		u64_stats_update_end(&txr->tx_drop_syncp);
+	}
+}
+
 static void
 bnx2_init_tx_context(struct bnx2 *bp, u32 cid, struct bnx2_tx_ring_info *txr)
 {
@@ -6011,6 +6942,8 @@ bnx2_init_tx_ring(struct bnx2 *bp, int ring_num)
 
 	txr->tx_prod = 0;
 	txr->tx_prod_bseq = 0;
+	txr->tx_db_pending = 0;
+	spin_lock_init(&txr->xdp_tx_lock);
 
 	txr->tx_bidx_addr = MB_GET_CID_ADDR(cid) + BNX2_L2CTX_TX_HOST_BIDX;
 	txr->tx_bseq_addr = MB_GET_CID_ADDR(cid) + BNX2_L2CTX_TX_HOST_BSEQ;
@@ -6058,6 +6991,10 @@ bnx2_init_rx_ring(struct bnx2 *bp, int ring_num)
 
 	rx_cid_addr = GET_CID_ADDR(cid);
 
+#ifdef BNX2_XDP
+	rxr->xdp_prog = bp->xdp_prog;
+#endif
+
 	bnx2_init_rxbd_rings(rxr->rx_desc_ring, rxr->rx_desc_mapping,
 			     bp->rx_buf_use_size, bp->rx_max_ring);
 
@@ -6116,7 +7053,11 @@ bnx2_init_rx_ring(struct bnx2 *bp, int ring_num)
 
 	ring_prod = prod = rxr->rx_prod;
 	for (i = 0; i < bp->rx_ring_size; i++) {
+#ifdef BNX2_BUILD_SKB
+		if (bnx2_alloc_rx_data(bp, rxr, ring_prod, GFP_KERNEL) < 0) {
+#else
 		if (bnx2_alloc_rx_skb(bp, rxr, ring_prod, GFP_KERNEL) < 0) {
+#endif
 			netdev_warn(bp->dev, "init'ed rx ring %d with %d/%d skbs only\n",
 				    ring_num, i, bp->rx_ring_size);
 			break;
@@ -6136,14 +7077,61 @@ bnx2_init_rx_ring(struct bnx2 *bp, int ring_num)
 	BNX2_WR(bp, rxr->rx_bseq_addr, rxr->rx_prod_bseq);
 }
 
+#if !defined(BNX2_ENABLE_NETQUEUE)
 static void
-bnx2_init_all_rings(struct bnx2 *bp)
+bnx2_set_rss(struct bnx2 *bp)
 {
+	u32 tbl_32 = 0;
 	int i;
-#if !defined(BNX2_ENABLE_NETQUEUE)
-	u32 val;
+
+	for (i = 0; i < BNX2_RXP_SCRATCH_RSS_TBL_MAX_ENTRIES; i++) {
+		int shift = (i % 8) << 2;
+
+		tbl_32 |= bp->rss_ind_tbl[i] << shift;
+		if ((i % 8) == 7) {
+			BNX2_WR(bp, BNX2_RLUP_RSS_DATA, tbl_32);
+			BNX2_WR(bp, BNX2_RLUP_RSS_COMMAND, (i >> 3) |
+				BNX2_RLUP_RSS_COMMAND_RSS_WRITE_MASK |
+				BNX2_RLUP_RSS_COMMAND_WRITE |
+				BNX2_RLUP_RSS_COMMAND_HASH_MASK);
+			tbl_32 = 0;
+		}
+	}
+
+	BNX2_WR(bp, BNX2_RLUP_RSS_CONFIG, bp->rss_cfg);
+}
+
+/* Called whenever the rx rings are (re)initialized, so that the table
+ * ethtool -x reports always matches the current number of rings.
+ */
+static void
+bnx2_init_rss_tbl(struct bnx2 *bp)
+{
+	int n = bp->num_rx_rings > 1 ? bp->num_rx_rings - 1 : 1;
+	int i;
+
+	/* Keep a user supplied table as long as it still fits the
+	 * current number of RSS rings, otherwise spread evenly.
+	 */
+	if (bp->rss_user_tbl) {
+		for (i = 0; i < BNX2_RXP_SCRATCH_RSS_TBL_MAX_ENTRIES; i++)
+			if (bp->rss_ind_tbl[i] >= n)
+				break;
+		if (i == BNX2_RXP_SCRATCH_RSS_TBL_MAX_ENTRIES)
+			return;
+		bp->rss_user_tbl = 0;
+	}
+
+	for (i = 0; i < BNX2_RXP_SCRATCH_RSS_TBL_MAX_ENTRIES; i++)
+		bp->rss_ind_tbl[i] = i % n;
+}
 #endif
 
+static void
+bnx2_init_all_rings(struct bnx2 *bp)
+{
+	int i;
+
 	bnx2_clear_ring_states(bp);
 
 	BNX2_WR(bp, BNX2_TSCH_TSS_CFG, 0);
@@ -6161,29 +7149,9 @@ bnx2_init_all_rings(struct bnx2 *bp)
 		bnx2_init_rx_ring(bp, i);
 
 #if !defined(BNX2_ENABLE_NETQUEUE)
-	if (bp->num_rx_rings > 1) {
-		u32 tbl_32 = 0;
-
-		for (i = 0; i < BNX2_RXP_SCRATCH_RSS_TBL_MAX_ENTRIES; i++) {
-			int shift = (i % 8) << 2;
-
-			tbl_32 |= (i % (bp->num_rx_rings - 1)) << shift;
-			if ((i % 8) == 7) {
-				BNX2_WR(bp, BNX2_RLUP_RSS_DATA, tbl_32);
-				BNX2_WR(bp, BNX2_RLUP_RSS_COMMAND, (i >> 3) |
-					BNX2_RLUP_RSS_COMMAND_RSS_WRITE_MASK |
-					BNX2_RLUP_RSS_COMMAND_WRITE |
-					BNX2_RLUP_RSS_COMMAND_HASH_MASK);
-				tbl_32 = 0;
-			}
-		}
-
-		val = BNX2_RLUP_RSS_CONFIG_IPV4_RSS_TYPE_ALL_XI |
-		      BNX2_RLUP_RSS_CONFIG_IPV6_RSS_TYPE_ALL_XI;
-
-		BNX2_WR(bp, BNX2_RLUP_RSS_CONFIG, val);
-
-	}
+	bnx2_init_rss_tbl(bp);
+	if (bp->num_rx_rings > 1)
+		bnx2_set_rss(bp);
 #endif
 }
 
@@ -6211,13 +7179,26 @@ bnx2_set_rx_ring_size(struct bnx2 *bp, u32 size)
 {
 	u32 rx_size, rx_space;
 
+	bp->rx_copy_thresh = BNX2_RX_COPY_THRESH;
+	bp->rx_headroom = NET_SKB_PAD;
+	bp->rx_dma_dir = PCI_DMA_FROMDEVICE;
+#ifdef BNX2_XDP
+	/* XDP gets the standard headroom, and XDP_TX sends straight from the
+	 * rx buffer.  Every frame is built in place, never copied.
+	 */
+	if (bp->xdp_prog) {
+		bp->rx_copy_thresh = 0;
+		bp->rx_headroom = XDP_PACKET_HEADROOM;
+		bp->rx_dma_dir = PCI_DMA_BIDIRECTIONAL;
+	}
+#endif
+
 	/* 8 for CRC and VLAN */
 	rx_size = bp->dev->mtu + ETH_HLEN + BNX2_RX_OFFSET + 8;
 
-	rx_space = SKB_DATA_ALIGN(rx_size + BNX2_RX_ALIGN) + NET_SKB_PAD +
+	rx_space = SKB_DATA_ALIGN(rx_size + BNX2_RX_ALIGN) + bp->rx_headroom +
 		sizeof(struct skb_shared_info);
 
-	bp->rx_copy_thresh = BNX2_RX_COPY_THRESH;
 	bp->rx_pg_ring_size = 0;
 	bp->rx_max_pg_ring = 0;
 	bp->rx_max_pg_ring_idx = 0;
@@ -6240,8 +7221,16 @@ bnx2_set_rx_ring_size(struct bnx2 *bp, u32 size)
 #endif
 
 	bp->rx_buf_use_size = rx_size;
+#ifdef BNX2_BUILD_SKB
+	/* hw alignment, headroom and the skb_shared_info build_skb() needs */
+	bp->rx_buf_size = SKB_DATA_ALIGN(bp->rx_buf_use_size + BNX2_RX_ALIGN +
+					 bp->rx_headroom) +
+			  SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+	bp->rx_frag_size = (bp->rx_buf_size <= PAGE_SIZE) ? bp->rx_buf_size : 0;
+#else
 	/* hw alignment */
 	bp->rx_buf_size = bp->rx_buf_use_size + BNX2_RX_ALIGN;
+#endif
 	bp->rx_jumbo_thresh = rx_size - BNX2_RX_OFFSET;
 	bp->rx_ring_size = size;
 	bp->rx_max_ring = bnx2_find_max_ring(size, BNX2_MAX_RX_RINGS);
@@ -6267,6 +7256,10 @@ bnx2_free_tx_skbs(struct bnx2 *bp)
 			int k, last;
 
 			if (skb == NULL) {
+#ifdef BNX2_XDP
+				if (tx_buf->xdpf)
+					bnx2_xdp_free_tx_buf(bp, tx_buf);
+#endif
 				j = BNX2_NEXT_TX_BD(j);
 				continue;
 			}
@@ -6297,6 +7290,13 @@ bnx2_free_tx_skbs(struct bnx2 *bp)
 			}
 			dev_kfree_skb(skb);
 		}
+#ifdef BNX2_XDP
+		if (bnx2_is_xdp_tx_ring(bp, bnapi))
+			continue;
+#endif
+#ifdef BCM_HAVE_MULTI_QUEUE
+		netdev_tx_reset_queue(netdev_get_tx_queue(bp->dev, i));
+#endif
 	}
 }
 
@@ -6315,10 +7315,17 @@ bnx2_free_rx_skbs(struct bnx2 *bp)
 
 		for (j = 0; j < bp->rx_max_ring_idx; j++) {
 			struct bnx2_sw_bd *rx_buf = &rxr->rx_buf_ring[j];
+#ifdef BNX2_BUILD_SKB
+			u8 *data = rx_buf->data;
+
+			if (data == NULL)
+				continue;
+#else
 			struct sk_buff *skb = rx_buf->skb;
 
 			if (skb == NULL)
 				continue;
+#endif
 
 #if (LINUX_VERSION_CODE >= 0x02061b)
 			dma_unmap_single(&bp->pdev->dev,
@@ -6327,14 +7334,21 @@ bnx2_free_rx_skbs(struct bnx2 *bp)
 #endif
 					 dma_unmap_addr(rx_buf, mapping),
 					 bp->rx_buf_use_size,
-					 PCI_DMA_FROMDEVICE);
+					 bp->rx_dma_dir);
 
+#ifdef BNX2_BUILD_SKB
+			rx_buf->data = NULL;
+
+			bnx2_frag_free(bp, data);
+#else
 			rx_buf->skb = NULL;
 
 			dev_kfree_skb(skb);
+#endif
 		}
 		for (j = 0; j < bp->rx_max_pg_ring_idx; j++)
 			bnx2_free_rx_page(bp, rxr, j);
+		bnx2_rx_pg_cache_drain(bp, rxr);
 	}
 }
 
@@ -6348,17 +7362,26 @@ bnx2_free_skbs(struct bnx2 *bp)
 static int
 bnx2_reset_nic(struct bnx2 *bp, u32 reset_code)
 {
+	bnx2_time_t start, t;
 	int rc;
 
+	start = t = bnx2_time_now();
 	rc = bnx2_reset_chip(bp, reset_code);
+	bp->reset_chip_usecs = bnx2_usecs_since(t);
 	bnx2_free_skbs(bp);
 	if (rc)
 		return rc;
 
+	t = bnx2_time_now();
 	if ((rc = bnx2_init_chip(bp)) != 0)
 		return rc;
+	/* Firmware load is reported on its own */
+	bp->init_chip_usecs = bnx2_usecs_since(t) - bp->init_cpus_usecs;
 
+	t = bnx2_time_now();
 	bnx2_init_all_rings(bp);
+	bp->init_rings_usecs = bnx2_usecs_since(t);
+	bp->reset_usecs = bnx2_usecs_since(start);
 	return 0;
 }
 
@@ -6637,8 +7660,8 @@ static int
 bnx2_run_loopback(struct bnx2 *bp, int loopback_mode)
 {
 	unsigned int pkt_size, num_pkts, i;
-	struct sk_buff *skb, *rx_skb;
-	unsigned char *packet;
+	struct sk_buff *skb;
+	unsigned char *packet, *rx_data;
 	u16 rx_start_idx, rx_idx;
 	dma_addr_t map;
 	struct bnx2_tx_bd *txbd;
@@ -6739,10 +7762,8 @@ bnx2_run_loopback(struct bnx2 *bp, int loopback_mode)
 	}
 
 	rx_buf = &rxr->rx_buf_ring[rx_start_idx];
-	rx_skb = rx_buf->skb;
-
 	rx_hdr = rx_buf->desc;
-	skb_reserve(rx_skb, BNX2_RX_OFFSET);
+	rx_data = (unsigned char *) rx_hdr + BNX2_RX_OFFSET;
 
 #if (LINUX_VERSION_CODE >= 0x02061b)
 	dma_sync_single_for_cpu(&bp->pdev->dev,
@@ -6750,7 +7771,7 @@ bnx2_run_loopback(struct bnx2 *bp, int loopback_mode)
 	pci_dma_sync_single_for_cpu(bp->pdev,
 #endif
 		dma_unmap_addr(rx_buf, mapping),
-		bp->rx_buf_size, PCI_DMA_FROMDEVICE);
+		bp->rx_buf_use_size, bp->rx_dma_dir);
 
 	if (rx_hdr->l2_fhdr_status &
 		(L2_FHDR_ERRORS_BAD_CRC |
@@ -6767,7 +7788,7 @@ bnx2_run_loopback(struct bnx2 *bp, int loopback_mode)
 	}
 
 	for (i = 14; i < pkt_size; i++) {
-		if (*(rx_skb->data + i) != (unsigned char) (i & 0xff)) {
+		if (*(rx_data + i) != (unsigned char) (i & 0xff)) {
 			goto loopback_test_done;
 		}
 	}
@@ -7074,6 +8095,49 @@ bnx2_restart_timer:
 	mod_timer(&bp->timer, jiffies + bp->current_interval);
 }
 
+#ifdef BNX2_XPS
+/* Spread the MSI-X vectors over the CPUs closest to the device and have
+ * XPS send from each CPU on the tx ring whose vector runs there, so tx
+ * completions are handled on the CPU that queued the packets.  The XPS
+ * maps are only (re)built on the first open and when the number of stack
+ * tx rings changes, so that maps set through xps_cpus survive MTU, ring
+ * size, coalescing and XDP changes.
+ */
+static void
+bnx2_set_xps(struct bnx2 *bp)
+{
+	int node = dev_to_node(&bp->pdev->dev);
+	int ncpus = num_online_cpus();
+	int ntx = bp->num_tx_rings - bp->num_xdp_tx_rings;
+	cpumask_var_t mask;
+	int i, j;
+
+	if (!(bp->flags & BNX2_FLAG_USING_MSIX))
+		return;
+
+	for (i = 0; i < bp->irq_nvecs; i++) {
+		int cpu = cpumask_local_spread(i, node);
+
+		irq_set_affinity_hint(bp->irq_tbl[i].vector, get_cpu_mask(cpu));
+	}
+
+	if (ntx == bp->xps_tx_rings)
+		return;
+
+	if (!zalloc_cpumask_var(&mask, GFP_KERNEL))
+		return;
+
+	for (i = 0; i < ntx; i++) {
+		cpumask_clear(mask);
+		for (j = i; j < max(ncpus, ntx); j += ntx)
+			cpumask_set_cpu(cpumask_local_spread(j, node), mask);
+		netif_set_xps_queue(bp->dev, mask, i);
+	}
+	free_cpumask_var(mask);
+	bp->xps_tx_rings = ntx;
+}
+#endif
+
 static int
 bnx2_request_irq(struct bnx2 *bp)
 {
@@ -7109,6 +8173,10 @@ bnx2_request_irq(struct bnx2 *bp)
 			break;
 		irq->requested = 1;
 	}
+#ifdef BNX2_XPS
+	if (!rc)
+		bnx2_set_xps(bp);
+#endif
 	return rc;
 }
 
@@ -7136,8 +8204,13 @@ __bnx2_free_irq(struct bnx2 *bp)
 
 	for (i = 0; i < bp->irq_nvecs; i++) {
 		irq = &bp->irq_tbl[i];
-		if (irq->requested)
+		if (irq->requested) {
+#ifdef BNX2_XPS
+			if (bp->flags & BNX2_FLAG_USING_MSIX)
+				irq_set_affinity_hint(irq->vector, NULL);
+#endif
 			free_irq(irq->vector, &bp->bnx2_napi[i]);
+		}
 		irq->requested = 0;
 	}
 }
@@ -7257,6 +8330,7 @@ bnx2_setup_int_mode(struct bnx2 *bp, int dis_msi)
 #else
 	int cpus = num_online_cpus();
 	int msix_vecs;
+	int tx_vecs;
 #endif /* defined(__VMKLNX__) */
 #endif
 #endif
@@ -7269,6 +8343,11 @@ bnx2_setup_int_mode(struct bnx2 *bp, int dis_msi)
 	else
 		msix_vecs = max(bp->num_req_rx_rings, bp->num_req_tx_rings);
 
+#ifdef BNX2_XDP
+	/* one more vector for the XDP tx ring */
+	if (bp->xdp_prog)
+		msix_vecs++;
+#endif
 	msix_vecs = min(msix_vecs, RX_MAX_RINGS);
 #endif
 	bp->irq_tbl[0].handler = bnx2_interrupt;
@@ -7316,17 +8395,38 @@ bnx2_setup_int_mode(struct bnx2 *bp, int dis_msi)
 #endif
 	bp->num_rx_rings = bp->irq_nvecs;
 #else
+	tx_vecs = bp->irq_nvecs;
+	bp->num_xdp_tx_rings = 0;
+#ifdef BNX2_XDP
+	/* XDP_TX and ndo_xdp_xmit() get a tx ring of their own, on the
+	 * vector right after the stack's tx rings.
+	 */
+	if (bp->xdp_prog && bp->irq_nvecs > 1) {
+		tx_vecs--;
+		bp->num_xdp_tx_rings = 1;
+	}
+#endif
 	if (!bp->num_req_tx_rings)
-		bp->num_tx_rings = rounddown_pow_of_two(bp->irq_nvecs);
+		bp->num_tx_rings = rounddown_pow_of_two(tx_vecs);
 	else
-		bp->num_tx_rings = min(bp->irq_nvecs, bp->num_req_tx_rings);
+		bp->num_tx_rings = min(tx_vecs, bp->num_req_tx_rings);
 
 	if (!bp->num_req_rx_rings)
 		bp->num_rx_rings = bp->irq_nvecs;
 	else
 		bp->num_rx_rings = min(bp->irq_nvecs, bp->num_req_rx_rings);
+#endif
+#ifdef BNX2_XDP
+	/* Without a vector of its own there is no XDP tx ring; refuse to run
+	 * the program rather than fail every XDP_TX and redirect.
+	 */
+	if (bp->xdp_prog && !bp->num_xdp_tx_rings) {
+		netdev_err(bp->dev, "No MSI-X vector available for the XDP tx ring\n");
+		return -ENOSPC;
+	}
 #endif
 	netif_set_real_num_tx_queues(bp->dev, bp->num_tx_rings);
+	bp->num_tx_rings += bp->num_xdp_tx_rings;
 #endif
 	return netif_set_real_num_rx_queues(bp->dev, bp->num_rx_rings);
 }
@@ -7356,6 +8456,8 @@ bnx2_open(struct net_device *dev)
 	if (rc)
 		goto open_err;
 
+	bnx2_clear_ring_stats(bp);
+
 	rc = bnx2_init_nic(bp, 1);
 	if (rc)
 		goto open_err;
@@ -7413,6 +8515,9 @@ bnx2_open(struct net_device *dev)
 		bnx2_open_netqueue_hw(bp);
 #endif
 
+#ifdef BNX2_XDP
+	bnx2_xdp_tx_start(bp);
+#endif
 	netif_tx_start_all_queues(dev);
 
 #if defined(__VMKLNX__)
@@ -7694,6 +8799,14 @@ bnx2_vlan_rx_kill_vid(struct net_device *dev, uint16_t vid)
 #endif
 #endif
 
+static inline void
+bnx2_tx_drop(struct bnx2_tx_ring_info *txr)
+{
+	u64_stats_update_begin(&txr->tx_drop_syncp);
+	txr->tx_drops++;
+	u64_stats_update_end(&txr->tx_drop_syncp);
+}
+
 /* Called with netif_tx_lock.
  * bnx2_tx_int() runs without netif_tx_lock unless it needs to call
  * netif_wake_queue().
@@ -7748,6 +8861,8 @@ bnx2_start_xmit(struct sk_buff *skb, struct net_device *dev)
 #endif
 		netdev_err(dev, "BUG! Tx ring full when queue awake!\n");
 
+		if (txr->tx_db_pending)
+			bnx2_tx_doorbell(bp, txr);
 		return NETDEV_TX_BUSY;
 	}
 	len = skb_headlen(skb);
@@ -7824,6 +8939,9 @@ abort_tso:
 	if (pci_dma_mapping_error(mapping)) {
 #endif
 		dev_kfree_skb(skb);
+		bnx2_tx_drop(txr);
+		if (txr->tx_db_pending)
+			bnx2_tx_doorbell(bp, txr);
 		return NETDEV_TX_OK;
 	}
 
@@ -7869,18 +8987,14 @@ abort_tso:
 	}
 	txbd->tx_bd_vlan_tag_flags |= TX_BD_FLAGS_END;
 
-	/* Sync BD data before updating TX mailbox */
-	wmb();
-
 	prod = BNX2_NEXT_TX_BD(prod);
 	txr->tx_prod_bseq += skb->len;
-
-	BNX2_WR16(bp, txr->tx_bidx_addr, prod);
-	BNX2_WR(bp, txr->tx_bseq_addr, txr->tx_prod_bseq);
-
-	mmiowb();
-
 	txr->tx_prod = prod;
+	txr->tx_db_pending++;
+	txr->tx_db_pkts++;
+#ifdef BCM_HAVE_MULTI_QUEUE
+	netdev_tx_sent_queue(txq, skb->len);
+#endif
 #if (LINUX_VERSION_CODE <= 0x2061e) || defined(__VMKLNX__)
 	dev->trans_start = jiffies;
 #endif
@@ -7896,6 +9010,9 @@ abort_tso:
 #else
 		netif_tx_stop_queue(txq);
 #endif
+		/* Nothing more is coming until the queue is woken */
+		bnx2_tx_doorbell(bp, txr);
+
 		/* netif_tx_stop_queue() must be done before checking
 		 * tx index in bnx2_tx_avail() below, because in
 		 * bnx2_tx_int(), we update tx index before checking for
@@ -7908,6 +9025,13 @@ abort_tso:
 #else
 			netif_tx_wake_queue(txq);
 #endif
+	} else if (!bnx2_xmit_more(skb) ||
+#ifdef BCM_HAVE_MULTI_QUEUE
+		   /* BQL stopped the queue, nothing else is coming */
+		   netif_xmit_stopped(txq) ||
+#endif
+		   txr->tx_db_pending >= BNX2_TX_DB_MAX_DEFER) {
+		bnx2_tx_doorbell(bp, txr);
 	}
 
 	return NETDEV_TX_OK;
@@ -7943,6 +9067,9 @@ dma_error:
 	}
 
 	dev_kfree_skb(skb);
+	bnx2_tx_drop(txr);
+	if (txr->tx_db_pending)
+		bnx2_tx_doorbell(bp, txr);
 	return NETDEV_TX_OK;
 }
 
@@ -7955,6 +9082,9 @@ bnx2_close(struct net_device *dev)
 #if defined(__VMKLNX__)
 	bnx2_cnic_stop(bp);
 #endif /* defined(__VMKLNX__) */
+#ifdef BNX2_XDP
+	bnx2_xdp_tx_stop(bp);
+#endif
 	bnx2_disable_int_sync(bp);
 #ifdef BNX2_NEW_NAPI
 	bnx2_napi_disable(bp);
@@ -8028,34 +9158,16 @@ bnx2_save_stats(struct bnx2 *bp)
 	(unsigned long) (bp->stats_blk->ctr +			\
 			 bp->temp_stats_blk->ctr)
 
-static struct net_device_stats *
-bnx2_get_stats(struct net_device *dev)
-{
-	struct bnx2 *bp = netdev_priv(dev);
-	struct net_device_stats *net_stats = &bp->net_stats;
-
-	if (bp->stats_blk == NULL)
-		return net_stats;
-
-	net_stats->rx_packets =
-		GET_64BIT_NET_STATS(stat_IfHCInUcastPkts) +
-		GET_64BIT_NET_STATS(stat_IfHCInMulticastPkts) +
-		GET_64BIT_NET_STATS(stat_IfHCInBroadcastPkts);
-
-	net_stats->tx_packets =
-		GET_64BIT_NET_STATS(stat_IfHCOutUcastPkts) +
-		GET_64BIT_NET_STATS(stat_IfHCOutMulticastPkts) +
-		GET_64BIT_NET_STATS(stat_IfHCOutBroadcastPkts);
-
-	net_stats->rx_bytes =
-		GET_64BIT_NET_STATS(stat_IfHCInOctets);
-
-	net_stats->tx_bytes =
-		GET_64BIT_NET_STATS(stat_IfHCOutOctets);
-
-	net_stats->multicast =
-		GET_64BIT_NET_STATS(stat_IfHCInMulticastPkts);
+#ifdef BNX2_STATS64
+#define BNX2_NET_STATS	struct rtnl_link_stats64
+#else
+#define BNX2_NET_STATS	struct net_device_stats
+#endif
 
+/* Error counters, only known to the chip; shared by both stats paths */
+static void
+bnx2_get_err_stats(struct bnx2 *bp, BNX2_NET_STATS *net_stats)
+{
 	net_stats->collisions =
 		GET_32BIT_NET_STATS(stat_EtherStatsCollisions);
 
@@ -8073,34 +9185,115 @@ bnx2_get_stats(struct net_device *dev)
 	net_stats->rx_crc_errors =
 		GET_32BIT_NET_STATS(stat_Dot3StatsFCSErrors);
 
-	net_stats->rx_errors = net_stats->rx_length_errors +
-		net_stats->rx_over_errors + net_stats->rx_frame_errors +
-		net_stats->rx_crc_errors;
+	net_stats->rx_errors = net_stats->rx_length_errors +
+		net_stats->rx_over_errors + net_stats->rx_frame_errors +
+		net_stats->rx_crc_errors;
+
+	net_stats->tx_aborted_errors =
+		GET_32BIT_NET_STATS(stat_Dot3StatsExcessiveCollisions) +
+		GET_32BIT_NET_STATS(stat_Dot3StatsLateCollisions);
+
+	if ((BNX2_CHIP(bp) == BNX2_CHIP_5706) ||
+	    (BNX2_CHIP_ID(bp) == BNX2_CHIP_ID_5708_A0))
+		net_stats->tx_carrier_errors = 0;
+	else {
+		net_stats->tx_carrier_errors =
+			GET_32BIT_NET_STATS(stat_Dot3StatsCarrierSenseErrors);
+	}
+
+	net_stats->tx_errors =
+		GET_32BIT_NET_STATS(stat_emac_tx_stat_dot3statsinternalmactransmiterrors) +
+		net_stats->tx_aborted_errors +
+		net_stats->tx_carrier_errors;
+
+	net_stats->rx_missed_errors =
+		GET_32BIT_NET_STATS(stat_IfInFTQDiscards) +
+		GET_32BIT_NET_STATS(stat_IfInMBUFDiscards) +
+		GET_32BIT_NET_STATS(stat_FwRxDrop);
+}
+
+#ifdef BNX2_STATS64
+#define GET_64BIT_NET_STATS_U64(ctr)				\
+	(((u64) bp->stats_blk->ctr##_hi << 32) +		\
+	 bp->stats_blk->ctr##_lo +				\
+	 ((u64) bp->temp_stats_blk->ctr##_hi << 32) +		\
+	 bp->temp_stats_blk->ctr##_lo)
+
+/* Packet and byte counts come from the per-ring software counters, which
+ * are current, instead of the statistics block that the chip only DMAs
+ * every stats_ticks.  Errors are only known to the chip.
+ */
+#if (LINUX_VERSION_CODE >= 0x040b00)
+static void
+#else
+static struct rtnl_link_stats64 *
+#endif
+bnx2_get_stats64(struct net_device *dev, struct rtnl_link_stats64 *net_stats)
+{
+	struct bnx2 *bp = netdev_priv(dev);
+	struct bnx2_ring_stats rs;
+	int i;
+
+	for (i = 0; i < BNX2_MAX_MSIX_VEC; i++) {
+		bnx2_get_ring_stats(&bp->bnx2_napi[i], &rs);
+
+		net_stats->rx_packets += rs.rx_packets;
+		net_stats->rx_bytes += rs.rx_bytes;
+		net_stats->rx_dropped += rs.rx_drops;
+		net_stats->tx_packets += rs.tx_packets;
+		net_stats->tx_bytes += rs.tx_bytes;
+		net_stats->tx_dropped += rs.tx_drops;
+	}
+
+	if (bp->stats_blk == NULL)
+		goto done;
+
+	net_stats->multicast =
+		GET_64BIT_NET_STATS_U64(stat_IfHCInMulticastPkts);
+
+	bnx2_get_err_stats(bp, net_stats);
+
+done:
+#if (LINUX_VERSION_CODE < 0x040b00)
+	return net_stats;
+#else
+	return;
+#endif
+}
+#else
+static struct net_device_stats *
+bnx2_get_stats(struct net_device *dev)
+{
+	struct bnx2 *bp = netdev_priv(dev);
+	struct net_device_stats *net_stats = &bp->net_stats;
+
+	if (bp->stats_blk == NULL)
+		return net_stats;
+
+	net_stats->rx_packets =
+		GET_64BIT_NET_STATS(stat_IfHCInUcastPkts) +
+		GET_64BIT_NET_STATS(stat_IfHCInMulticastPkts) +
+		GET_64BIT_NET_STATS(stat_IfHCInBroadcastPkts);
+
+	net_stats->tx_packets =
+		GET_64BIT_NET_STATS(stat_IfHCOutUcastPkts) +
+		GET_64BIT_NET_STATS(stat_IfHCOutMulticastPkts) +
+		GET_64BIT_NET_STATS(stat_IfHCOutBroadcastPkts);
 
-	net_stats->tx_aborted_errors =
-		GET_32BIT_NET_STATS(stat_Dot3StatsExcessiveCollisions) +
-		GET_32BIT_NET_STATS(stat_Dot3StatsLateCollisions);
+	net_stats->rx_bytes =
+		GET_64BIT_NET_STATS(stat_IfHCInOctets);
 
-	if ((BNX2_CHIP(bp) == BNX2_CHIP_5706) ||
-	    (BNX2_CHIP_ID(bp) == BNX2_CHIP_ID_5708_A0))
-		net_stats->tx_carrier_errors = 0;
-	else {
-		net_stats->tx_carrier_errors =
-			GET_32BIT_NET_STATS(stat_Dot3StatsCarrierSenseErrors);
-	}
+	net_stats->tx_bytes =
+		GET_64BIT_NET_STATS(stat_IfHCOutOctets);
 
-	net_stats->tx_errors =
-		GET_32BIT_NET_STATS(stat_emac_tx_stat_dot3statsinternalmactransmiterrors) +
-		net_stats->tx_aborted_errors +
-		net_stats->tx_carrier_errors;
+	net_stats->multicast =
+		GET_64BIT_NET_STATS(stat_IfHCInMulticastPkts);
 
-	net_stats->rx_missed_errors =
-		GET_32BIT_NET_STATS(stat_IfInFTQDiscards) +
-		GET_32BIT_NET_STATS(stat_IfInMBUFDiscards) +
-		GET_32BIT_NET_STATS(stat_FwRxDrop);
+	bnx2_get_err_stats(bp, net_stats);
 
 	return net_stats;
 }
+#endif
 
 /* All ethtool functions called with rtnl_lock */
 
@@ -8502,6 +9695,9 @@ bnx2_get_coalesce(struct net_device *dev, struct ethtool_coalesce *coal)
 
 	coal->stats_block_coalesce_usecs = bp->stats_ticks;
 
+	coal->use_adaptive_rx_coalesce = bp->adaptive_rx;
+	coal->use_adaptive_tx_coalesce = bp->adaptive_tx;
+
 	return 0;
 }
 
@@ -8536,6 +9732,9 @@ bnx2_set_coalesce(struct net_device *dev, struct ethtool_coalesce *coal)
 	if (bp->tx_quick_cons_trip_int > 0xff) bp->tx_quick_cons_trip_int =
 		0xff;
 
+	bp->adaptive_rx = !!coal->use_adaptive_rx_coalesce;
+	bp->adaptive_tx = !!coal->use_adaptive_tx_coalesce;
+
 	bp->stats_ticks = coal->stats_block_coalesce_usecs;
 	if (bp->flags & BNX2_FLAG_BROKEN_STATS) {
 		if (bp->stats_ticks != 0 && bp->stats_ticks != USEC_PER_SEC)
@@ -8876,6 +10075,19 @@ static struct {
 	{ "rx_ftq_discards" },
 	{ "rx_discards" },
 	{ "rx_fw_discards" },
+	{ "rx_buf_alloc" },
+	{ "rx_buf_alloc_fail" },
+	{ "rx_buf_recycle" },
+	{ "tx_doorbells" },
+	{ "tx_pkts_per_doorbell" },
+	{ "rx_pg_recycle" },
+	{ "rx_pg_alloc" },
+	{ "rx_pg_recycle_pct" },
+	{ "reset_chip_usecs" },
+	{ "init_cpus_usecs" },
+	{ "init_chip_usecs" },
+	{ "init_rings_usecs" },
+	{ "reset_usecs" },
 #if defined(BNX2_ENABLE_NETQUEUE)
 	{ "[0] rx_packets" },
 	{ "[0] rx_bytes" },
@@ -8927,8 +10139,53 @@ static struct {
 
 #define BNX2_NUM_STATS ARRAY_SIZE(bnx2_stats_str_arr)
 
+/* Driver rx buffer, tx doorbell and jumbo page cache counters and the last
+ * reset's phase timings following the chip statistics
+ */
+#define BNX2_NUM_SW_STATS 13
+
 #if defined(BNX2_ENABLE_NETQUEUE)
 #define BNX2_NUM_NETQ_STATS 45
+#define BNX2_NUM_HW_STATS \
+	(BNX2_NUM_STATS - BNX2_NUM_SW_STATS - BNX2_NUM_NETQ_STATS)
+#else
+#define BNX2_NUM_HW_STATS (BNX2_NUM_STATS - BNX2_NUM_SW_STATS)
+#endif
+
+#if !defined(BNX2_ENABLE_NETQUEUE)
+/* Per-ring counters, reported as "[<ring>] <name>" after the fixed
+ * statistics for every vector that has an rx or a tx ring.
+ */
+static struct {
+	char string[ETH_GSTRING_LEN];
+} bnx2_ring_stats_str_arr[] = {
+	{ "rx_packets" },
+	{ "rx_bytes" },
+	{ "rx_drops" },
+	{ "rx_buf_alloc_fail" },
+	{ "tx_packets" },
+	{ "tx_bytes" },
+	{ "tx_drops" },
+#ifdef BNX2_XDP
+	{ "rx_xdp_drop" },
+	{ "rx_xdp_tx" },
+	{ "rx_xdp_redirect" },
+	{ "rx_xdp_aborted" },
+	{ "tx_xdp_xmit" },
+	{ "tx_xdp_xmit_err" },
+#endif
+};
+
+#define BNX2_NUM_RING_STATS ARRAY_SIZE(bnx2_ring_stats_str_arr)
+
+static int
+bnx2_num_stats(struct bnx2 *bp)
+{
+	return BNX2_NUM_STATS + BNX2_NUM_RING_STATS *
+	       max_t(int, bp->num_rx_rings, bp->num_tx_rings);
+}
+#else
+#define bnx2_num_stats(bp) BNX2_NUM_STATS
 #endif
 
 #define STATS_OFFSET32(offset_name) (offsetof(struct statistics_block, offset_name) / 4)
@@ -9023,7 +10280,7 @@ bnx2_get_sset_count(struct net_device *dev, int sset)
 	case ETH_SS_TEST:
 		return BNX2_NUM_TESTS;
 	case ETH_SS_STATS:
-		return BNX2_NUM_STATS;
+		return bnx2_num_stats(netdev_priv(dev));
 	default:
 		return -EOPNOTSUPP;
 	}
@@ -9094,10 +10351,27 @@ bnx2_self_test(struct net_device *dev, struct ethtool_test *etest, u64 *buf)
 static void
 bnx2_get_strings(struct net_device *dev, u32 stringset, u8 *buf)
 {
+#if !defined(BNX2_ENABLE_NETQUEUE)
+	struct bnx2 *bp = netdev_priv(dev);
+	int i, j;
+#endif
+
 	switch (stringset) {
 	case ETH_SS_STATS:
 		memcpy(buf, bnx2_stats_str_arr,
 			sizeof(bnx2_stats_str_arr));
+#if !defined(BNX2_ENABLE_NETQUEUE)
+		buf += sizeof(bnx2_stats_str_arr);
+		for (i = 0; i < max_t(int, bp->num_rx_rings,
+				      bp->num_tx_rings); i++) {
+			for (j = 0; j < BNX2_NUM_RING_STATS; j++) {
+				snprintf((char *) buf, ETH_GSTRING_LEN,
+					 "[%d] %s", i,
+					 bnx2_ring_stats_str_arr[j].string);
+				buf += ETH_GSTRING_LEN;
+			}
+		}
+#endif
 		break;
 	case ETH_SS_TEST:
 		memcpy(buf, bnx2_tests_str_arr,
@@ -9110,7 +10384,7 @@ bnx2_get_strings(struct net_device *dev, u32 stringset, u8 *buf)
 static int
 bnx2_get_stats_count(struct net_device *dev)
 {
-	return BNX2_NUM_STATS;
+	return bnx2_num_stats(netdev_priv(dev));
 }
 #endif
 
@@ -9119,13 +10393,16 @@ bnx2_get_ethtool_stats(struct net_device *dev,
 		struct ethtool_stats *stats, u64 *buf)
 {
 	struct bnx2 *bp = netdev_priv(dev);
-	int i;
+	int i, j;
+	unsigned long tx_db_pkts = 0, tx_db_writes = 0;
+	unsigned long pg_hit = 0, pg_miss = 0;
+	struct bnx2_ring_stats rs;
 	u32 *hw_stats = (u32 *) bp->stats_blk;
 	u32 *temp_stats = (u32 *) bp->temp_stats_blk;
 	u8 *stats_len_arr = NULL;
 
 	if (hw_stats == NULL) {
-		memset(buf, 0, sizeof(u64) * BNX2_NUM_STATS);
+		memset(buf, 0, sizeof(u64) * bnx2_num_stats(bp));
 		return;
 	}
 
@@ -9137,11 +10414,7 @@ bnx2_get_ethtool_stats(struct net_device *dev,
 	else
 		stats_len_arr = bnx2_5708_stats_len_arr;
 
-#if defined(BNX2_ENABLE_NETQUEUE)
-	for (i = 0; i < BNX2_NUM_STATS - BNX2_NUM_NETQ_STATS; i++) {
-#else
-	for (i = 0; i < BNX2_NUM_STATS; i++) {
-#endif
+	for (i = 0; i < BNX2_NUM_HW_STATS; i++) {
 		unsigned long offset;
 
 		if (stats_len_arr[i] == 0) {
@@ -9164,20 +10437,73 @@ bnx2_get_ethtool_stats(struct net_device *dev,
 			 *(temp_stats + offset + 1);
 	}
 
-#if defined(BNX2_ENABLE_NETQUEUE)
-	/*  Copy over the NetQ specific statistics */
-	{
-		int j;
+	memset(&buf[i], 0, sizeof(u64) * BNX2_NUM_SW_STATS);
+	for (j = 0; j < bp->num_rx_rings; j++) {
+		struct bnx2_rx_ring_info *rxr = &bp->bnx2_napi[j].rx_ring;
 
-		for (j = 0; j < BNX2_MAX_MSIX_VEC; j++) {
-			struct bnx2_napi *bnapi = &bp->bnx2_napi[j];
+		bnx2_get_ring_stats(&bp->bnx2_napi[j], &rs);
+		buf[i + 0] += rxr->rx_buf_alloc;
+		buf[i + 1] += rs.rx_buf_alloc_fail;
+		buf[i + 2] += rxr->rx_buf_recycle;
+		pg_hit += rxr->rx_pg_cache_hit;
+		pg_miss += rxr->rx_pg_cache_miss;
+	}
+	for (j = 0; j < bp->num_tx_rings; j++) {
+		struct bnx2_tx_ring_info *txr = &bp->bnx2_napi[j].tx_ring;
 
-			buf[i + (j*5) + 0] = (u64) (bnapi->stats.rx_packets);
-			buf[i + (j*5) + 1] = (u64) (bnapi->stats.rx_bytes);
-			buf[i + (j*5) + 2] = (u64) (bnapi->stats.rx_errors);
-			buf[i + (j*5) + 3] = (u64) (bnapi->stats.tx_packets);
-			buf[i + (j*5) + 4] = (u64) (bnapi->stats.tx_bytes);
+		tx_db_pkts += txr->tx_db_pkts;
+		tx_db_writes += txr->tx_db_writes;
+	}
+	buf[i + 3] = tx_db_writes;
+	if (tx_db_writes)
+		buf[i + 4] = tx_db_pkts / tx_db_writes;
+	buf[i + 5] = pg_hit;
+	buf[i + 6] = pg_miss;
+	if (pg_hit + pg_miss) {
+		/* Keep pg_hit * 100 within an unsigned long */
+		while (pg_hit > ULONG_MAX / 100) {
+			pg_hit >>= 1;
+			pg_miss >>= 1;
 		}
+		buf[i + 7] = pg_hit * 100 / (pg_hit + pg_miss);
+	}
+	buf[i + 8] = bp->reset_chip_usecs;
+	buf[i + 9] = bp->init_cpus_usecs;
+	buf[i + 10] = bp->init_chip_usecs;
+	buf[i + 11] = bp->init_rings_usecs;
+	buf[i + 12] = bp->reset_usecs;
+	i += BNX2_NUM_SW_STATS;
+
+#if defined(BNX2_ENABLE_NETQUEUE)
+	/*  Copy over the NetQ specific statistics */
+	for (j = 0; j < BNX2_MAX_MSIX_VEC; j++) {
+		struct bnx2_napi *bnapi = &bp->bnx2_napi[j];
+
+		buf[i + (j*5) + 0] = (u64) (bnapi->stats.rx_packets);
+		buf[i + (j*5) + 1] = (u64) (bnapi->stats.rx_bytes);
+		buf[i + (j*5) + 2] = (u64) (bnapi->stats.rx_errors);
+		buf[i + (j*5) + 3] = (u64) (bnapi->stats.tx_packets);
+		buf[i + (j*5) + 4] = (u64) (bnapi->stats.tx_bytes);
+	}
+#else
+	for (j = 0; j < max_t(int, bp->num_rx_rings, bp->num_tx_rings);
+	     j++, i += BNX2_NUM_RING_STATS) {
+		bnx2_get_ring_stats(&bp->bnx2_napi[j], &rs);
+		buf[i + 0] = rs.rx_packets;
+		buf[i + 1] = rs.rx_bytes;
+		buf[i + 2] = rs.rx_drops;
+		buf[i + 3] = rs.rx_buf_alloc_fail;
+		buf[i + 4] = rs.tx_packets;
+		buf[i + 5] = rs.tx_bytes;
+		buf[i + 6] = rs.tx_drops;
+#ifdef BNX2_XDP
+		buf[i + 7] = bp->bnx2_napi[j].rx_ring.xdp_drop;
+		buf[i + 8] = bp->bnx2_napi[j].rx_ring.xdp_tx;
+		buf[i + 9] = bp->bnx2_napi[j].rx_ring.xdp_redirect;
+		buf[i + 10] = bp->bnx2_napi[j].rx_ring.xdp_aborted;
+		buf[i + 11] = bp->bnx2_napi[j].tx_ring.xdp_xmit;
+		buf[i + 12] = bp->bnx2_napi[j].tx_ring.xdp_xmit_err;
+#endif
 	}
 #endif
 }
@@ -9357,6 +10683,10 @@ static void bnx2_get_channels(struct net_device *dev,
 	if ((bp->flags & BNX2_FLAG_MSIX_CAP) && !disable_msi) {
 		max_rx_rings = RX_MAX_RINGS;
 		max_tx_rings = TX_MAX_RINGS;
+#ifdef BNX2_XDP
+		if (bp->xdp_prog)
+			max_tx_rings--;
+#endif
 	}
 
 	channels->max_rx = max_rx_rings;
@@ -9364,7 +10694,7 @@ static void bnx2_get_channels(struct net_device *dev,
 	channels->max_other = 0;
 	channels->max_combined = 0;
 	channels->rx_count = bp->num_rx_rings;
-	channels->tx_count = bp->num_tx_rings;
+	channels->tx_count = bp->num_tx_rings - bp->num_xdp_tx_rings;
 	channels->other_count = 0;
 	channels->combined_count = 0;
 }
@@ -9380,6 +10710,11 @@ static int bnx2_set_channels(struct net_device *dev,
 	if ((bp->flags & BNX2_FLAG_MSIX_CAP) && !disable_msi) {
 		max_rx_rings = RX_MAX_RINGS;
 		max_tx_rings = TX_MAX_RINGS;
+#ifdef BNX2_XDP
+		/* the XDP tx ring takes one of the vectors */
+		if (bp->xdp_prog)
+			max_tx_rings--;
+#endif
 	}
 	if (channels->rx_count > max_rx_rings ||
 	    channels->tx_count > max_tx_rings)
@@ -9397,6 +10732,203 @@ static int bnx2_set_channels(struct net_device *dev,
 
 #endif
 
+#if (LINUX_VERSION_CODE >= 0x030300) && !defined(BNX2_ENABLE_NETQUEUE)
+#define BNX2_ETHTOOL_RSS	1
+
+/* Ring 0 only receives non-RSS traffic, indirection table entries
+ * select among the remaining rings.
+ */
+static u32 bnx2_num_rss_rings(struct bnx2 *bp)
+{
+	return bp->num_rx_rings > 1 ? bp->num_rx_rings - 1 : 1;
+}
+
+static int bnx2_get_rss_flags(struct bnx2 *bp, struct ethtool_rxnfc *info)
+{
+	u32 type = bp->rss_cfg;
+
+	info->data = 0;
+
+	switch (info->flow_type) {
+	case TCP_V4_FLOW:
+	case UDP_V4_FLOW:
+	case IPV4_FLOW:
+		break;
+	case TCP_V6_FLOW:
+	case UDP_V6_FLOW:
+	case IPV6_FLOW:
+		/* IPv6 type field sits above the IPv4 one */
+		type >>= 2;
+		break;
+	default:
+		return 0;
+	}
+
+	type &= BNX2_RLUP_RSS_CONFIG_IPV4_RSS_TYPE_XI;
+	if (type == BNX2_RLUP_RSS_CONFIG_IPV4_RSS_TYPE_OFF_XI)
+		return 0;
+
+	info->data = RXH_IP_SRC | RXH_IP_DST;
+	/* Only TCP includes the ports in the hash */
+	if ((info->flow_type == TCP_V4_FLOW ||
+	     info->flow_type == TCP_V6_FLOW) &&
+	    type == BNX2_RLUP_RSS_CONFIG_IPV4_RSS_TYPE_ALL_XI)
+		info->data |= RXH_L4_B_0_1 | RXH_L4_B_2_3;
+
+	return 0;
+}
+
+static int bnx2_get_rxnfc(struct net_device *dev, struct ethtool_rxnfc *info,
+			  u32 *rules)
+{
+	struct bnx2 *bp = netdev_priv(dev);
+
+	switch (info->cmd) {
+	case ETHTOOL_GRXRINGS:
+		info->data = bnx2_num_rss_rings(bp);
+		return 0;
+	case ETHTOOL_GRXFH:
+		return bnx2_get_rss_flags(bp, info);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static int bnx2_set_rss_flags(struct bnx2 *bp, struct ethtool_rxnfc *info)
+{
+	u32 ip_only = RXH_IP_SRC | RXH_IP_DST;
+	u32 mask, type, cfg;
+
+	switch (info->flow_type) {
+	case TCP_V4_FLOW:
+		mask = BNX2_RLUP_RSS_CONFIG_IPV4_RSS_TYPE_XI;
+		type = BNX2_RLUP_RSS_CONFIG_IPV4_RSS_TYPE_IP_ONLY_XI;
+		if (info->data & (RXH_L4_B_0_1 | RXH_L4_B_2_3))
+			type = BNX2_RLUP_RSS_CONFIG_IPV4_RSS_TYPE_ALL_XI;
+		break;
+	case TCP_V6_FLOW:
+		mask = BNX2_RLUP_RSS_CONFIG_IPV6_RSS_TYPE_XI;
+		type = BNX2_RLUP_RSS_CONFIG_IPV6_RSS_TYPE_IP_ONLY_XI;
+		if (info->data & (RXH_L4_B_0_1 | RXH_L4_B_2_3))
+			type = BNX2_RLUP_RSS_CONFIG_IPV6_RSS_TYPE_ALL_XI;
+		break;
+	case UDP_V4_FLOW:
+	case UDP_V6_FLOW:
+	case IPV4_FLOW:
+	case IPV6_FLOW:
+		/* Non-TCP traffic is always hashed on the IP addresses */
+		if (info->data != ip_only)
+			return -EINVAL;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+
+	/* The hardware hashes either both ports or none */
+	if (info->data != ip_only &&
+	    info->data != (ip_only | RXH_L4_B_0_1 | RXH_L4_B_2_3))
+		return -EINVAL;
+
+	cfg = (bp->rss_cfg & ~mask) | type;
+	if (cfg == bp->rss_cfg)
+		return 0;
+
+	bp->rss_cfg = cfg;
+	if (netif_running(bp->dev) && bp->num_rx_rings > 1)
+		BNX2_WR(bp, BNX2_RLUP_RSS_CONFIG, bp->rss_cfg);
+
+	return 0;
+}
+
+static int bnx2_set_rxnfc(struct net_device *dev, struct ethtool_rxnfc *info)
+{
+	struct bnx2 *bp = netdev_priv(dev);
+
+	switch (info->cmd) {
+	case ETHTOOL_SRXFH:
+		return bnx2_set_rss_flags(bp, info);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static u32 bnx2_get_rxfh_indir_size(struct net_device *dev)
+{
+	return BNX2_RXP_SCRATCH_RSS_TBL_MAX_ENTRIES;
+}
+
+#if (LINUX_VERSION_CODE >= 0x031000)
+#ifdef _HAS_RSS_HASH_FUNCS
+static int bnx2_get_rxfh(struct net_device *dev, u32 *indir, u8 *key,
+			 u8 *hfunc)
+#else
+static int bnx2_get_rxfh(struct net_device *dev, u32 *indir, u8 *key)
+#endif
+#else
+static int bnx2_get_rxfh_indir(struct net_device *dev, u32 *indir)
+#endif
+{
+	struct bnx2 *bp = netdev_priv(dev);
+	int i;
+
+#ifdef _HAS_RSS_HASH_FUNCS
+	if (hfunc)
+		*hfunc = ETH_RSS_HASH_TOP;
+#endif
+	if (!indir)
+		return 0;
+
+	/* Report the table as programmed; it is set up with the rings */
+	for (i = 0; i < BNX2_RXP_SCRATCH_RSS_TBL_MAX_ENTRIES; i++)
+		indir[i] = bp->rss_ind_tbl[i];
+
+	return 0;
+}
+
+#if (LINUX_VERSION_CODE >= 0x031000)
+#ifdef _HAS_RSS_HASH_FUNCS
+static int bnx2_set_rxfh(struct net_device *dev, const u32 *indir,
+			 const u8 *key, const u8 hfunc)
+#else
+static int bnx2_set_rxfh(struct net_device *dev, const u32 *indir,
+			 const u8 *key)
+#endif
+#else
+static int bnx2_set_rxfh_indir(struct net_device *dev, const u32 *indir)
+#endif
+{
+	struct bnx2 *bp = netdev_priv(dev);
+	u32 num_rings = bnx2_num_rss_rings(bp);
+	int i;
+
+#if (LINUX_VERSION_CODE >= 0x031000)
+	/* The RSS hash key is fixed in the RXP firmware */
+	if (key)
+		return -EOPNOTSUPP;
+#endif
+#ifdef _HAS_RSS_HASH_FUNCS
+	if (hfunc != ETH_RSS_HASH_NO_CHANGE && hfunc != ETH_RSS_HASH_TOP)
+		return -EOPNOTSUPP;
+#endif
+	if (!indir)
+		return 0;
+
+	for (i = 0; i < BNX2_RXP_SCRATCH_RSS_TBL_MAX_ENTRIES; i++)
+		if (indir[i] >= num_rings)
+			return -EINVAL;
+
+	for (i = 0; i < BNX2_RXP_SCRATCH_RSS_TBL_MAX_ENTRIES; i++)
+		bp->rss_ind_tbl[i] = indir[i];
+	bp->rss_user_tbl = 1;
+
+	/* The lookup table can be rewritten while the rings are live */
+	if (netif_running(dev) && bp->num_rx_rings > 1)
+		bnx2_set_rss(bp);
+
+	return 0;
+}
+#endif
+
 static struct ethtool_ops bnx2_ethtool_ops = {
 #if (LINUX_VERSION_CODE < 0x42000)
 	.get_settings		= bnx2_get_settings,
@@ -9468,6 +11000,18 @@ static struct ethtool_ops bnx2_ethtool_ops = {
 	.get_channels		= bnx2_get_channels,
 	.set_channels		= bnx2_set_channels,
 #endif
+#ifdef BNX2_ETHTOOL_RSS
+	.get_rxnfc		= bnx2_get_rxnfc,
+	.set_rxnfc		= bnx2_set_rxnfc,
+	.get_rxfh_indir_size	= bnx2_get_rxfh_indir_size,
+#if (LINUX_VERSION_CODE >= 0x031000)
+	.get_rxfh		= bnx2_get_rxfh,
+	.set_rxfh		= bnx2_set_rxfh,
+#else
+	.get_rxfh_indir		= bnx2_get_rxfh_indir,
+	.set_rxfh_indir		= bnx2_set_rxfh_indir,
+#endif
+#endif
 };
 
 #if defined(BNX2_VMWARE_BMAPILNX)
@@ -9783,11 +11327,136 @@ bnx2_change_mtu(struct net_device *dev, int new_mtu)
 		((new_mtu + ETH_HLEN) < MIN_ETHERNET_PACKET_SIZE))
 		return -EINVAL;
 
+#ifdef BNX2_XDP
+	if (bp->xdp_prog && new_mtu > bnx2_xdp_max_mtu()) {
+		netdev_err(dev, "MTU %d too large for XDP, maximum is %d\n",
+			   new_mtu, bnx2_xdp_max_mtu());
+		return -EINVAL;
+	}
+#endif
+
 	dev->mtu = new_mtu;
 	return (bnx2_change_ring_size(bp, bp->rx_ring_size, bp->tx_ring_size,
 				      false));
 }
 
+#ifdef BNX2_XDP
+static int
+bnx2_xdp_xmit(struct net_device *dev, int n, struct xdp_frame **frames,
+	      u32 flags)
+{
+	struct bnx2 *bp = netdev_priv(dev);
+	struct bnx2_tx_ring_info *txr;
+	int i, sent = 0;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	if (unlikely(!READ_ONCE(bp->xdp_tx_ready)))
+		return -ENETDOWN;
+
+	txr = bnx2_xdp_tx_ring(bp);
+	spin_lock(&txr->xdp_tx_lock);
+	for (i = 0; i < n; i++) {
+		struct xdp_frame *xdpf = frames[i];
+		dma_addr_t mapping;
+
+		mapping = dma_map_single(&bp->pdev->dev, xdpf->data,
+					 xdpf->len, DMA_TO_DEVICE);
+		if (dma_mapping_error(&bp->pdev->dev, mapping)) {
+			txr->xdp_xmit_err++;
+			break;
+		}
+		if (bnx2_xdp_xmit_frame(bp, txr, xdpf, mapping, 0, false)) {
+			dma_unmap_single(&bp->pdev->dev, mapping, xdpf->len,
+					 DMA_TO_DEVICE);
+			break;
+		}
+		sent++;
+	}
+	if ((flags & XDP_XMIT_FLUSH) && txr->tx_db_pending)
+		bnx2_tx_doorbell(bp, txr);
+	spin_unlock(&txr->xdp_tx_lock);
+
+#if (LINUX_VERSION_CODE < 0x050d00)
+	/* older kernels expect the driver to free what it did not send */
+	for (i = sent; i < n; i++)
+		xdp_return_frame_rx_napi(frames[i]);
+#endif
+	return sent;
+}
+
+/* Attaching or removing a program changes the rx buffer layout and the
+ * number of tx rings, so the rings are rebuilt.  Replacing one program
+ * with another only swaps the pointer each rx ring runs.
+ */
+static int
+bnx2_xdp_setup(struct bnx2 *bp, struct bpf_prog *prog,
+	       struct netlink_ext_ack *extack)
+{
+	struct bpf_prog *old;
+	int i, rc;
+
+	if (!prog && !bp->xdp_prog)
+		return 0;
+
+	if (prog && (!(bp->flags & BNX2_FLAG_MSIX_CAP) || disable_msi)) {
+		NL_SET_ERR_MSG_MOD(extack, "XDP requires MSI-X");
+		return -EOPNOTSUPP;
+	}
+
+	if (prog && bp->dev->mtu > bnx2_xdp_max_mtu()) {
+		NL_SET_ERR_MSG_MOD(extack, "MTU too large for XDP");
+		return -EINVAL;
+	}
+
+	if (prog && bp->xdp_prog) {
+		old = xchg(&bp->xdp_prog, prog);
+		if (netif_running(bp->dev))
+			for (i = 0; i < bp->num_rx_rings; i++)
+				WRITE_ONCE(bp->bnx2_napi[i].rx_ring.xdp_prog,
+					   prog);
+	} else {
+		old = bp->xdp_prog;
+		bp->xdp_prog = prog;
+		rc = bnx2_change_ring_size(bp, bp->rx_ring_size,
+					   bp->tx_ring_size, true);
+		if (rc) {
+			if (rc == -ENOSPC)
+				NL_SET_ERR_MSG_MOD(extack,
+						   "No MSI-X vector for the XDP tx ring");
+			/* the device has been closed, size it for old again */
+			bp->xdp_prog = old;
+			bnx2_set_rx_ring_size(bp, bp->rx_ring_size);
+			return rc;
+		}
+	}
+	if (old)
+		bpf_prog_put(old);
+
+#ifdef _HAS_XDP_SET_FEATURES_FLAG
+	if (prog)
+		xdp_features_set_redirect_target(bp->dev, false);
+	else
+		xdp_features_clear_redirect_target(bp->dev);
+#endif
+	return 0;
+}
+
+static int
+bnx2_bpf(struct net_device *dev, struct netdev_bpf *xdp)
+{
+	struct bnx2 *bp = netdev_priv(dev);
+
+	switch (xdp->command) {
+	case XDP_SETUP_PROG:
+		return bnx2_xdp_setup(bp, xdp->prog, xdp->extack);
+	default:
+		return -EINVAL;
+	}
+}
+#endif
+
 #if defined(__VMKLNX__)
 static int
 bnx2_vmk_change_mtu(struct net_device *dev, int new_mtu)
@@ -10081,7 +11750,8 @@ bnx2_init_board(struct pci_dev *pdev, struct net_device *dev)
 	bp->pdev = pdev;
 
 	spin_lock_init(&bp->phy_lock);
-	spin_lock_init(&bp->indirect_lock);
+	spin_lock_init(&bp->reg_win_lock);
+	spin_lock_init(&bp->ctx_lock);
 #if defined(BNX2_ENABLE_NETQUEUE)
 	mutex_init(&bp->netq_lock);
 #endif
@@ -10307,6 +11977,17 @@ bnx2_init_board(struct pci_dev *pdev, struct net_device *dev)
 
 	bp->rx_csum = 1;
 
+	bp->rss_cfg = BNX2_RLUP_RSS_CONFIG_IPV4_RSS_TYPE_ALL_XI |
+		      BNX2_RLUP_RSS_CONFIG_IPV6_RSS_TYPE_ALL_XI;
+
+	for (i = 0; i < BNX2_MAX_MSIX_VEC; i++) {
+		struct bnx2_napi *bnapi = &bp->bnx2_napi[i];
+
+		u64_stats_init(&bnapi->rx_ring.rx_syncp);
+		u64_stats_init(&bnapi->tx_ring.tx_syncp);
+		u64_stats_init(&bnapi->tx_ring.tx_drop_syncp);
+	}
+
 	bp->tx_quick_cons_trip_int = 2;
 	bp->tx_quick_cons_trip = 20;
 	bp->tx_ticks_int = 18;
@@ -10547,7 +12228,11 @@ static const struct net_device_ops bnx2_netdev_ops = {
 	.ndo_open		= bnx2_open,
 	.ndo_start_xmit		= bnx2_start_xmit,
 	.ndo_stop		= bnx2_close,
+#ifdef BNX2_STATS64
+	.ndo_get_stats64	= bnx2_get_stats64,
+#else
 	.ndo_get_stats		= bnx2_get_stats,
+#endif
 	.ndo_set_rx_mode	= bnx2_set_rx_mode,
 #if defined(__VMKLNX__)
 	.ndo_do_ioctl		= bnx2_vmk_ioctl,
@@ -10580,6 +12265,10 @@ static const struct net_device_ops bnx2_netdev_ops = {
 #if defined(HAVE_POLL_CONTROLLER) || defined(CONFIG_NET_POLL_CONTROLLER)
 	.ndo_poll_controller	= poll_bnx2,
 #endif
+#ifdef BNX2_XDP
+	.ndo_bpf		= bnx2_bpf,
+	.ndo_xdp_xmit		= bnx2_xdp_xmit,
+#endif
 };
 #endif
 
@@ -10753,6 +12442,12 @@ bnx2_init_one(struct pci_dev *pdev, const struct pci_device_id *ent)
 #endif
 #endif /* BCM_HAS_HW_FEATURES */
 
+#if defined(BNX2_XDP) && defined(_HAS_XDP_SET_FEATURES_FLAG)
+	if ((bp->flags & BNX2_FLAG_MSIX_CAP) && !disable_msi)
+		xdp_set_features_flag(dev, NETDEV_XDP_ACT_BASIC |
+					   NETDEV_XDP_ACT_REDIRECT);
+#endif
+
 #if defined(__VMKLNX__) && (VMWARE_ESX_DDK_VERSION >= 50000)
         if (BNX2_CHIP(bp) == BNX2_CHIP_5706 ||
             BNX2_CHIP(bp) == BNX2_CHIP_5708) {
@@ -10844,6 +12539,8 @@ bnx2_remove_one(struct pci_dev *pdev)
 
 	kfree(bp->temp_stats_blk);
 
+	bnx2_free_fw_imgs(bp);
+
 	if (bp->flags & BNX2_FLAG_AER_ENABLED) {
 		pci_disable_pcie_error_reporting(pdev);
 		bp->flags &= ~BNX2_FLAG_AER_ENABLED;
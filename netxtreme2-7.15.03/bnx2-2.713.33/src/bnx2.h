@@ -7193,7 +7193,11 @@ struct l2_fhdr {
 #endif
 
 struct bnx2_sw_bd {
+#ifdef BNX2_BUILD_SKB
+	u8			*data;
+#else
 	struct sk_buff		*skb;
+#endif
 	struct l2_fhdr		*desc;
 	DEFINE_DMA_UNMAP_ADDR(mapping);
 };
@@ -7208,10 +7212,21 @@ struct bnx2_sw_tx_bd {
 	unsigned short		is_gso;
 	unsigned short		nr_frags;
 	DEFINE_DMA_UNMAP_ADDR(mapping);
+	/* XDP tx ring only, in place of skb.  xdp_rx_buf is set when the
+	 * frame is one of our rx buffers, still under its rx mapping.
+	 */
+	struct xdp_frame	*xdpf;
+	unsigned short		xdp_rx_buf;
 };
 
 #define SW_RXBD_RING_SIZE (sizeof(struct bnx2_sw_bd) * BNX2_RX_DESC_CNT)
 #define SW_RXPG_RING_SIZE (sizeof(struct bnx2_sw_pg) * BNX2_RX_DESC_CNT)
+
+/* Jumbo pages handed to the stack stay DMA mapped in a per-ring FIFO and
+ * are reused once the stack has dropped its reference.
+ */
+#define BNX2_RX_PG_CACHE_SIZE	256
+#define BNX2_RX_PG_CACHE_MASK	(BNX2_RX_PG_CACHE_SIZE - 1)
 #define RXBD_RING_SIZE (sizeof(struct bnx2_rx_bd) * BNX2_RX_DESC_CNT)
 #define SW_TXBD_RING_SIZE (sizeof(struct bnx2_sw_tx_bd) * BNX2_TX_DESC_CNT)
 #define TXBD_RING_SIZE (sizeof(struct bnx2_tx_bd) * BNX2_TX_DESC_CNT)
@@ -7292,6 +7307,24 @@ struct bnx2_irq {
 	char		name[16];
 };
 
+/* Per-ring software counters are 64-bit on all hosts; on 32-bit SMP the
+ * readers use the u64_stats_sync sequence to get consistent values.
+ */
+#if (LINUX_VERSION_CODE >= 0x020624)
+#include <linux/u64_stats_sync.h>
+#define BNX2_STATS64	1
+#else
+struct u64_stats_sync {
+};
+#endif
+
+/* XDP runs on the page frag rx buffers that build_skb() takes */
+#if defined(_HAS_XDP_INIT_BUFF) && defined(_HAS_BUILD_SKB_FRAG) && \
+    !defined(__VMKLNX__)
+#include <net/xdp.h>
+#define BNX2_XDP	1
+#endif
+
 struct bnx2_tx_ring_info {
 	u32			tx_prod_bseq;
 	u16			tx_prod;
@@ -7305,8 +7338,47 @@ struct bnx2_tx_ring_info {
 	u16			hw_tx_cons;
 
 	dma_addr_t		tx_desc_mapping;
+
+	/* Packets queued since the last TX mailbox write */
+	u16			tx_db_pending;
+	unsigned long		tx_db_pkts;
+	unsigned long		tx_db_writes;
+
+	/* Completions are counted in bnx2_tx_int() under tx_syncp, drops
+	 * in bnx2_start_xmit() under tx_drop_syncp.
+	 */
+	u64			tx_packets;
+	u64			tx_bytes;
+	struct u64_stats_sync	tx_syncp;
+	u64			tx_drops;
+	struct u64_stats_sync	tx_drop_syncp;
+
+	/* XDP tx ring only.  XDP_TX from every rx ring and ndo_xdp_xmit()
+	 * share the ring under xdp_tx_lock.
+	 */
+	spinlock_t		xdp_tx_lock;
+	unsigned long		xdp_xmit;
+	unsigned long		xdp_xmit_err;
 };
 
+/* Adaptive coalescing.  Every BNX2_AIM_INTERVAL each vector picks rx/tx
+ * ticks and frame trips between the LOW (latency) and HIGH (throughput)
+ * settings, scaled on its packet rate in packets per msec.
+ */
+#define BNX2_AIM_INTERVAL	(HZ / 10)
+#define BNX2_AIM_RATE_LOW	20
+#define BNX2_AIM_RATE_HIGH	400
+#define BNX2_AIM_SMALL_PKT	128
+#define BNX2_AIM_TICKS_LOW	8
+#define BNX2_AIM_TICKS_HIGH	200
+#define BNX2_AIM_TRIP_LOW	2
+#define BNX2_AIM_TRIP_HIGH	48
+
+/* Max packets bnx2_start_xmit() holds back from the chip while the stack
+ * has more to send.
+ */
+#define BNX2_TX_DB_MAX_DEFER	32
+
 struct bnx2_rx_ring_info {
 	u32			rx_prod_bseq;
 	u16			rx_prod;
@@ -7326,6 +7398,49 @@ struct bnx2_rx_ring_info {
 
 	dma_addr_t		rx_desc_mapping[BNX2_MAX_RX_RINGS];
 	dma_addr_t		rx_pg_desc_mapping[BNX2_MAX_RX_PG_RINGS];
+
+	struct bnx2_sw_pg	*rx_pg_cache;
+	u16			rx_pg_cache_head;
+	u16			rx_pg_cache_tail;
+
+	/* Rx buffer accounting, reported through ethtool -S */
+	unsigned long		rx_buf_alloc;
+	unsigned long		rx_buf_recycle;
+	unsigned long		rx_pg_cache_hit;
+	unsigned long		rx_pg_cache_miss;
+
+	/* Only written by the ring's NAPI poll, or by ring init while
+	 * NAPI is disabled.
+	 */
+	u64			rx_packets;
+	u64			rx_bytes;
+	u64			rx_drops;
+	u64			rx_buf_alloc_fail;
+	struct u64_stats_sync	rx_syncp;
+
+	/* XDP verdicts other than XDP_PASS */
+	unsigned long		xdp_drop;
+	unsigned long		xdp_tx;
+	unsigned long		xdp_redirect;
+	unsigned long		xdp_aborted;
+	/* Copy of bp->xdp_prog taken when the ring is initialized, so a
+	 * ring never runs a program before it has the headroom for it.
+	 */
+	struct bpf_prog		*xdp_prog;
+#ifdef BNX2_XDP
+	struct xdp_rxq_info	xdp_rxq;
+#endif
+};
+
+/* Snapshot of one vector's rx and tx ring counters */
+struct bnx2_ring_stats {
+	u64			rx_packets;
+	u64			rx_bytes;
+	u64			rx_drops;
+	u64			rx_buf_alloc_fail;
+	u64			tx_packets;
+	u64			tx_bytes;
+	u64			tx_drops;
 };
 
 struct bnx2_napi {
@@ -7348,6 +7463,18 @@ struct bnx2_napi {
 	struct bnx2_rx_ring_info	rx_ring;
 	struct bnx2_tx_ring_info	tx_ring;
 
+	/* Adaptive coalescing: traffic seen since aim_last and the values
+	 * currently programmed into this vector's HC registers.
+	 */
+	u32			aim_rx_pkts;
+	u32			aim_rx_bytes;
+	u32			aim_tx_pkts;
+	unsigned long		aim_last;
+	u16			aim_rx_ticks;
+	u16			aim_rx_trip;
+	u16			aim_tx_ticks;
+	u16			aim_tx_trip;
+
 #if defined(__VMKLNX__) && defined(__VMKNETDDI_QUEUEOPS__)
 	u8			rx_queue_allocated;
 	u8			tx_queue_allocated;
@@ -7423,6 +7550,9 @@ struct bnx2 {
 
 	u32			rx_buf_use_size;	/* useable size */
 	u32			rx_buf_size;		/* with alignment */
+	u32			rx_frag_size;		/* 0 if kmalloc'ed */
+	u32			rx_headroom;		/* ahead of l2_fhdr */
+	int			rx_dma_dir;
 	u32			rx_copy_thresh;
 	u32			rx_jumbo_thresh;
 	u32			rx_max_ring_idx;
@@ -7453,7 +7583,12 @@ struct bnx2 {
 
 	/* Used to synchronize phy accesses. */
 	spinlock_t		phy_lock;
-	spinlock_t		indirect_lock;
+	/* Each indirect access window (an address/data register pair) has
+	 * its own lock, so cnic context writes do not contend with shmem and
+	 * register window accesses from the timer and the stats path.
+	 */
+	spinlock_t		reg_win_lock;
+	spinlock_t		ctx_lock;
 
 	u32			phy_flags;
 #define BNX2_PHY_FLAG_SERDES			0x00000001
@@ -7537,6 +7672,9 @@ struct bnx2 {
 	u16			rx_ticks;
 	u16			rx_ticks_int;
 
+	u8			adaptive_rx;
+	u8			adaptive_tx;
+
 	u32			stats_ticks;
 
 	dma_addr_t		status_blk_mapping;
@@ -7602,15 +7740,55 @@ struct bnx2 {
 	struct z_stream_s	*strm;
 	void			*gunzip_buf;
 
+	/* Decompressed RV2P and CPU text images, in CPU byte order, kept
+	 * from the first chip init so resets skip the inflate step.
+	 */
+#define BNX2_FW_IMG_RV2P1	0
+#define BNX2_FW_IMG_RV2P2	1
+#define BNX2_FW_IMG_RXP		2
+#define BNX2_FW_IMG_TXP		3
+#define BNX2_FW_IMG_TPAT	4
+#define BNX2_FW_IMG_COM		5
+#define BNX2_FW_IMG_CP		6
+#define BNX2_FW_IMG_MAX		7
+	u32			*fw_img[BNX2_FW_IMG_MAX];
+	u32			fw_img_len[BNX2_FW_IMG_MAX];
+
+	/* Duration of each phase of the last bnx2_reset_nic(), in usecs */
+	u32			reset_chip_usecs;
+	u32			init_cpus_usecs;
+	u32			init_chip_usecs;
+	u32			init_rings_usecs;
+	u32			reset_usecs;
+
 	struct bnx2_irq		irq_tbl[BNX2_MAX_MSIX_VEC];
 	int			irq_nvecs;
 
 	u8			num_tx_rings;
 	u8			num_rx_rings;
+	/* Stack tx ring count the default XPS maps were built for */
+	u8			xps_tx_rings;
+
+	/* With an XDP program attached, the last tx ring (on its own
+	 * vector) is kept from the stack for XDP_TX and ndo_xdp_xmit().
+	 * num_tx_rings includes it.  xdp_tx_ready is cleared, followed by
+	 * synchronize_net(), before the rings are torn down.
+	 */
+	struct bpf_prog		*xdp_prog;
+	u8			num_xdp_tx_rings;
+	u8			xdp_tx_ready;
 
 	int			num_req_tx_rings;
 	int			num_req_rx_rings;
 
+	/* RSS indirection table, one RSS ring offset (ring - 1) per entry,
+	 * and the RLUP_RSS_CONFIG hash types.  rss_user_tbl is set once
+	 * the table has been configured with ethtool -X.
+	 */
+	u8			rss_ind_tbl[BNX2_RXP_SCRATCH_RSS_TBL_MAX_ENTRIES];
+	u8			rss_user_tbl;
+	u32			rss_cfg;
+
 	u8			func;
 
 	u32 			leds_save;
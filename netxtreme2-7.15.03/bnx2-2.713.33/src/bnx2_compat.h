@@ -31,6 +31,15 @@
 #define BNX2_NEW_NAPI	1
 #endif
 
+#if defined(_HAS_BUILD_SKB_FRAG) && !defined(__VMKLNX__)
+#define BNX2_BUILD_SKB	1
+#endif
+
+#if (LINUX_VERSION_CODE >= 0x040100) && defined(CONFIG_XPS) && \
+    !defined(__VMKLNX__)
+#define BNX2_XPS	1
+#endif
+
 #ifndef ADVERTISE_10HALF
 #define ADVERTISE_10HALF	0x0020
 #endif
@@ -859,6 +868,58 @@ skb_set_hash(struct sk_buff *skb, __u32 hash, enum pkt_hash_types type)
 		p = (typeof(*v) __force __rcu *)(v)
 #endif
 
+#if defined(_HAS_NETDEV_XMIT_MORE)
+#define bnx2_xmit_more(skb)	netdev_xmit_more()
+#elif defined(_HAS_SKB_XMIT_MORE)
+#define bnx2_xmit_more(skb)	((skb)->xmit_more)
+#else
+#define bnx2_xmit_more(skb)	0
+#endif
+
+#ifdef _DEFINE_SKB_FREE_FRAG
+#define skb_free_frag(data) put_page(virt_to_head_page(data))
+#endif
+
+#ifdef _DEFINE_GFP_ALLOW_BLOCKING
+#define gfpflags_allow_blocking(mask)	((mask) & __GFP_WAIT)
+#endif
+
+#if (LINUX_VERSION_CODE < 0x020624)
+/* No 64-bit stats sequence; struct u64_stats_sync is stubbed in bnx2.h */
+#define u64_stats_update_begin(syncp)		do { } while (0)
+#define u64_stats_update_end(syncp)		do { } while (0)
+#define u64_stats_fetch_begin(syncp)		0
+#define u64_stats_fetch_retry(syncp, start)	0
+#endif
+
+#ifdef _DEFINE_U64_STATS_INIT
+#define u64_stats_init(syncp)			do { } while (0)
+#endif
+
+#if defined(_DEFINE_NETDEV_TX_COMPLETED_QUEUE) || defined(__VMKLNX__)
+#define netdev_tx_sent_queue(txq, bytes)		do { } while (0)
+#define netdev_tx_completed_queue(txq, pkts, bytes)	do { } while (0)
+#define netdev_tx_reset_queue(txq)			do { } while (0)
+#define netif_xmit_stopped(txq)		netif_tx_queue_stopped(txq)
+#endif
+
+/* Reset phase timing; falls back to jiffies resolution without ktime */
+#if (LINUX_VERSION_CODE >= 0x02061c) && !defined(__VMKLNX__)
+typedef ktime_t bnx2_time_t;
+#define bnx2_time_now()			ktime_get()
+#define bnx2_usecs_since(t)		((u32) ktime_us_delta(ktime_get(), (t)))
+#else
+typedef unsigned long bnx2_time_t;
+#define bnx2_time_now()			jiffies
+#define bnx2_usecs_since(t)		(jiffies_to_msecs(jiffies - (t)) * 1000)
+#endif
+
+#if defined(_HAS_XDP_INIT_BUFF) && \
+    !defined(_HAS_BPF_WARN_INVALID_XDP_ACTION_DEV)
+#define bpf_warn_invalid_xdp_action(dev, prog, act)	\
+	bpf_warn_invalid_xdp_action(act)
+#endif
+
 #if defined (__VMKLNX__)
 /**
  * THIS FUNCTION SHOULD BE REMOVED ONCE PR 379263 IS RESOLVED
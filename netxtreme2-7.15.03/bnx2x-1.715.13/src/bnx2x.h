@@ -34,6 +34,7 @@
 #ifdef BCM_PTP /* BNX2X_UPSTREAM */
 #include <linux/ptp_clock_kernel.h>
 #include <linux/net_tstamp.h>
+#include <linux/seqlock.h>
 #ifndef _DEFINE_CYCLECOUNTER_MASK /* BNX2X_UPSTREAM */
 #include <linux/timecounter.h>
 #else
@@ -223,6 +224,150 @@ static inline void bnx2x_get_ts(struct bnx2x_timestamp *ts)
 	ts->rem_usec = do_div(ts->sec, NSEC_PER_SEC) / NSEC_PER_USEC;
 }
 
+#ifdef BCM_PTP /* BNX2X_UPSTREAM */
+/* Last hardware sample of the PHC together with the host monotonic time it
+ * was taken at. PHC reads between samples are extrapolated from it using
+ * the PHC rate measured against the host clock.
+ */
+struct bnx2x_phc_snap {
+	bool valid;
+	u64 phc_ns;
+	u64 sys_ns;
+
+	/* Start of the current rate measurement window */
+	u64 anchor_phc_ns;
+	u64 anchor_sys_ns;
+
+	/* PHC rate relative to the host clock */
+	s64 rate_ppb;
+
+	/* Last drift correction programmed through the timesync ramrod */
+	s32 adj_ppb;
+};
+#endif
+
+/* Self-test phases; each one is timed separately */
+enum bnx2x_st_phase {
+	BNX2X_ST_NVRAM,
+	BNX2X_ST_DIAG_LOAD,
+	BNX2X_ST_REGISTERS,
+	BNX2X_ST_MEMORY,
+	BNX2X_ST_INT_LB,
+	BNX2X_ST_EXT_LB,
+	BNX2X_ST_RELOAD,
+	BNX2X_ST_INTR,
+	BNX2X_ST_LINK,
+	BNX2X_ST_IDLE_CHK,
+	BNX2X_ST_MAX
+};
+
+struct bnx2x_st_phase_stat {
+	u32	runs;
+	u32	last_us;
+	u32	max_us;
+	int	rc;
+};
+
+/* Scratch space of bnx2x_idle_chk(). Register ranges are read into batch;
+ * the cfc_* arrays hold the CFC snapshot shared by all the macro 7 records
+ * of a run, keyed by the info ram address (0 when not taken yet).
+ */
+#define BNX2X_IDLE_CHK_CFC_LCIDS	(CFC_REG_INFO_RAM_SIZE >> 4)
+#define BNX2X_IDLE_CHK_BATCH_MAX	(BNX2X_IDLE_CHK_CFC_LCIDS * 4)
+
+struct bnx2x_idle_chk_buf {
+	u32	batch[BNX2X_IDLE_CHK_BATCH_MAX];
+	u32	cfc_addr;
+	u32	cfc_cam[BNX2X_IDLE_CHK_CFC_LCIDS];
+	u32	cfc_type[BNX2X_IDLE_CHK_CFC_LCIDS];
+	u32	cfc_ac[BNX2X_IDLE_CHK_CFC_LCIDS];
+	bool	bulk;
+	/* access statistics of the last run */
+	u32	grc_reads;
+	u32	dmae_reads;
+};
+
+/* The NVRAM test is independent of the chip blocks exercised by the other
+ * online tests and runs in parallel with them from a work item.
+ */
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 20)) /* BNX2X_UPSTREAM */
+#define BNX2X_ST_ASYNC_NVRAM
+#endif
+
+/* SFP module EEPROM (A0) and diagnostics (A2) pages, cached by the PMF
+ * period task and served to ethtool/cnic without taking the PHY lock.
+ */
+#define BNX2X_SFP_PAGE_LEN	256
+
+struct bnx2x_sfp_cache {
+	spinlock_t	lock;		/* protects a0, a2, the flags and jiffies */
+	u8		a0[BNX2X_SFP_PAGE_LEN];
+	u8		a2[BNX2X_SFP_PAGE_LEN];
+	u8		a0_valid;
+	u8		a2_valid;
+	unsigned long	jiffies;	/* time of the last sample */
+
+	/* used by the sampler only, under the PHY lock */
+	u8		buf[BNX2X_SFP_PAGE_LEN];
+	unsigned long	next;
+	u32		samples;
+	u32		errors;
+
+	u32		hits;
+	u32		misses;
+};
+
+/* Long NVRAM reads and updates hold the NVRAM interface for up to
+ * BNX2X_NVRAM_SLICE_MS before it is handed back to the MFW. A write that
+ * continues where the previous one ended, within BNX2X_NVRAM_WR_SESSION_GAP,
+ * belongs to the same update session.
+ */
+#define BNX2X_NVRAM_SLICE_MS		10
+#define BNX2X_NVRAM_WR_SESSION_GAP	(5 * HZ)
+
+struct bnx2x_nvram_wr_prog {
+	u32		start_offset;
+	u32		next_offset;
+	u32		bytes;
+	u32		pages;
+	u32		yields;
+	u32		errors;
+	int		last_rc;
+	unsigned long	start;
+	unsigned long	last;
+};
+
+/* Parity recovery history */
+#define BNX2X_PAR_REC_HIST	16
+
+enum bnx2x_par_rec_outcome {
+	BNX2X_PAR_REC_OK,
+	BNX2X_PAR_REC_ESCALATED,
+	BNX2X_PAR_REC_FAILED,
+};
+
+struct bnx2x_par_rec_event {
+	unsigned long	jiffies;	/* when the attention was handled */
+	u32		sig[5];		/* parity bits of the AEU signals */
+	u32		duration_us;
+	u8		scoped;		/* function reload, no path reset */
+	u8		global;
+	u8		outcome;
+};
+
+/* Tx hang watchdog and per-queue reset accounting */
+struct bnx2x_txq_reset_stats {
+	u32		hangs;		/* stalls seen by the watchdog */
+	u32		timeouts;	/* netdev Tx timeouts mapped to a queue */
+	u32		resets;		/* queues reset without a reload */
+	u32		escalated;	/* resets that fell back to a reload */
+	u32		last_us;
+	u32		max_us;
+	int		last_queue;
+	unsigned long	last;		/* jiffies of the last reset */
+	u64		pause_rx;	/* pause frames seen by the last pass */
+};
+
 struct bnx2x_internal_trace {
 	bool is_int_msglevel;
 	u8 *dump_buf;
@@ -614,6 +759,12 @@ struct sw_tx_bd {
 /* Set on the first BD descriptor when there is a split BD */
 #define BNX2X_TSO_SPLIT_BD		(1<<0)
 #define BNX2X_HAS_SECOND_PBD		(1<<1)
+/* Set when some frags were copied into the Tx bounce area */
+#define BNX2X_TX_BOUNCE_BD		(1<<2)
+/* Set when the whole packet was copied into the Tx copybreak slab */
+#define BNX2X_TX_COPYBREAK_BD		(1<<3)
+	/* BD pointing into the bounce area; it must not be unmapped */
+	u16		bounce_bd;
 };
 
 struct sw_rx_page {
@@ -765,6 +916,12 @@ struct bnx2x_agg_info {
 #define Q_STATS_OFFSET32(stat_name) \
 			(offsetof(struct bnx2x_eth_q_stats, stat_name) / 4)
 
+/* Tx completion batching: bnx2x_tx_int() batch size histogram buckets, and
+ * the max number of consecutive polls which may defer the completions.
+ */
+#define BNX2X_TX_DONE_HIST		8
+#define BNX2X_TX_DONE_MAX_SKIP		4
+
 struct bnx2x_fp_txdata {
 
 	struct sw_tx_bd		*tx_buf_ring;
@@ -788,6 +945,40 @@ struct bnx2x_fp_txdata {
 	int			txq_index;
 	struct bnx2x_fastpath	*parent_fp;
 	int			tx_ring_size;
+
+	/* Owners currently holding Tx (BNX2X_TX_HOLD_*); the netdev queue
+	 * is not woken while any of them is set.
+	 */
+	u8			tx_held;
+#define BNX2X_TX_HOLD_DCBX		(1<<0)
+#define BNX2X_TX_HOLD_STORM		(1<<1)
+	/* HW consumer seen by the last PFC watchdog pass */
+	u16			pfc_wd_cons;
+	/* HW consumer seen by the Tx hang watchdog and the time (jiffies) it
+	 * stopped moving with work pending; 0 while the ring makes progress.
+	 */
+	u16			hang_wd_cons;
+	unsigned long		hang_since;
+
+	/* Packets reclaimed per bnx2x_tx_int() call (log2 buckets), polls
+	 * which left completions for a later one, and the current run of
+	 * such polls.
+	 */
+	u32			tx_done_hist[BNX2X_TX_DONE_HIST];
+	u32			tx_done_deferred;
+	u8			tx_done_skip;
+
+	/* Pre-mapped slots for frags that would overflow the FW BD fetch
+	 * window; released in order as packets complete.
+	 */
+	u8			*tx_bounce;
+	dma_addr_t		tx_bounce_mapping;
+	u16			tx_bounce_prod;
+	u16			tx_bounce_cons;
+
+	/* Tx copybreak slab pages, allocated while copybreak is enabled */
+	u8			**tx_cb_buf;
+	dma_addr_t		*tx_cb_mapping;
 #if defined(__VMKLNX__)	/* ! BNX2X_UPSTREAM */
 	u16			prev_tx_pkt_cons;
 	int			queue_stuck;
@@ -888,6 +1079,9 @@ struct bnx2x_fastpath {
 	char			name[FP_NAME_SIZE];
 
 	struct bnx2x_alloc_pool page_pool;
+
+	/* Tx ring stalled; queue reset requested from bnx2x_sp_rtnl_task() */
+	bool			tx_hang_reset;
 };
 
 #define bnx2x_fp(bp, nr, var)	((bp)->fp[(nr)].var)
@@ -987,6 +1181,25 @@ enum {
 #define MAX_DESC_PER_TX_PKT	(MAX_BDS_PER_TX_PKT + \
 				 NEXT_CNT_PER_TX_PKT(MAX_BDS_PER_TX_PKT))
 
+/* Tx bounce area: a run of small frags is copied into one slot instead of
+ * linearizing the whole skb when the packet violates the fetch window.
+ */
+#define BNX2X_TX_BOUNCE_SLOTS		16
+#define BNX2X_TX_BOUNCE_SLOT_SZ		2048
+#define BNX2X_TX_BOUNCE_SZ		(BNX2X_TX_BOUNCE_SLOTS * \
+					 BNX2X_TX_BOUNCE_SLOT_SZ)
+
+/* Tx copybreak: packets up to bp->tx_copybreak bytes are copied into a
+ * permanently mapped slot selected by their start BD. Every packet takes
+ * at least a start BD and a parsing BD, so start BD / 2 is unique among
+ * the packets in flight.
+ */
+#define BNX2X_TX_COPYBREAK_MAX		128
+#define BNX2X_TX_CB_SLOTS		(NUM_TX_BD / 2)
+#define BNX2X_TX_CB_SLOTS_PER_PAGE	(BCM_PAGE_SIZE / BNX2X_TX_COPYBREAK_MAX)
+#define BNX2X_TX_CB_PAGES		(BNX2X_TX_CB_SLOTS / \
+					 BNX2X_TX_CB_SLOTS_PER_PAGE)
+
 /* The RX BD ring is special, each bd is 8 bytes but the last one is 16 */
 #define NUM_RX_RINGS		8
 #define RX_DESC_CNT		(BCM_PAGE_SIZE / sizeof(struct eth_rx_bd))
@@ -1539,6 +1752,11 @@ struct bnx2x_slowpath {
 	u32				wb_comp;
 	u32				wb_data[4];
 
+#ifndef BNX2X_UPSTREAM /* ! BNX2X_UPSTREAM */
+	/* bulk GRC reads of up to DMAE_LEN32_RD_MAX dwords (idle check) */
+	u32				bulk_data[0x80];
+#endif
+
 	union drv_info_to_mcp		drv_info_to_mcp;
 };
 
@@ -1657,10 +1875,13 @@ enum sp_rtnl_flag {
 	BNX2X_SP_RTNL_VFPF_STORM_BYPASS_RX_MODE,
 #endif
 	BNX2X_SP_RTNL_TX_STOP,
+	BNX2X_SP_RTNL_DCBX_TC_UPDATE,
 	BNX2X_SP_RTNL_GET_DRV_VERSION,
 	BNX2X_SP_RTNL_CHANGE_UDP_PORT,
 	BNX2X_SP_RTNL_UPDATE_SVID,
 	BNX2X_SP_RTNL_OEM_EVENT,
+	BNX2X_SP_RTNL_PARITY_SCOPED,
+	BNX2X_SP_RTNL_TX_QUEUE_RESET,
 };
 
 enum bnx2x_iov_flag {
@@ -1832,6 +2053,8 @@ struct bnx2x {
 	struct msix_entry	*msix_table;
 
 	int			tx_ring_size;
+	/* copy packets up to this size instead of mapping them (0 - off) */
+	u32			tx_copybreak;
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 37)) /* ! BNX2X_UPSTREAM */
 	struct vlan_group	*vlgrp;
 #endif
@@ -2309,6 +2532,41 @@ struct bnx2x {
 	struct bnx2x_dcbx_port_params		dcbx_port_params;
 	int					dcb_version;
 
+	/* TCs whose parameters were changed by the last DCBX negotiation */
+	unsigned long				dcbx_tc_changed;
+	/* FW holds the current priority to CoS mapping (TX_START was sent) */
+	bool					dcbx_fw_synced;
+	struct bnx2x_dcbx_tc_pause		dcbx_tc_pause[DCBX_COS_MAX_NUM];
+
+	/* PFC storm watchdog */
+	u64					pfc_wd_last_rx;
+	struct bnx2x_pfc_tc_stats		pfc_tc_stats[DCBX_COS_MAX_NUM];
+
+	/* ethtool self-test per-phase timings */
+	struct bnx2x_st_phase_stat		st_phase[BNX2X_ST_MAX];
+#ifdef BNX2X_ST_ASYNC_NVRAM
+	struct work_struct			st_nvram_work;
+	int					st_nvram_rc;
+#endif
+	struct bnx2x_idle_chk_buf		idle_chk;
+
+	struct bnx2x_sfp_cache			sfp_cache;
+	struct bnx2x_nvram_wr_prog		nvram_wr;
+
+	/* Parity recovery: the last BNX2X_PAR_REC_HIST events and the state
+	 * of the one in progress.
+	 */
+	struct bnx2x_par_rec_event		par_rec_hist[BNX2X_PAR_REC_HIST];
+	u32					par_rec_cnt;
+	struct bnx2x_par_rec_event		par_rec_cur;
+	ktime_t					par_rec_start;
+	bool					par_rec_active;
+	/* bnx2x_par_scoped_blocks[] entries pending a scoped recovery */
+	u32					par_scoped_pending;
+	unsigned long				par_scoped_last;
+
+	struct bnx2x_txq_reset_stats		txq_reset;
+
 	/* CAM credit pools */
 
 	struct bnx2x_credit_pool_obj		vlans_pool;
@@ -2390,6 +2648,14 @@ struct bnx2x {
 	struct cyclecounter cyclecounter;
 	struct timecounter timecounter;
 	bool timecounter_init_done;
+	/* Serializes timecounter updates; the PHC read fast path samples
+	 * phc_snap under its sequence count without taking the lock.
+	 */
+	seqlock_t phc_lock;
+	struct bnx2x_phc_snap phc_snap;
+#ifdef _HAS_PTP_GETTIMEX64
+	struct ptp_system_timestamp *phc_sts;
+#endif
 	struct sk_buff *ptp_tx_skb;
 	unsigned long ptp_tx_start;
 	bool hwtstamp_ioctl_called;
@@ -2428,6 +2694,10 @@ struct bnx2x {
 
 /* Tx queues may be less or equal to Rx queues */
 extern _UP_UINT2INT num_queues;
+extern uint pfc_storm_timeout;
+extern uint tx_hang_timeout;
+extern uint tx_done_batch;
+extern uint tx_done_ring_pct;
 #define BNX2X_NUM_QUEUES(bp)	(bp->num_queues)
 #ifndef BNX2X_CHAR_DEV /* BNX2X_UPSTREAM */
 #define BNX2X_NUM_ETH_QUEUES(bp) ((bp)->num_ethernet_queues)
@@ -2719,6 +2989,9 @@ void bnx2x_read_mf_cfg(struct bnx2x *bp);
 
 /* dmae */
 void bnx2x_read_dmae(struct bnx2x *bp, u32 src_addr, u32 len32);
+#ifndef BNX2X_UPSTREAM /* ! BNX2X_UPSTREAM */
+u32 *bnx2x_read_dmae_bulk(struct bnx2x *bp, u32 src_addr, u32 len32);
+#endif
 void bnx2x_write_dmae(struct bnx2x *bp, dma_addr_t dma_addr, u32 dst_addr,
 		      u32 len32);
 void bnx2x_post_dmae(struct bnx2x *bp, struct dmae_command *dmae, int idx);
@@ -2745,6 +3018,8 @@ int bnx2x_sp_post(struct bnx2x *bp, int command, int cid,
 		  u32 data_hi, u32 data_lo, int cmd_type);
 void bnx2x_update_coalesce(struct bnx2x *bp);
 int bnx2x_get_cur_phy_idx(struct bnx2x *bp);
+bool bnx2x_sfp_cache_read(struct bnx2x *bp, u8 dev_addr, u16 addr,
+			  u16 len, u8 *data);
 
 bool bnx2x_port_after_undi(struct bnx2x *bp);
 
@@ -3267,8 +3542,14 @@ int bnx2x_configure_ptp_filters(struct bnx2x *bp);
 void bnx2x_set_rx_ts(struct bnx2x *bp, struct sk_buff *skb);
 void bnx2x_register_phc(struct bnx2x *bp);
 
+int bnx2x_ptp_bench(struct bnx2x *bp, u32 iters);
+
 #define BNX2X_MAX_PHC_DRIFT 31000000
 #define BNX2X_PTP_TX_TIMEOUT (2 * HZ)
+/* Host time span over which the PHC rate is measured */
+#define BNX2X_PHC_RATE_WINDOW_NS	NSEC_PER_SEC
+/* Upper bound for the phc_extrapolate_us module parameter */
+#define BNX2X_PHC_MAX_EXTRAPOLATE_US	USEC_PER_SEC
 #endif
 
 /* Re-configure all previously configured vlan filters.
@@ -287,7 +287,7 @@ int bnx2x_load_count[2][3] = { {0} }; /* per-path: 0-common, 1-port0, 2-port1 */
  */
 static u16 bnx2x_free_tx_pkt(struct bnx2x *bp, struct bnx2x_fp_txdata *txdata,
 			     u16 idx, unsigned int *pkts_compl,
-			     unsigned int *bytes_compl)
+			     unsigned int *bytes_compl, int budget)
 {
 	struct sw_tx_bd *tx_buf = &txdata->tx_buf_ring[idx];
 	struct eth_tx_start_bd *tx_start_bd;
@@ -335,21 +335,27 @@ static u16 bnx2x_free_tx_pkt(struct bnx2x *bp, struct bnx2x_fp_txdata *txdata,
 		bd_idx = TX_BD(NEXT_TX_IDX(bd_idx));
 	}
 
-	/* unmap first bd */
+	/* unmap first bd, unless it points into the copybreak slab */
+	if (!(tx_buf->flags & BNX2X_TX_COPYBREAK_BD))
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 34)) /* BNX2X_UPSTREAM */
-	dma_unmap_single(&bp->pdev->dev, BD_UNMAP_ADDR(tx_start_bd),
-			 BD_UNMAP_LEN(tx_start_bd) + split_bd_len,
-			 DMA_TO_DEVICE);
+		dma_unmap_single(&bp->pdev->dev, BD_UNMAP_ADDR(tx_start_bd),
+				 BD_UNMAP_LEN(tx_start_bd) + split_bd_len,
+				 DMA_TO_DEVICE);
 #else
-	pci_unmap_single(bp->pdev, BD_UNMAP_ADDR(tx_start_bd),
-			 BD_UNMAP_LEN(tx_start_bd) + split_bd_len,
-			 PCI_DMA_TODEVICE);
+		pci_unmap_single(bp->pdev, BD_UNMAP_ADDR(tx_start_bd),
+				 BD_UNMAP_LEN(tx_start_bd) + split_bd_len,
+				 PCI_DMA_TODEVICE);
 #endif
 
 	/* now free frags */
 	while (nbd > 0) {
 
 		tx_data_bd = &txdata->tx_desc_ring[bd_idx].reg_bd;
+
+		/* the bounce area stays mapped */
+		if (unlikely((tx_buf->flags & BNX2X_TX_BOUNCE_BD) &&
+			     bd_idx == tx_buf->bounce_bd))
+			goto next_bd;
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 34)) /* BNX2X_UPSTREAM */
 		dma_unmap_page(&bp->pdev->dev, BD_UNMAP_ADDR(tx_data_bd),
 			       BD_UNMAP_LEN(tx_data_bd), DMA_TO_DEVICE);
@@ -357,6 +363,7 @@ static u16 bnx2x_free_tx_pkt(struct bnx2x *bp, struct bnx2x_fp_txdata *txdata,
 		pci_unmap_page(bp->pdev, BD_UNMAP_ADDR(tx_data_bd),
 			       BD_UNMAP_LEN(tx_data_bd), PCI_DMA_TODEVICE);
 #endif
+next_bd:
 		if (--nbd)
 			bd_idx = TX_BD(NEXT_TX_IDX(bd_idx));
 	}
@@ -366,7 +373,7 @@ static u16 bnx2x_free_tx_pkt(struct bnx2x *bp, struct bnx2x_fp_txdata *txdata,
 	if (likely(skb)) {
 		(*pkts_compl)++;
 		(*bytes_compl) += skb->len;
-		dev_kfree_skb_any(skb);
+		napi_consume_skb(skb, budget);
 	}
 
 	tx_buf->first_bd = 0;
@@ -375,11 +382,13 @@ static u16 bnx2x_free_tx_pkt(struct bnx2x *bp, struct bnx2x_fp_txdata *txdata,
 	return new_cons;
 }
 
-int bnx2x_tx_int(struct bnx2x *bp, struct bnx2x_fp_txdata *txdata)
+int bnx2x_tx_int(struct bnx2x *bp, struct bnx2x_fp_txdata *txdata,
+		 int budget)
 {
 	struct netdev_queue *txq;
 	u16 hw_cons, sw_cons, bd_cons = txdata->tx_bd_cons;
 	unsigned int pkts_compl = 0, bytes_compl = 0;
+	u16 done;
 
 #ifdef BNX2X_STOP_ON_ERROR
 	if (unlikely(bp->panic))
@@ -399,14 +408,26 @@ int bnx2x_tx_int(struct bnx2x *bp, struct bnx2x_fp_txdata *txdata)
 		   "queue[%d]: hw_cons %u  sw_cons %u  pkt_cons %u\n",
 		   txdata->txq_index, hw_cons, sw_cons, pkt_cons);
 
+		/* bounce slots are used in packet order */
+		if (unlikely(txdata->tx_buf_ring[pkt_cons].flags &
+			     BNX2X_TX_BOUNCE_BD))
+			txdata->tx_bounce_cons++;
+
 		bd_cons = bnx2x_free_tx_pkt(bp, txdata, pkt_cons,
-					    &pkts_compl, &bytes_compl);
+					    &pkts_compl, &bytes_compl, budget);
 
 		sw_cons++;
 	}
 
+	/* One BQL update for the whole batch */
 	netdev_tx_completed_queue(txq, pkts_compl, bytes_compl);
 
+	done = sw_cons - txdata->tx_pkt_cons;
+	if (done)
+		txdata->tx_done_hist[min_t(int, fls(done) - 1,
+					   BNX2X_TX_DONE_HIST - 1)]++;
+	txdata->tx_done_skip = 0;
+
 	txdata->tx_pkt_cons = sw_cons;
 	txdata->tx_bd_cons = bd_cons;
 
@@ -439,7 +460,7 @@ int bnx2x_tx_int(struct bnx2x *bp, struct bnx2x_fp_txdata *txdata)
 		__netif_tx_lock(txq, smp_processor_id());
 
 		if ((netif_tx_queue_stopped(txq)) &&
-		    (bp->state == BNX2X_STATE_OPEN) &&
+		    (bp->state == BNX2X_STATE_OPEN) && !txdata->tx_held &&
 #if !defined(__VMKLNX__) /* BNX2X_UPSTREAM */
 		    (bnx2x_tx_avail(bp, txdata) >= MAX_DESC_PER_TX_PKT))
 #else
@@ -466,6 +487,72 @@ int bnx2x_tx_int(struct bnx2x *bp, struct bnx2x_fp_txdata *txdata)
 	return 0;
 }
 
+/* Take or drop the @owner hold (BNX2X_TX_HOLD_*) on the netdev Tx queues of
+ * traffic class @cos on all ETH queues. A queue is stopped while any owner
+ * holds it and is only restarted once the last hold is dropped; held queues
+ * are not woken by bnx2x_tx_int().
+ */
+void bnx2x_tx_hold_tc(struct bnx2x *bp, u8 cos, u8 owner, bool hold)
+{
+	struct bnx2x_fp_txdata *txdata;
+	struct netdev_queue *txq;
+	bool wake;
+	int i;
+
+	for_each_eth_queue(bp, i) {
+		if (cos >= bp->fp[i].max_cos)
+			continue;
+
+		txdata = bp->fp[i].txdata_ptr[cos];
+		txq = netdev_get_tx_queue(bp->dev, txdata->txq_index);
+
+		__netif_tx_lock_bh(txq);
+		if (hold) {
+			txdata->tx_held |= owner;
+			netif_tx_stop_queue(txq);
+		} else {
+			txdata->tx_held &= ~owner;
+		}
+		wake = !txdata->tx_held;
+		__netif_tx_unlock_bh(txq);
+
+		if (!hold && wake)
+			netif_tx_wake_queue(txq);
+	}
+}
+
+#ifdef BNX2X_MULTI_QUEUE /* BNX2X_UPSTREAM */
+static bool bnx2x_txq_held(struct bnx2x *bp, int txq_index)
+{
+	struct bnx2x_fp_txdata *txdata;
+	int i;
+	u8 cos;
+
+	for_each_eth_queue(bp, i)
+		for_each_cos_in_tx_queue(&bp->fp[i], cos) {
+			txdata = bp->fp[i].txdata_ptr[cos];
+			if (txdata->txq_index == txq_index)
+				return txdata->tx_held;
+		}
+
+	return false;
+}
+#endif
+
+/* Wake all netdev Tx queues except the ones held by bnx2x_tx_hold_tc() */
+void bnx2x_tx_wake_all_unheld(struct bnx2x *bp)
+{
+#ifdef BNX2X_MULTI_QUEUE /* BNX2X_UPSTREAM */
+	int i;
+
+	for (i = 0; i < bp->dev->num_tx_queues; i++)
+		if (!bnx2x_txq_held(bp, i))
+			netif_tx_wake_queue(netdev_get_tx_queue(bp->dev, i));
+#else
+	netif_tx_wake_all_queues(bp->dev);
+#endif
+}
+
 #if !defined(__NO_TPA__) /* BNX2X_UPSTREAM */
 static inline void bnx2x_update_last_max_sge(struct bnx2x_fastpath *fp,
 					     u16 idx)
@@ -1894,87 +1981,86 @@ void bnx2x_init_rx_rings_cnic(struct bnx2x *bp)
 	}
 }
 
-#if (!defined(__VMKLNX__) || !DYNAMIC_NETQ_ALLOC) /* BNX2X_UPSTREAM */
-int bnx2x_init_rx_rings(struct bnx2x *bp)
-#else
-int bnx2x_esx_init_rx_ring(struct bnx2x *bp, int esx_netq_index)
-#endif
+/* Fill the TPA aggregation pool and the SGE ring of @fp. On allocation
+ * failure TPA is disabled on the queue and -EIO is returned.
+ */
+static int bnx2x_init_rx_tpa(struct bnx2x *bp, struct bnx2x_fastpath *fp)
 {
-	int func = BP_FUNC(bp);
 	u16 ring_prod;
-	int i, j, rc = 0;
+	int i;
 
-	/* Allocate TPA resources */
-	for_each_eth_queue_(bp, j) {
-		struct bnx2x_fastpath *fp = &bp->fp[j];
+	DP(NETIF_MSG_IFUP,
+	   "mtu %d  rx_buf_size %d\n", bp->dev->mtu, fp->rx_buf_size);
 
-		DP(NETIF_MSG_IFUP,
-		   "mtu %d  rx_buf_size %d\n", bp->dev->mtu, fp->rx_buf_size);
+	if (fp->mode == TPA_MODE_DISABLED)
+		return 0;
 
-		if (fp->mode != TPA_MODE_DISABLED) {
-			/* Fill the per-aggregation pool */
-			for (i = 0; i < MAX_AGG_QS(bp); i++) {
-				struct bnx2x_agg_info *tpa_info =
-					&fp->tpa_info[i];
-				struct sw_rx_bd *first_buf =
-					&tpa_info->first_buf;
+	/* Fill the per-aggregation pool */
+	for (i = 0; i < MAX_AGG_QS(bp); i++) {
+		struct bnx2x_agg_info *tpa_info = &fp->tpa_info[i];
+		struct sw_rx_bd *first_buf = &tpa_info->first_buf;
 
 #ifdef BCM_HAS_BUILD_SKB /* BNX2X_UPSTREAM */
-				first_buf->data =
-					bnx2x_frag_alloc(fp, GFP_KERNEL);
+		first_buf->data = bnx2x_frag_alloc(fp, GFP_KERNEL);
 #else
-				first_buf->data = netdev_alloc_skb(bp->dev,
-						       fp->rx_buf_size);
-#endif
-				if (!first_buf->data) {
-					BNX2X_ERR("Failed to allocate TPA skb pool for queue[%d] - disabling TPA on this queue!\n",
-						  j);
-					bnx2x_free_tpa_pool(bp, fp, i);
-					fp->mode = TPA_MODE_DISABLED;
-					rc = -EIO;
-					break;
-				}
+		first_buf->data = netdev_alloc_skb(bp->dev, fp->rx_buf_size);
+#endif
+		if (!first_buf->data) {
+			BNX2X_ERR("Failed to allocate TPA skb pool for queue[%d] - disabling TPA on this queue!\n",
+				  fp->index);
+			bnx2x_free_tpa_pool(bp, fp, i);
+			fp->mode = TPA_MODE_DISABLED;
+			return -EIO;
+		}
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 34)) /* BNX2X_UPSTREAM */
-				dma_unmap_addr_set(first_buf, mapping, 0);
+		dma_unmap_addr_set(first_buf, mapping, 0);
 #else
-				pci_unmap_addr_set(first_buf, mapping, 0);
+		pci_unmap_addr_set(first_buf, mapping, 0);
 #endif
-				tpa_info->tpa_state = BNX2X_TPA_STOP;
-			}
+		tpa_info->tpa_state = BNX2X_TPA_STOP;
+	}
 
-			/* "next page" elements initialization */
-			bnx2x_set_next_page_sgl(fp);
-
-			/* set SGEs bit mask */
-			bnx2x_init_sge_ring_bit_mask(fp);
-
-			/* Allocate SGEs and initialize the ring elements */
-			for (i = 0, ring_prod = 0;
-			     i < MAX_RX_SGE_CNT*NUM_RX_SGE_PAGES; i++) {
-
-				if (bnx2x_alloc_rx_sge(bp, fp, ring_prod,
-						       GFP_KERNEL) < 0) {
-					BNX2X_ERR("was only able to allocate %d rx sges\n",
-						  i);
-					BNX2X_ERR("disabling TPA for queue[%d]\n",
-						  j);
-					/* Cleanup already allocated elements */
-					bnx2x_free_rx_sge_range(bp, fp,
-								ring_prod);
-					bnx2x_free_tpa_pool(bp, fp,
-							    MAX_AGG_QS(bp));
-					fp->mode = TPA_MODE_DISABLED;
-					ring_prod = 0;
-					rc = -EIO;
-					break;
-				}
-				ring_prod = NEXT_SGE_IDX(ring_prod);
-			}
+	/* "next page" elements initialization */
+	bnx2x_set_next_page_sgl(fp);
+
+	/* set SGEs bit mask */
+	bnx2x_init_sge_ring_bit_mask(fp);
+
+	/* Allocate SGEs and initialize the ring elements */
+	for (i = 0, ring_prod = 0;
+	     i < MAX_RX_SGE_CNT*NUM_RX_SGE_PAGES; i++) {
 
-			fp->rx_sge_prod = ring_prod;
+		if (bnx2x_alloc_rx_sge(bp, fp, ring_prod, GFP_KERNEL) < 0) {
+			BNX2X_ERR("was only able to allocate %d rx sges\n", i);
+			BNX2X_ERR("disabling TPA for queue[%d]\n", fp->index);
+			/* Cleanup already allocated elements */
+			bnx2x_free_rx_sge_range(bp, fp, ring_prod);
+			bnx2x_free_tpa_pool(bp, fp, MAX_AGG_QS(bp));
+			fp->mode = TPA_MODE_DISABLED;
+			fp->rx_sge_prod = 0;
+			return -EIO;
 		}
+		ring_prod = NEXT_SGE_IDX(ring_prod);
 	}
 
+	fp->rx_sge_prod = ring_prod;
+	return 0;
+}
+
+#if (!defined(__VMKLNX__) || !DYNAMIC_NETQ_ALLOC) /* BNX2X_UPSTREAM */
+int bnx2x_init_rx_rings(struct bnx2x *bp)
+#else
+int bnx2x_esx_init_rx_ring(struct bnx2x *bp, int esx_netq_index)
+#endif
+{
+	int func = BP_FUNC(bp);
+	int j, rc = 0;
+
+	/* Allocate TPA resources */
+	for_each_eth_queue_(bp, j)
+		if (bnx2x_init_rx_tpa(bp, &bp->fp[j]))
+			rc = -EIO;
+
 	for_each_eth_queue_(bp, j) {
 		struct bnx2x_fastpath *fp = &bp->fp[j];
 
@@ -2017,7 +2103,7 @@ _STAEU void bnx2x_free_tx_skbs_queue(struct bnx2x_fastpath *fp)
 
 		while (sw_cons != sw_prod) {
 			bnx2x_free_tx_pkt(bp, txdata, TX_BD(sw_cons),
-					  &pkts_compl, &bytes_compl);
+					  &pkts_compl, &bytes_compl, 0);
 			sw_cons++;
 		}
 #if defined(__VMKLNX__) /* !BNX2X_UPSTREAM */
@@ -2525,7 +2611,7 @@ void bnx2x_netif_start(struct bnx2x *bp)
 			bnx2x_napi_enable_cnic(bp);
 		bnx2x_int_enable(bp);
 		if (bp->state == BNX2X_STATE_OPEN) {
-			netif_tx_wake_all_queues(bp->dev);
+			bnx2x_tx_wake_all_unheld(bp);
 #if defined(BNX2X_ESX_CNA) /* ! BNX2X_UPSTREAM */
 			if ((bp->flags & CNA_ENABLED) &&
 			    BNX2X_IS_NETQ_TX_QUEUE_ALLOCATED(
@@ -4111,6 +4197,28 @@ int bnx2x_set_power_state(struct bnx2x *bp, pci_power_t state)
 /*
  * net_device service functions
  */
+#ifdef BNX2X_NEW_NAPI /* BNX2X_UPSTREAM */
+/* Leave the completions of @txdata to a later poll of the same NAPI run
+ * while fewer than tx_done_batch packets are done and the ring isn't filling
+ * up, so that they are reclaimed in larger batches.
+ */
+static bool bnx2x_tx_int_defer(struct bnx2x *bp,
+			       struct bnx2x_fp_txdata *txdata)
+{
+	u16 done = le16_to_cpu(*txdata->tx_cons_sb) - txdata->tx_pkt_cons;
+	int used = txdata->tx_ring_size - bnx2x_tx_avail(bp, txdata);
+
+	if (!tx_done_batch || done >= tx_done_batch ||
+	    txdata->tx_done_skip >= BNX2X_TX_DONE_MAX_SKIP ||
+	    used * 100 >= txdata->tx_ring_size * (int)tx_done_ring_pct)
+		return false;
+
+	txdata->tx_done_skip++;
+	txdata->tx_done_deferred++;
+	return true;
+}
+#endif
+
 #if defined(BNX2X_NEW_NAPI) /* BNX2X_UPSTREAM */
 _STAEU int bnx2x_poll(struct napi_struct *napi, int budget)
 #else
@@ -4142,11 +4250,25 @@ int bnx2x_poll(struct net_device *dev, int *budget)
 #endif
 	for_each_cos_in_tx_queue(fp, cos)
 		if (bnx2x_tx_queue_has_work(fp->txdata_ptr[cos]))
-			bnx2x_tx_int(bp, fp->txdata_ptr[cos]);
+#ifdef BNX2X_NEW_NAPI /* BNX2X_UPSTREAM */
+			if (!bnx2x_tx_int_defer(bp, fp->txdata_ptr[cos]))
+				bnx2x_tx_int(bp, fp->txdata_ptr[cos], budget);
+#else
+			bnx2x_tx_int(bp, fp->txdata_ptr[cos], 0);
+#endif
 
 #ifdef BNX2X_NEW_NAPI /* BNX2X_UPSTREAM */
 	rx_work_done = (bnx2x_has_rx_work(fp)) ? bnx2x_rx_int(fp, budget) : 0;
 	if (rx_work_done < budget) {
+		/* NAPI may complete: reclaim whatever was deferred above */
+		if (tx_done_batch)
+			for_each_cos_in_tx_queue(fp, cos) {
+				struct bnx2x_fp_txdata *txdata =
+					fp->txdata_ptr[cos];
+
+				if (bnx2x_tx_queue_has_work(txdata))
+					bnx2x_tx_int(bp, txdata, budget);
+			}
 #else
 	rx_work_done = (bnx2x_has_rx_work(fp)) ?
 		       bnx2x_rx_int(fp, min(*budget, dev->quota)) : 0;
@@ -4432,8 +4554,95 @@ exit_lbl:
 
 	return to_copy;
 }
+
+/**
+ * bnx2x_tx_bounce_plan - pick the frags to copy into the bounce area.
+ *
+ * @txdata:	tx queue
+ * @skb:	packet violating the FW fetch window
+ * @xmit_type:	xmit flags
+ * @run:	returns the number of frags to copy
+ * @off:	returns the offset in the skb of the first frag to copy
+ * @len:	returns the number of bytes to copy
+ *
+ * Merging a run of consecutive frags into a single BD brings the packet
+ * below the number of frags for which the FW window has to be checked at
+ * all; the shortest such run is chosen. Returns the index of its first
+ * frag, or -1 if no slot is free or the run does not fit one, in which
+ * case the skb has to be linearized.
+ */
+static int bnx2x_tx_bounce_plan(struct bnx2x_fp_txdata *txdata,
+				struct sk_buff *skb, u32 xmit_type,
+				int *run, u32 *off, u32 *len)
+{
+	int num_tso_win_sub = BNX2X_NUM_TSO_WIN_SUB_BDS;
+	int nr_frags = skb_shinfo(skb)->nr_frags;
+	int i, first = 0;
+	u32 sum = 0, best, skip = 0;
+
+	if (!txdata->tx_bounce ||
+	    (u16)(txdata->tx_bounce_prod - txdata->tx_bounce_cons) >=
+	    BNX2X_TX_BOUNCE_SLOTS)
+		return -1;
+
+	if (xmit_type & XMIT_GSO_ENC)
+		num_tso_win_sub = BNX2X_NUM_VXLAN_TSO_WIN_SUB_BDS;
+
+	*run = nr_frags - (MAX_FETCH_BD - num_tso_win_sub) + 2;
+	if (*run < 2 || *run > nr_frags)
+		return -1;
+
+	for (i = 0; i < *run; i++)
+		sum += skb_frag_size(&skb_shinfo(skb)->frags[i]);
+	best = sum;
+
+	for (i = *run; i < nr_frags; i++) {
+		sum += skb_frag_size(&skb_shinfo(skb)->frags[i]);
+		sum -= skb_frag_size(&skb_shinfo(skb)->frags[i - *run]);
+		if (sum < best) {
+			best = sum;
+			first = i - *run + 1;
+		}
+	}
+
+	if (best > BNX2X_TX_BOUNCE_SLOT_SZ)
+		return -1;
+
+	for (i = 0; i < first; i++)
+		skip += skb_frag_size(&skb_shinfo(skb)->frags[i]);
+
+	*off = skb_headlen(skb) + skip;
+	*len = best;
+
+	return first;
+}
+
+/* copy len bytes of the skb into the next bounce slot, return its mapping */
+static dma_addr_t bnx2x_tx_bounce_copy(struct bnx2x_fp_txdata *txdata,
+				       struct sk_buff *skb, u32 off, u32 len)
+{
+	u32 slot_off = (txdata->tx_bounce_prod % BNX2X_TX_BOUNCE_SLOTS) *
+		       BNX2X_TX_BOUNCE_SLOT_SZ;
+
+	skb_copy_bits(skb, off, txdata->tx_bounce + slot_off, len);
+	txdata->tx_bounce_prod++;
+
+	return txdata->tx_bounce_mapping + slot_off;
+}
 #endif
 
+/* copybreak slot of the packet starting at BD bd */
+static u8 *bnx2x_tx_cb_slot(struct bnx2x_fp_txdata *txdata, u16 bd,
+			    dma_addr_t *mapping)
+{
+	u32 slot = TX_BD(bd) >> 1;
+	u32 page = slot / BNX2X_TX_CB_SLOTS_PER_PAGE;
+	u32 off = (slot % BNX2X_TX_CB_SLOTS_PER_PAGE) * BNX2X_TX_COPYBREAK_MAX;
+
+	*mapping = txdata->tx_cb_mapping[page] + off;
+	return txdata->tx_cb_buf[page] + off;
+}
+
 #ifdef NETIF_F_TSO /* BNX2X_UPSTREAM */
 /**
  * bnx2x_set_pbd_gso - update PBD in GSO case.
@@ -4732,6 +4941,12 @@ netdev_tx_t bnx2x_start_xmit(struct sk_buff *skb, struct net_device *dev)
 	int i;
 	u8 hlen = 0;
 	__le16 pkt_size = 0;
+	bool copybreak;
+	int nr_frags;
+#if (MAX_SKB_FRAGS >= MAX_FETCH_BD - BDS_PER_TX_PKT)
+	int bounce_first = -1, bounce_run = 0;
+	u32 bounce_off = 0, bounce_len = 0;
+#endif
 	struct ethhdr *eth;
 	u8 mac_type = UNICAST_ADDRESS;
 
@@ -4833,25 +5048,58 @@ netdev_tx_t bnx2x_start_xmit(struct sk_buff *skb, struct net_device *dev)
 		}
 	}
 #endif
+	/* Small packets are copied into the copybreak slab, which is cheaper
+	 * than mapping and unmapping them.
+	 */
+	copybreak = txdata->tx_cb_buf && skb->len <= bp->tx_copybreak &&
+		    !(xmit_type & XMIT_GSO);
+
 #if (MAX_SKB_FRAGS >= MAX_FETCH_BD - BDS_PER_TX_PKT)
 	/* First, check if we need to linearize the skb (due to FW
 	   restrictions). No need to check fragmentation if page size > 8K
 	   (there will be no violation to FW restrictions) */
-	if (bnx2x_pkt_req_lin(bp, skb, xmit_type)) {
+	if (!copybreak && bnx2x_pkt_req_lin(bp, skb, xmit_type)) {
+		struct bnx2x_eth_q_stats *q_stats =
+			bnx2x_fp_qstats(bp, txdata->parent_fp);
+
 		/* Statistics of linearization */
 		bp->lin_cnt++;
+
+		/* Prefer copying only the offending frags */
+		bounce_first = bnx2x_tx_bounce_plan(txdata, skb, xmit_type,
+						    &bounce_run, &bounce_off,
+						    &bounce_len);
+		if (bounce_first >= 0) {
+			q_stats->tx_bounce_pkts++;
+			ADD_64(q_stats->tx_bounce_bytes_hi, 0,
+			       q_stats->tx_bounce_bytes_lo, bounce_len);
+		} else {
+			q_stats->tx_lin_pkts++;
+			ADD_64(q_stats->tx_lin_bytes_hi, 0,
+			       q_stats->tx_lin_bytes_lo, skb->data_len);
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 17)) || defined(SLE_VERSION_CODE) /* BNX2X_UPSTREAM */
-		if (skb_linearize(skb) != 0) {
+			if (skb_linearize(skb) != 0) {
 #else
-		if (skb_linearize(skb, GFP_ATOMIC) != 0) {
+			if (skb_linearize(skb, GFP_ATOMIC) != 0) {
 #endif
-			DP(NETIF_MSG_TX_QUEUED,
-			   "SKB linearization failed - silently dropping this SKB\n");
-			dev_kfree_skb_any(skb);
-			return NETDEV_TX_OK;
+				DP(NETIF_MSG_TX_QUEUED,
+				   "SKB linearization failed - silently dropping this SKB\n");
+				dev_kfree_skb_any(skb);
+				return NETDEV_TX_OK;
+			}
 		}
 	}
 #endif
+	nr_frags = skb_shinfo(skb)->nr_frags;
+	if (copybreak) {
+		u8 *buf = bnx2x_tx_cb_slot(txdata, txdata->tx_bd_prod,
+					   &mapping);
+
+		skb_copy_bits(skb, 0, buf, skb->len);
+		nr_frags = 0;
+		goto linear_mapped;
+	}
+
 	/* Map skb linear data for DMA */
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 34)) /* BNX2X_UPSTREAM */
 	mapping = dma_map_single(&bp->pdev->dev, skb->data,
@@ -4870,6 +5118,7 @@ netdev_tx_t bnx2x_start_xmit(struct sk_buff *skb, struct net_device *dev)
 		dev_kfree_skb_any(skb);
 		return NETDEV_TX_OK;
 	}
+linear_mapped:
 	/*
 	Please read carefully. First we use one BD which we mark as start,
 	then we have a parsing info BD (used for TSO or xsum),
@@ -4919,7 +5168,7 @@ netdev_tx_t bnx2x_start_xmit(struct sk_buff *skb, struct net_device *dev)
 	/* remember the first BD of the packet */
 	tx_buf->first_bd = txdata->tx_bd_prod;
 	tx_buf->skb = skb;
-	tx_buf->flags = 0;
+	tx_buf->flags = copybreak ? BNX2X_TX_COPYBREAK_BD : 0;
 
 	DP(NETIF_MSG_TX_QUEUED,
 	   "sending pkt %u @%p  next_idx %u  bd %u @%p\n",
@@ -5106,7 +5355,8 @@ donot_place_vlan_tagging:
 	/* Setup the data pointer of the first BD of the packet */
 	tx_start_bd->addr_hi = cpu_to_le32(U64_HI(mapping));
 	tx_start_bd->addr_lo = cpu_to_le32(U64_LO(mapping));
-	tx_start_bd->nbytes = cpu_to_le16(skb_headlen(skb));
+	tx_start_bd->nbytes = cpu_to_le16(copybreak ? skb->len :
+						      skb_headlen(skb));
 	pkt_size = tx_start_bd->nbytes;
 
 	DP(NETIF_MSG_TX_QUEUED,
@@ -5151,9 +5401,23 @@ donot_place_vlan_tagging:
 	tx_data_bd = (struct eth_tx_bd *)tx_start_bd;
 
 	/* Handle fragmented skb */
-	for (i = 0; i < skb_shinfo(skb)->nr_frags; i++) {
+	for (i = 0; i < nr_frags; i++) {
 		skb_frag_t *frag = &skb_shinfo(skb)->frags[i];
+		u32 frag_len = skb_frag_size(frag);
 
+#if (MAX_SKB_FRAGS >= MAX_FETCH_BD - BDS_PER_TX_PKT)
+		if (unlikely(i == bounce_first)) {
+			mapping = bnx2x_tx_bounce_copy(txdata, skb, bounce_off,
+						       bounce_len);
+			frag_len = bounce_len;
+			i += bounce_run - 1;
+
+			bd_prod = TX_BD(NEXT_TX_IDX(bd_prod));
+			tx_buf->flags |= BNX2X_TX_BOUNCE_BD;
+			tx_buf->bounce_bd = bd_prod;
+			goto fill_bd;
+		}
+#endif
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 34)) /* BNX2X_UPSTREAM */
 		mapping = skb_frag_dma_map(&bp->pdev->dev, frag, 0,
 					   skb_frag_size(frag), DMA_TO_DEVICE);
@@ -5177,21 +5441,28 @@ donot_place_vlan_tagging:
 			 * before call to bnx2x_free_tx_pkt
 			 */
 			first_bd->nbd = cpu_to_le16(nbd);
+
+			/* the newest bounce slot can simply be given back */
+			if (tx_buf->flags & BNX2X_TX_BOUNCE_BD)
+				txdata->tx_bounce_prod--;
 			bnx2x_free_tx_pkt(bp, txdata,
 					  TX_BD(txdata->tx_pkt_prod),
-					  &pkts_compl, &bytes_compl);
+					  &pkts_compl, &bytes_compl, 0);
 			return NETDEV_TX_OK;
 		}
 
 		bd_prod = TX_BD(NEXT_TX_IDX(bd_prod));
+#if (MAX_SKB_FRAGS >= MAX_FETCH_BD - BDS_PER_TX_PKT)
+fill_bd:
+#endif
 		tx_data_bd = &txdata->tx_desc_ring[bd_prod].reg_bd;
 		if (total_pkt_bd == NULL)
 			total_pkt_bd = &txdata->tx_desc_ring[bd_prod].reg_bd;
 
 		tx_data_bd->addr_hi = cpu_to_le32(U64_HI(mapping));
 		tx_data_bd->addr_lo = cpu_to_le32(U64_LO(mapping));
-		tx_data_bd->nbytes = cpu_to_le16(skb_frag_size(frag));
-		le16_add_cpu(&pkt_size, skb_frag_size(frag));
+		tx_data_bd->nbytes = cpu_to_le16(frag_len);
+		le16_add_cpu(&pkt_size, frag_len);
 		nbd++;
 
 		DP(NETIF_MSG_TX_QUEUED,
@@ -5479,6 +5750,49 @@ int bnx2x_change_mac_addr(struct net_device *dev, void *p)
 	return rc;
 }
 
+static void bnx2x_free_tx_cb(struct bnx2x *bp,
+			     struct bnx2x_fp_txdata *txdata)
+{
+	int i;
+
+	if (txdata->tx_cb_buf && txdata->tx_cb_mapping)
+		for (i = 0; i < BNX2X_TX_CB_PAGES; i++)
+			BNX2X_PCI_FREE(txdata->tx_cb_buf[i],
+				       txdata->tx_cb_mapping[i],
+				       BCM_PAGE_SIZE);
+
+	BNX2X_FREE(txdata->tx_cb_buf);
+	BNX2X_FREE(txdata->tx_cb_mapping);
+}
+
+/* Failure is not fatal - the queue then maps every packet */
+static void bnx2x_alloc_tx_cb(struct bnx2x *bp,
+			      struct bnx2x_fp_txdata *txdata)
+{
+	int i;
+
+	txdata->tx_cb_buf = kcalloc(BNX2X_TX_CB_PAGES, sizeof(u8 *),
+				    GFP_KERNEL);
+	txdata->tx_cb_mapping = kcalloc(BNX2X_TX_CB_PAGES, sizeof(dma_addr_t),
+					GFP_KERNEL);
+	if (!txdata->tx_cb_buf || !txdata->tx_cb_mapping)
+		goto alloc_err;
+
+	for (i = 0; i < BNX2X_TX_CB_PAGES; i++) {
+		txdata->tx_cb_buf[i] =
+			BNX2X_PCI_ALLOC(&txdata->tx_cb_mapping[i],
+					BCM_PAGE_SIZE);
+		if (!txdata->tx_cb_buf[i])
+			goto alloc_err;
+	}
+
+	return;
+
+alloc_err:
+	BNX2X_ERR("Failed to allocate the Tx copybreak slab, copybreak is disabled on this queue\n");
+	bnx2x_free_tx_cb(bp, txdata);
+}
+
 static void bnx2x_free_fp_mem_at(struct bnx2x *bp, int fp_index)
 {
 	union host_hc_status_block *sb = &bnx2x_fp(bp, fp_index, status_blk);
@@ -5548,6 +5862,10 @@ static void bnx2x_free_fp_mem_at(struct bnx2x *bp, int fp_index)
 			BNX2X_PCI_FREE(txdata->tx_desc_ring,
 				txdata->tx_desc_mapping,
 				sizeof(union eth_tx_bd_types) * NUM_TX_BD);
+			BNX2X_PCI_FREE(txdata->tx_bounce,
+				       txdata->tx_bounce_mapping,
+				       BNX2X_TX_BOUNCE_SZ);
+			bnx2x_free_tx_cb(bp, txdata);
 		}
 	}
 	/* end of fastpath */
@@ -5644,6 +5962,41 @@ static void bnx2x_set_next_page_rx_cq(struct bnx2x_fastpath *fp)
 	}
 }
 
+#if !defined(__VMKLNX__) /* BNX2X_UPSTREAM */
+int bnx2x_reinit_queue_rings(struct bnx2x_fastpath *fp)
+{
+	struct bnx2x *bp = fp->bp;
+	u8 cos;
+
+	bnx2x_free_tx_skbs_queue(fp);
+	for_each_cos_in_tx_queue(fp, cos)
+		bnx2x_init_tx_ring_one(fp->txdata_ptr[cos]);
+
+	bnx2x_free_rx_bds(fp);
+	if (fp->mode != TPA_MODE_DISABLED) {
+		bnx2x_free_tpa_pool(bp, fp, MAX_AGG_QS(bp));
+		bnx2x_free_rx_sge_range(bp, fp, NUM_RX_SGE);
+	}
+
+	/* The new connection completes from the start of the RCQ; re-seed
+	 * every CQE so that stale completions are not taken as new ones.
+	 */
+	memset(fp->rx_comp_ring, 0xff,
+	       sizeof(struct eth_fast_path_rx_cqe) * NUM_RCQ_BD);
+	bnx2x_set_next_page_rx_cq(fp);
+
+	if (bnx2x_alloc_rx_bds(fp, bp->rx_ring_size) < bp->rx_ring_size)
+		return -ENOMEM;
+
+	bnx2x_init_rx_tpa(bp, fp);
+
+	fp->rx_bd_cons = 0;
+	bnx2x_update_rx_prod(bp, fp, fp->rx_bd_prod, fp->rx_comp_prod,
+			     fp->rx_sge_prod);
+	return 0;
+}
+#endif
+
 #if (!defined(__VMKLNX__) || !DYNAMIC_NETQ_ALLOC) /* BNX2X_UPSTREAM */
 static int bnx2x_alloc_fp_mem_at(struct bnx2x *bp, int index)
 #else
@@ -5740,6 +6093,14 @@ int bnx2x_esx_alloc_fp_mem_at(struct bnx2x *bp, int index, int alloc_skb)
 							       sizeof(union eth_tx_bd_types) * NUM_TX_BD);
 			if (!txdata->tx_desc_ring)
 				goto alloc_mem_err;
+#if (MAX_SKB_FRAGS >= MAX_FETCH_BD - BDS_PER_TX_PKT)
+			/* not fatal - such packets are linearized instead */
+			txdata->tx_bounce =
+				BNX2X_PCI_ALLOC(&txdata->tx_bounce_mapping,
+						BNX2X_TX_BOUNCE_SZ);
+#endif
+			if (bp->tx_copybreak)
+				bnx2x_alloc_tx_cb(bp, txdata);
 		}
 	}
 
@@ -6284,6 +6645,39 @@ int bnx2x_set_features(struct net_device *dev, netdev_features_t features)
 }
 #endif /* ndo_[fix|set]_features */
 
+#if defined(_HAS_NDO_TX_TIMEOUT_TXQUEQUE) && !defined(__VMKLNX__) /* BNX2X_UPSTREAM */
+/* Flag the RSS queue owning netdev Tx queue @txqueue for a reset of its own.
+ * Returns false if the queue can't be reset without reloading the function.
+ */
+static bool bnx2x_tx_timeout_queue(struct bnx2x *bp, unsigned int txqueue)
+{
+	struct bnx2x_fastpath *fp;
+	int i;
+	u8 cos;
+
+	if (!tx_hang_timeout || !IS_PF(bp) || bp->state != BNX2X_STATE_OPEN)
+		return false;
+
+	for_each_nondefault_eth_queue(bp, i) {
+		fp = &bp->fp[i];
+		for_each_cos_in_tx_queue(fp, cos) {
+			if (fp->txdata_ptr[cos]->txq_index != txqueue)
+				continue;
+
+			netdev_info(bp->dev, "Tx timeout on queue %d.%d\n",
+				    i, cos);
+			bp->txq_reset.timeouts++;
+			fp->tx_hang_reset = true;
+			bnx2x_schedule_sp_rtnl(bp, BNX2X_SP_RTNL_TX_QUEUE_RESET,
+					       0);
+			return true;
+		}
+	}
+
+	return false;
+}
+#endif
+
 #ifdef _HAS_NDO_TX_TIMEOUT_TXQUEQUE
 void bnx2x_tx_timeout(struct net_device *dev, unsigned int txqueue)
 #else
@@ -6325,6 +6719,10 @@ void bnx2x_tx_timeout(struct net_device *dev)
 		bnx2x_panic();
 #endif
 
+#endif
+#if defined(_HAS_NDO_TX_TIMEOUT_TXQUEQUE) && !defined(__VMKLNX__) /* BNX2X_UPSTREAM */
+	if (bnx2x_tx_timeout_queue(bp, txqueue))
+		return;
 #endif
 	/* This allows the netif to be shutdown gracefully before resetting */
 	bnx2x_schedule_sp_rtnl(bp, BNX2X_SP_RTNL_TX_TIMEOUT, 0);
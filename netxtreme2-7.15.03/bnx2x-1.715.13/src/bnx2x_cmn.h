@@ -187,6 +187,18 @@ void bnx2x_init_eth_fp(struct bnx2x *bp, int fp_idx);
 int bnx2x_stop_queue(struct bnx2x *bp, int index);
 #endif
 
+#if !defined(__VMKLNX__) /* BNX2X_UPSTREAM */
+/**
+ * bnx2x_reinit_queue_rings - re-initialize the rings of a stopped queue
+ *
+ * @fp:		fastpath of an ETH queue whose connections were deleted
+ *
+ * Frees the Tx packets and Rx buffers still posted on the queue and fills
+ * its rings again the way the load flow does, ready for a new SETUP.
+ */
+int bnx2x_reinit_queue_rings(struct bnx2x_fastpath *fp);
+#endif
+
 /**
  * bnx2x_setup_leading - bring up a leading eth queue.
  *
@@ -228,6 +240,16 @@ void bnx2x_link_set(struct bnx2x *bp);
  */
 void bnx2x_force_link_reset(struct bnx2x *bp);
 
+/**
+ * bnx2x_link_reconfig - apply new link parameters.
+ *
+ * @bp:		driver handle
+ *
+ * Resets the link and re-runs phy init, unless the link is up with exactly
+ * the requested parameters.
+ */
+void bnx2x_link_reconfig(struct bnx2x *bp);
+
 /**
  * bnx2x_link_test - query link status.
  *
@@ -669,7 +691,8 @@ int bnx2x_change_mac_addr(struct net_device *dev, void *p);
 
 _UP_STATIC int bnx2x_rx_int(struct bnx2x_fastpath *fp, int budget);
 /* NAPI poll Tx part */
-int bnx2x_tx_int(struct bnx2x *bp, struct bnx2x_fp_txdata *txdata);
+int bnx2x_tx_int(struct bnx2x *bp, struct bnx2x_fp_txdata *txdata,
+		 int budget);
 
 /* suspend/resume callbacks */
 int bnx2x_suspend(struct pci_dev *pdev, pm_message_t state);
@@ -1660,6 +1683,9 @@ static inline void bnx2x_init_fwd_fp(struct bnx2x *bp)
 }
 #endif /* OOO */
 
+void bnx2x_tx_hold_tc(struct bnx2x *bp, u8 cos, u8 owner, bool hold);
+void bnx2x_tx_wake_all_unheld(struct bnx2x *bp);
+
 static inline int bnx2x_clean_tx_queue(struct bnx2x *bp,
 				       struct bnx2x_fp_txdata *txdata)
 {
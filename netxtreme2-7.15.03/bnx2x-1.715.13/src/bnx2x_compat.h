@@ -2756,6 +2756,10 @@ static __always_inline void __write_once_size(volatile void *p, void *res, int s
 #define skb_free_frag(data) put_page(virt_to_head_page(data))
 #endif
 
+#if defined(_DEFINE_NAPI_CONSUME_SKB) || defined(__VMKLNX__)
+#define napi_consume_skb(skb, budget) dev_kfree_skb_any(skb)
+#endif
+
 #ifdef _DEFINE_GFP_ALLOW_BLOCKING
 #define gfpflags_allow_blocking(mask)	((mask) & __GFP_WAIT)
 #endif
@@ -510,6 +510,232 @@ int bnx2x_dcbx_resume_hw_tx(struct bnx2x *bp)
 	return rc;
 }
 
+/* Compare the port params of a new DCBX negotiation with the previous ones.
+ * Returns the mask of CoSes whose ETS or PFC settings have changed. *remap
+ * is set if the priority to CoS mapping handed to the FW by TX_START has
+ * changed; that can only be applied under a function-wide Tx stop.
+ */
+static unsigned long
+bnx2x_dcbx_changed_tcs(struct bnx2x *bp, struct bnx2x_dcbx_port_params *old,
+		       u32 old_error, bool *remap)
+{
+	struct bnx2x_dcbx_port_params *cur = &bp->dcbx_port_params;
+	unsigned long all = (1UL << cur->ets.num_of_cos) - 1;
+	unsigned long tcs = 0;
+	u32 pause_changed;
+	u8 cos;
+
+	*remap = (cur->ets.num_of_cos != old->ets.num_of_cos) ||
+		 memcmp(&cur->app, &old->app, sizeof(cur->app)) ||
+		 ((bp->dcbx_error ^ old_error) & DCBX_REMOTE_MIB_ERROR);
+
+	for (cos = 0; cos < cur->ets.num_of_cos && !*remap; cos++)
+		if (cur->ets.cos_params[cos].pri_bitmask !=
+		    old->ets.cos_params[cos].pri_bitmask)
+			*remap = true;
+
+	if (*remap)
+		return all;
+
+	if (cur->ets.enabled != old->ets.enabled ||
+	    cur->pfc.enabled != old->pfc.enabled)
+		return all;
+
+	pause_changed = cur->pfc.priority_non_pauseable_mask ^
+			old->pfc.priority_non_pauseable_mask;
+
+	for (cos = 0; cos < cur->ets.num_of_cos; cos++) {
+		struct bnx2x_dcbx_cos_params *c = &cur->ets.cos_params[cos];
+		struct bnx2x_dcbx_cos_params *o = &old->ets.cos_params[cos];
+
+		if (c->bw_tbl != o->bw_tbl || c->strict != o->strict ||
+		    c->pauseable != o->pauseable ||
+		    (c->pri_bitmask & pause_changed))
+			__set_bit(cos, &tcs);
+	}
+
+	return tcs;
+}
+
+void bnx2x_dcbx_account_pause(struct bnx2x *bp, unsigned long tcs,
+			      ktime_t start)
+{
+	u32 usec = (u32)ktime_to_us(ktime_sub(ktime_get(), start));
+	u8 cos;
+
+	for (cos = 0; cos < DCBX_COS_MAX_NUM; cos++) {
+		struct bnx2x_dcbx_tc_pause *p = &bp->dcbx_tc_pause[cos];
+
+		if (!test_bit(cos, &tcs))
+			continue;
+
+		p->count++;
+		p->last_us = usec;
+		p->max_us = max(p->max_us, usec);
+		p->total_us += usec;
+
+		DP(BNX2X_MSG_DCB, "TC %d Tx was held for %u usec\n", cos, usec);
+	}
+}
+
+/* Hold or release the Tx of the given TCs on all ETH queues. Holding stops
+ * the netdev queues and waits for the rings to drain.
+ */
+static void bnx2x_dcbx_hold_tcs(struct bnx2x *bp, unsigned long tcs,
+				bool hold)
+{
+	int i;
+	u8 cos;
+
+	for (cos = 0; cos < DCBX_COS_MAX_NUM; cos++)
+		if (test_bit(cos, &tcs))
+			bnx2x_tx_hold_tc(bp, cos, BNX2X_TX_HOLD_DCBX, hold);
+
+	if (!hold)
+		return;
+
+	for_each_eth_queue(bp, i)
+		for_each_cos_in_tx_queue(&bp->fp[i], cos)
+			if (test_bit(cos, &tcs))
+				bnx2x_clean_tx_queue(bp,
+						     bp->fp[i].txdata_ptr[cos]);
+}
+
+/* Returns true if no Tx of traffic class @cos has completed since the last
+ * call while the ring still has work pending.
+ */
+static bool bnx2x_pfc_tc_stalled(struct bnx2x *bp, u8 cos)
+{
+	struct bnx2x_fp_txdata *txdata;
+	bool pending = false, moved = false;
+	u16 hw_cons;
+	int i;
+
+	for_each_eth_queue(bp, i) {
+		if (cos >= bp->fp[i].max_cos)
+			continue;
+
+		txdata = bp->fp[i].txdata_ptr[cos];
+		hw_cons = le16_to_cpu(*txdata->tx_cons_sb);
+
+		if (hw_cons != txdata->pfc_wd_cons)
+			moved = true;
+		if (hw_cons != txdata->tx_pkt_prod)
+			pending = true;
+
+		txdata->pfc_wd_cons = hw_cons;
+	}
+
+	return pending && !moved;
+}
+
+/* Keep the netdev watchdog from resetting the function while the watchdog
+ * holds the queues of a TC in a PFC storm.
+ */
+static void bnx2x_pfc_storm_touch(struct bnx2x *bp, u8 cos)
+{
+	struct netdev_queue *txq;
+	int i;
+
+	for_each_eth_queue(bp, i) {
+		if (cos >= bp->fp[i].max_cos)
+			continue;
+
+		txq = netdev_get_tx_queue(bp->dev,
+					  bp->fp[i].txdata_ptr[cos]->txq_index);
+		__netif_tx_lock_bh(txq);
+		txq->trans_start = jiffies;
+		__netif_tx_unlock_bh(txq);
+	}
+}
+
+/* Called from the periodic task. Tracks the PFC pause state of every TC
+ * and, once a TC has been paused for pfc_storm_timeout seconds, holds its
+ * Tx queues: new traffic for the class stays in the qdisc (and is dropped
+ * there once it overflows) instead of being posted behind the stuck class.
+ * Packets already on the ring are not flushed. The hold is released as soon
+ * as the TC makes progress again.
+ */
+void bnx2x_pfc_watchdog(struct bnx2x *bp)
+{
+	struct bnx2x_eth_stats *estats = &bp->eth_stats;
+	u64 pfc_rx = HILO_U64(estats->pfc_frames_received_hi,
+			      estats->pfc_frames_received_lo);
+	bool active, pfc_seen;
+	u32 ms;
+	u8 cos;
+
+	active = bp->dcb_state == BNX2X_DCB_STATE_ON &&
+		 bp->dcbx_port_params.pfc.enabled && bp->link_vars.link_up;
+	pfc_seen = pfc_rx != bp->pfc_wd_last_rx;
+	bp->pfc_wd_last_rx = pfc_rx;
+
+	for (cos = 0; cos < DCBX_COS_MAX_NUM; cos++) {
+		struct bnx2x_pfc_tc_stats *st = &bp->pfc_tc_stats[cos];
+		bool paused = active && cos < bp->max_cos &&
+			      bnx2x_pfc_tc_stalled(bp, cos) && pfc_seen;
+
+		if (paused && !st->paused_since) {
+			st->paused_since = jiffies ? : 1;
+			st->xoff_cnt++;
+		} else if (!paused && st->paused_since) {
+			ms = jiffies_to_msecs(jiffies - st->paused_since);
+			st->paused_since = 0;
+			st->xon_cnt++;
+			st->paused_ms_total += ms;
+			st->paused_ms_max = max(st->paused_ms_max, ms);
+
+			if (st->storm) {
+				st->storm = false;
+				bnx2x_tx_hold_tc(bp, cos, BNX2X_TX_HOLD_STORM,
+						 false);
+				netdev_info(bp->dev,
+					    "PFC storm on TC %d ended after %u ms\n",
+					    cos, ms);
+			}
+		}
+
+		if (paused && !st->storm && pfc_storm_timeout &&
+		    time_after_eq(jiffies, st->paused_since +
+					   pfc_storm_timeout * HZ)) {
+			st->storm = true;
+			st->storm_cnt++;
+			bnx2x_tx_hold_tc(bp, cos, BNX2X_TX_HOLD_STORM, true);
+			netdev_warn(bp->dev,
+				    "PFC storm on TC %d (priorities 0x%x), holding its Tx queues\n",
+				    cos, bp->dcbx_port_params.ets.cos_params[cos].pri_bitmask);
+		}
+
+		if (st->storm)
+			bnx2x_pfc_storm_touch(bp, cos);
+	}
+}
+
+/* Apply a DCBX update which keeps the priority to CoS mapping: only the TCs
+ * whose ETS/PFC parameters changed are held while the port is reprogrammed,
+ * the other TCs keep transmitting and the FW is not stopped.
+ */
+void bnx2x_dcbx_update_tcs(struct bnx2x *bp)
+{
+	unsigned long tcs = bp->dcbx_tc_changed;
+	ktime_t start = ktime_get();
+
+	DP(BNX2X_MSG_DCB, "scoped DCBX update, TCs 0x%lx\n", tcs);
+
+	if (tcs) {
+		bnx2x_dcbx_hold_tcs(bp, tcs, true);
+
+		bnx2x_pfc_set_pfc(bp);
+		bnx2x_dcbx_update_ets_params(bp);
+		bnx2x_set_local_cmng(bp);
+
+		bnx2x_dcbx_hold_tcs(bp, tcs, false);
+		bnx2x_dcbx_account_pause(bp, tcs, start);
+	}
+
+	bnx2x_dcbx_set_params(bp, BNX2X_DCBX_STATE_TX_RELEASED);
+}
+
 static void bnx2x_dcbx_2cos_limit_update_ets_config(struct bnx2x *bp)
 {
 	struct bnx2x_dcbx_pg_params *ets = &(bp->dcbx_port_params.ets);
@@ -757,6 +983,11 @@ void bnx2x_dcbx_set_params(struct bnx2x *bp, u32 state)
 	switch (state) {
 	case BNX2X_DCBX_STATE_NEG_RECEIVED:
 		{
+			struct bnx2x_dcbx_port_params old_params =
+				bp->dcbx_port_params;
+			u32 old_error = bp->dcbx_error;
+			bool remap = true;
+
 			DP(BNX2X_MSG_DCB, "BNX2X_DCBX_STATE_NEG_RECEIVED\n");
 #ifdef BCM_DCBNL
 			/**
@@ -779,6 +1010,10 @@ void bnx2x_dcbx_set_params(struct bnx2x *bp, u32 state)
 			bnx2x_get_dcbx_drv_param(bp, &bp->dcbx_local_feat,
 						 bp->dcbx_error);
 
+			bp->dcbx_tc_changed =
+				bnx2x_dcbx_changed_tcs(bp, &old_params,
+						       old_error, &remap);
+
 			/* mark DCBX result for PMF migration */
 			bnx2x_update_drv_flags(bp,
 					       1 << DRV_FLAGS_DCB_CONFIGURED,
@@ -798,6 +1033,17 @@ void bnx2x_dcbx_set_params(struct bnx2x *bp, u32 state)
 			if (IS_MF(bp))
 				bnx2x_link_sync_notify(bp);
 
+#ifdef BCM_MULTI_COS /* BNX2X_UPSTREAM */
+			/* Only a new priority to CoS mapping needs the FW to be
+			 * stopped; otherwise hold just the TCs which changed.
+			 */
+			if (!remap && bp->dcbx_fw_synced) {
+				bnx2x_schedule_sp_rtnl(bp,
+						       BNX2X_SP_RTNL_DCBX_TC_UPDATE,
+						       0);
+				return;
+			}
+#endif
 			bnx2x_schedule_sp_rtnl(bp, BNX2X_SP_RTNL_TX_STOP, 0);
 			return;
 		}
@@ -812,6 +1058,7 @@ void bnx2x_dcbx_set_params(struct bnx2x *bp, u32 state)
 		return;
 	case BNX2X_DCBX_STATE_TX_RELEASED:
 		DP(BNX2X_MSG_DCB, "BNX2X_DCBX_STATE_TX_RELEASED\n");
+		bp->dcbx_fw_synced = true;
 		bnx2x_fw_command(bp, DRV_MSG_CODE_DCBX_PMF_DRV_OK, 0);
 #ifdef BCM_DCBNL
 		/*
@@ -1065,6 +1312,9 @@ void bnx2x_dcbx_init(struct bnx2x *bp, bool update_shmem)
 {
 	u32 dcbx_lldp_params_offset = SHMEM_LLDP_DCBX_PARAMS_NONE;
 
+	/* The next negotiation result has to go through TX_START */
+	bp->dcbx_fw_synced = false;
+
 	/* only PMF can send ADMIN msg to MFW in old MFW versions */
 	if ((!bp->port.pmf) && (!(bp->flags & BC_SUPPORTS_DCBX_MSG_NON_PMF)))
 		return;
@@ -69,6 +69,28 @@ struct bnx2x_dcbx_port_params {
 	struct bnx2x_dcbx_app_params app;
 };
 
+/* PFC pause tracking of a lossless TC. The MACs only count PFC frames per
+ * port, so a TC is considered paused (XOFF) while it has Tx work pending,
+ * its HW consumer does not move and PFC frames keep being received.
+ */
+struct bnx2x_pfc_tc_stats {
+	u64 xoff_cnt;
+	u64 xon_cnt;
+	u64 paused_ms_total;
+	u32 paused_ms_max;
+	u32 storm_cnt;
+	unsigned long paused_since;	/* jiffies; 0 if not paused */
+	bool storm;			/* Tx queues stopped by the watchdog */
+};
+
+/* Time a TC spent with its Tx held because of DCBX updates */
+struct bnx2x_dcbx_tc_pause {
+	u32 count;
+	u32 last_us;
+	u32 max_us;
+	u64 total_us;
+};
+
 #define BNX2X_DCBX_CONFIG_INV_VALUE			(0xFFFFFFFF)
 #define BNX2X_DCBX_OVERWRITE_SETTINGS_DISABLE		0
 #define BNX2X_DCBX_OVERWRITE_SETTINGS_ENABLE		1
@@ -287,5 +309,9 @@ int bnx2x_dcbnl_update_applist(struct bnx2x *bp, bool delall);
 
 int bnx2x_dcbx_stop_hw_tx(struct bnx2x *bp);
 int bnx2x_dcbx_resume_hw_tx(struct bnx2x *bp);
+void bnx2x_dcbx_update_tcs(struct bnx2x *bp);
+void bnx2x_pfc_watchdog(struct bnx2x *bp);
+void bnx2x_dcbx_account_pause(struct bnx2x *bp, unsigned long tcs,
+			      ktime_t start);
 
 #endif /* BNX2X_DCB_H */
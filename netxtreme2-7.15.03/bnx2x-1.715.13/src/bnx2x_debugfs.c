@@ -11,11 +11,15 @@
 #include <linux/binfmts.h>
 #include <linux/vmalloc.h>
 #include "bnx2x.h"
+#include "bnx2x_cmn.h"
 
 static struct dentry *bnx2x_dbg_root;
 
 int bnx2x_str_reg_read_test(struct bnx2x *p_dev, char *params_string);
 int bnx2x_str_reg_write_test(struct bnx2x *p_dev, char *params_string);
+#ifdef BCM_PTP /* BNX2X_UPSTREAM */
+int bnx2x_str_phc_bench_test(struct bnx2x *p_dev, char *params_string);
+#endif
 static ssize_t bnx2x_dbg_tests_cmd_read(struct file *filp, char __user *buffer,
 				size_t count, loff_t *ppos);
 
@@ -31,7 +35,40 @@ static ssize_t bnx2x_dbg_internal_trace_cmd_write(struct file *filp,
 				 const char __user *buffer,
 				 size_t count, loff_t *ppos);
 
-#define BNX2X_TESTS_NUM_STR_FUNCS 2
+static ssize_t bnx2x_dbg_dcbx_tc_pause_read(struct file *filp,
+					    char __user *buffer,
+					    size_t count, loff_t *ppos);
+
+static ssize_t bnx2x_dbg_pfc_stats_read(struct file *filp,
+					char __user *buffer,
+					size_t count, loff_t *ppos);
+
+static ssize_t bnx2x_dbg_selftest_times_read(struct file *filp,
+					     char __user *buffer,
+					     size_t count, loff_t *ppos);
+
+static ssize_t bnx2x_dbg_parity_recovery_read(struct file *filp,
+					      char __user *buffer,
+					      size_t count, loff_t *ppos);
+
+static ssize_t bnx2x_dbg_sfp_dom_read(struct file *filp,
+				      char __user *buffer,
+				      size_t count, loff_t *ppos);
+
+static ssize_t bnx2x_dbg_link_prof_read(struct file *filp,
+					char __user *buffer,
+					size_t count, loff_t *ppos);
+
+static ssize_t bnx2x_dbg_nvram_write_read(struct file *filp,
+					  char __user *buffer,
+					  size_t count, loff_t *ppos);
+static ssize_t bnx2x_dbg_tx_hang_read(struct file *filp,
+				      char __user *buffer,
+				      size_t count, loff_t *ppos);
+static ssize_t bnx2x_dbg_tx_done_read(struct file *filp,
+				      char __user *buffer,
+				      size_t count, loff_t *ppos);
+
 struct bnx2x_func_lookup {
 	const char *key;
 	int (*str_func)(struct bnx2x *bp, char *params_string);
@@ -40,9 +77,18 @@ struct bnx2x_func_lookup {
 static struct bnx2x_func_lookup bnx2x_tests_func[] = {
         {"reg_read", bnx2x_str_reg_read_test},
         {"reg_write", bnx2x_str_reg_write_test},
+#ifdef BCM_PTP /* BNX2X_UPSTREAM */
+        {"phc_bench", bnx2x_str_phc_bench_test},
+#endif
 };
 
-static const char *tests_list = "reg_read\n" "reg_write\n";
+#define BNX2X_TESTS_NUM_STR_FUNCS ARRAY_SIZE(bnx2x_tests_func)
+
+static const char *tests_list = "reg_read\n" "reg_write\n"
+#ifdef BCM_PTP /* BNX2X_UPSTREAM */
+				"phc_bench\n"
+#endif
+				;
 
 static struct file_operations bnx2x_debugfs_fileops = {
 	.owner = THIS_MODULE,
@@ -58,6 +104,60 @@ static struct file_operations bnx2x_dbg_internal_trace_fileops = {
 	.write = bnx2x_dbg_internal_trace_cmd_write,
 };
 
+static struct file_operations bnx2x_dbg_dcbx_tc_pause_fileops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.read = bnx2x_dbg_dcbx_tc_pause_read,
+};
+
+static struct file_operations bnx2x_dbg_pfc_stats_fileops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.read = bnx2x_dbg_pfc_stats_read,
+};
+
+static struct file_operations bnx2x_dbg_selftest_times_fileops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.read = bnx2x_dbg_selftest_times_read,
+};
+
+static struct file_operations bnx2x_dbg_parity_recovery_fileops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.read = bnx2x_dbg_parity_recovery_read,
+};
+
+static struct file_operations bnx2x_dbg_sfp_dom_fileops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.read = bnx2x_dbg_sfp_dom_read,
+};
+
+static struct file_operations bnx2x_dbg_link_prof_fileops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.read = bnx2x_dbg_link_prof_read,
+};
+
+static struct file_operations bnx2x_dbg_nvram_write_fileops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.read = bnx2x_dbg_nvram_write_read,
+};
+
+static struct file_operations bnx2x_dbg_tx_hang_fileops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.read = bnx2x_dbg_tx_hang_read,
+};
+
+static struct file_operations bnx2x_dbg_tx_done_fileops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.read = bnx2x_dbg_tx_done_read,
+};
+
 /**
  * bnx2x_init - start up debugfs for the driver
  **/
@@ -121,6 +221,55 @@ void bnx2x_dbg_pf_init(struct bnx2x *bp)
 	if (!file_dentry)
 		printk("debugfs internal_trace entry creation failed\n");
 
+	file_dentry = debugfs_create_file("dcbx_tc_pause", 0400,
+					  bp->bdf_dentry, bp,
+					  &bnx2x_dbg_dcbx_tc_pause_fileops);
+	if (!file_dentry)
+		printk("debugfs dcbx_tc_pause entry creation failed\n");
+
+	file_dentry = debugfs_create_file("pfc_stats", 0400, bp->bdf_dentry,
+					  bp, &bnx2x_dbg_pfc_stats_fileops);
+	if (!file_dentry)
+		printk("debugfs pfc_stats entry creation failed\n");
+
+	file_dentry = debugfs_create_file("selftest_times", 0400,
+					  bp->bdf_dentry, bp,
+					  &bnx2x_dbg_selftest_times_fileops);
+	if (!file_dentry)
+		printk("debugfs selftest_times entry creation failed\n");
+
+	file_dentry = debugfs_create_file("parity_recovery", 0400,
+					  bp->bdf_dentry, bp,
+					  &bnx2x_dbg_parity_recovery_fileops);
+	if (!file_dentry)
+		printk("debugfs parity_recovery entry creation failed\n");
+
+	file_dentry = debugfs_create_file("sfp_dom", 0400, bp->bdf_dentry,
+					  bp, &bnx2x_dbg_sfp_dom_fileops);
+	if (!file_dentry)
+		printk("debugfs sfp_dom entry creation failed\n");
+
+	file_dentry = debugfs_create_file("link_prof", 0400, bp->bdf_dentry,
+					  bp, &bnx2x_dbg_link_prof_fileops);
+	if (!file_dentry)
+		printk("debugfs link_prof entry creation failed\n");
+
+	file_dentry = debugfs_create_file("nvram_write", 0400,
+					  bp->bdf_dentry, bp,
+					  &bnx2x_dbg_nvram_write_fileops);
+	if (!file_dentry)
+		printk("debugfs nvram_write entry creation failed\n");
+
+	file_dentry = debugfs_create_file("tx_hang", 0400, bp->bdf_dentry,
+					  bp, &bnx2x_dbg_tx_hang_fileops);
+	if (!file_dentry)
+		printk("debugfs tx_hang entry creation failed\n");
+
+	file_dentry = debugfs_create_file("tx_done", 0400, bp->bdf_dentry,
+					  bp, &bnx2x_dbg_tx_done_fileops);
+	if (!file_dentry)
+		printk("debugfs tx_done entry creation failed\n");
+
 	return;
 }
 
@@ -184,6 +333,24 @@ int bnx2x_str_reg_write_test(struct bnx2x *bp, char *params_string)
 	return REG_RD(bp, addr);
 }
 
+#ifdef BCM_PTP /* BNX2X_UPSTREAM */
+/* phc_bench <iterations>: PHC gettime cost and extrapolation jitter */
+int bnx2x_str_phc_bench_test(struct bnx2x *bp, char *params_string)
+{
+	u32 iters;
+	char canary[4];
+	int expected_args = 1, args;
+
+	args = sscanf(params_string, "%i %3s ", &iters, canary);
+	if (expected_args != args) {
+		printk("Error: Expected %d arguments\n", expected_args);
+		return -EINVAL;
+	}
+
+	return bnx2x_ptp_bench(bp, min_t(u32, iters, 1000000));
+}
+#endif
+
 /* function services tests and phy read command */
 static ssize_t bnx2x_dbg_external_cmd_read(struct file *filp,
 					   char __user * buffer, size_t count,
@@ -318,6 +485,368 @@ static ssize_t bnx2x_dbg_internal_trace_cmd_read(struct file *filp,
 					   count, ppos, data, len);
 }
 
+/* Per-TC Tx hold time caused by DCBX updates */
+static ssize_t bnx2x_dbg_dcbx_tc_pause_read(struct file *filp,
+					    char __user *buffer,
+					    size_t count, loff_t *ppos)
+{
+	struct bnx2x *bp = (struct bnx2x *)filp->private_data;
+	char data[64 * (DCBX_COS_MAX_NUM + 1)];
+	int cos, len;
+
+	len = scnprintf(data, sizeof(data), "tc count last_us max_us total_us\n");
+	for (cos = 0; cos < DCBX_COS_MAX_NUM; cos++) {
+		struct bnx2x_dcbx_tc_pause *p = &bp->dcbx_tc_pause[cos];
+
+		len += scnprintf(data + len, sizeof(data) - len,
+				 "%d %u %u %u %llu\n", cos, p->count,
+				 p->last_us, p->max_us, p->total_us);
+	}
+
+	if (*ppos >= len)
+		return 0;
+
+	return bnx2x_dbg_external_cmd_read(filp, buffer, count, ppos, data,
+					   len);
+}
+
+/* Per-TC PFC pause state as tracked by the PFC storm watchdog */
+static ssize_t bnx2x_dbg_pfc_stats_read(struct file *filp,
+					char __user *buffer,
+					size_t count, loff_t *ppos)
+{
+	struct bnx2x *bp = (struct bnx2x *)filp->private_data;
+	char data[128 * (DCBX_COS_MAX_NUM + 1)];
+	int cos, len;
+
+	len = scnprintf(data, sizeof(data),
+			"tc priorities xoff xon paused_ms paused_ms_max paused_now_ms storms storm\n");
+	for (cos = 0; cos < DCBX_COS_MAX_NUM; cos++) {
+		struct bnx2x_pfc_tc_stats *st = &bp->pfc_tc_stats[cos];
+		unsigned long since = st->paused_since;
+
+		len += scnprintf(data + len, sizeof(data) - len,
+				 "%d 0x%02x %llu %llu %llu %u %u %u %d\n", cos,
+				 bp->dcbx_port_params.ets.cos_params[cos].pri_bitmask,
+				 st->xoff_cnt, st->xon_cnt, st->paused_ms_total,
+				 st->paused_ms_max,
+				 since ? jiffies_to_msecs(jiffies - since) : 0,
+				 st->storm_cnt, st->storm);
+	}
+
+	if (*ppos >= len)
+		return 0;
+
+	return bnx2x_dbg_external_cmd_read(filp, buffer, count, ppos, data,
+					   len);
+}
+
+/* Duration of each ethtool self-test phase */
+static ssize_t bnx2x_dbg_selftest_times_read(struct file *filp,
+					     char __user *buffer,
+					     size_t count, loff_t *ppos)
+{
+	static const char * const names[BNX2X_ST_MAX] = {
+		[BNX2X_ST_NVRAM]	= "nvram",
+		[BNX2X_ST_DIAG_LOAD]	= "diag_load",
+		[BNX2X_ST_REGISTERS]	= "registers",
+		[BNX2X_ST_MEMORY]	= "memory",
+		[BNX2X_ST_INT_LB]	= "int_loopback",
+		[BNX2X_ST_EXT_LB]	= "ext_loopback",
+		[BNX2X_ST_RELOAD]	= "reload",
+		[BNX2X_ST_INTR]		= "interrupt",
+		[BNX2X_ST_LINK]		= "link",
+		[BNX2X_ST_IDLE_CHK]	= "idle_chk",
+	};
+	struct bnx2x *bp = (struct bnx2x *)filp->private_data;
+	char data[64 * (BNX2X_ST_MAX + 1)];
+	int i, len;
+
+	len = scnprintf(data, sizeof(data), "phase runs last_us max_us rc\n");
+	for (i = 0; i < BNX2X_ST_MAX; i++) {
+		struct bnx2x_st_phase_stat *st = &bp->st_phase[i];
+
+		len += scnprintf(data + len, sizeof(data) - len,
+				 "%s %u %u %u %d\n", names[i], st->runs,
+				 st->last_us, st->max_us, st->rc);
+	}
+
+	if (*ppos >= len)
+		return 0;
+
+	return bnx2x_dbg_external_cmd_read(filp, buffer, count, ppos, data,
+					   len);
+}
+
+/* Parity recovery history, oldest event first */
+static ssize_t bnx2x_dbg_parity_recovery_read(struct file *filp,
+					      char __user *buffer,
+					      size_t count, loff_t *ppos)
+{
+	static const char * const outcomes[] = {
+		[BNX2X_PAR_REC_OK]		= "ok",
+		[BNX2X_PAR_REC_ESCALATED]	= "escalated",
+		[BNX2X_PAR_REC_FAILED]		= "failed",
+	};
+	struct bnx2x *bp = (struct bnx2x *)filp->private_data;
+	u32 cnt = bp->par_rec_cnt, i;
+	size_t size = 128 * (BNX2X_PAR_REC_HIST + 1);
+	ssize_t rc;
+	char *data;
+	int len;
+
+	data = kmalloc(size, GFP_KERNEL);
+	if (!data)
+		return -ENOMEM;
+
+	len = scnprintf(data, size,
+			"events %u in progress %d\n"
+			"age_ms mode outcome usec sig0 sig1 sig2 sig3 sig4\n",
+			cnt, bp->par_rec_active);
+	for (i = cnt > BNX2X_PAR_REC_HIST ? cnt - BNX2X_PAR_REC_HIST : 0;
+	     i < cnt; i++) {
+		struct bnx2x_par_rec_event *ev =
+			&bp->par_rec_hist[i % BNX2X_PAR_REC_HIST];
+
+		len += scnprintf(data + len, size - len,
+				 "%u %s %s %u %08x %08x %08x %08x %08x\n",
+				 jiffies_to_msecs(jiffies - ev->jiffies),
+				 ev->scoped ? "scoped" :
+				 ev->global ? "global" : "full",
+				 outcomes[ev->outcome], ev->duration_us,
+				 ev->sig[0], ev->sig[1], ev->sig[2],
+				 ev->sig[3], ev->sig[4]);
+	}
+
+	if (*ppos >= len) {
+		kfree(data);
+		return 0;
+	}
+
+	rc = bnx2x_dbg_external_cmd_read(filp, buffer, count, ppos, data,
+					 len);
+	kfree(data);
+	return rc;
+}
+
+/* State of the cached SFP module EEPROM and its DOM values */
+static ssize_t bnx2x_dbg_sfp_dom_read(struct file *filp,
+				      char __user *buffer,
+				      size_t count, loff_t *ppos)
+{
+	struct bnx2x *bp = (struct bnx2x *)filp->private_data;
+	struct bnx2x_sfp_cache *sc = &bp->sfp_cache;
+	u8 a0_valid, a2_valid, dom[10];
+	unsigned long age;
+	char data[384];
+	int len;
+
+	spin_lock_bh(&sc->lock);
+	a0_valid = sc->a0_valid;
+	a2_valid = sc->a2_valid;
+	age = jiffies - sc->jiffies;
+	memcpy(dom, sc->a2 + SFP_EEPROM_A2_TEMPERATURE_ADDR, sizeof(dom));
+	spin_unlock_bh(&sc->lock);
+
+	len = scnprintf(data, sizeof(data),
+			"a0_valid %u\na2_valid %u\nage_ms %u\n"
+			"samples %u\nerrors %u\nhits %u\nmisses %u\n",
+			a0_valid, a2_valid,
+			(a0_valid || a2_valid) ? jiffies_to_msecs(age) : 0,
+			sc->samples, sc->errors, sc->hits, sc->misses);
+	if (a2_valid)
+		len += scnprintf(data + len, sizeof(data) - len,
+				 "temperature 0x%04x\nvcc 0x%04x\n"
+				 "tx_bias 0x%04x\ntx_power 0x%04x\n"
+				 "rx_power 0x%04x\n",
+				 (dom[0] << 8) | dom[1], (dom[2] << 8) | dom[3],
+				 (dom[4] << 8) | dom[5], (dom[6] << 8) | dom[7],
+				 (dom[8] << 8) | dom[9]);
+
+	if (*ppos >= len)
+		return 0;
+
+	return bnx2x_dbg_external_cmd_read(filp, buffer, count, ppos, data,
+					   len);
+}
+
+/* Phase offsets of the last link bring-up; "-" marks skipped phases */
+static ssize_t bnx2x_dbg_link_prof_read(struct file *filp,
+					char __user *buffer,
+					size_t count, loff_t *ppos)
+{
+	static const char * const phase_str[LINK_PROF_MAX] = {
+		"lfa_check", "link_reset", "mac_init", "phy_config",
+		"int_enable"
+	};
+	static const char * const path_str[] = { "full", "lfa", "fast" };
+	struct bnx2x *bp = (struct bnx2x *)filp->private_data;
+	struct link_prof prof;
+	char data[768];
+	int len, i;
+
+	bnx2x_acquire_phy_lock(bp);
+	prof = bp->link_params.prof;
+	bnx2x_release_phy_lock(bp);
+
+	len = scnprintf(data, sizeof(data),
+			"runs %u\nlfa_runs %u\nfast_runs %u\npath %s\n",
+			prof.runs, prof.lfa_runs, prof.fast_runs,
+			path_str[prof.path]);
+	for (i = 0; i < LINK_PROF_MAX; i++) {
+		if (prof.phase_us[i])
+			len += scnprintf(data + len, sizeof(data) - len,
+					 "%s_us %u\n", phase_str[i],
+					 prof.phase_us[i]);
+		else
+			len += scnprintf(data + len, sizeof(data) - len,
+					 "%s_us -\n", phase_str[i]);
+	}
+	if (prof.link_up_us)
+		len += scnprintf(data + len, sizeof(data) - len,
+				 "link_up_us %u\n", prof.link_up_us);
+	else
+		len += scnprintf(data + len, sizeof(data) - len,
+				 "link_up_us -\n");
+	len += scnprintf(data + len, sizeof(data) - len,
+			 "link_up_max_us %u\n", prof.link_up_max_us);
+	for (i = 0; i < MAX_PHYS; i++) {
+		if (!prof.phy_type[i] && !prof.phy_cfg_max_us[i])
+			continue;
+		len += scnprintf(data + len, sizeof(data) - len,
+				 "phy%d type 0x%08x config_us %u max_us %u\n",
+				 i, prof.phy_type[i], prof.phy_cfg_us[i],
+				 prof.phy_cfg_max_us[i]);
+	}
+
+	if (*ppos >= len)
+		return 0;
+
+	return bnx2x_dbg_external_cmd_read(filp, buffer, count, ppos, data,
+					   len);
+}
+
+/* Progress of the last (or current) NVRAM update session */
+static ssize_t bnx2x_dbg_nvram_write_read(struct file *filp,
+					  char __user *buffer,
+					  size_t count, loff_t *ppos)
+{
+	struct bnx2x *bp = (struct bnx2x *)filp->private_data;
+	struct bnx2x_nvram_wr_prog prog = bp->nvram_wr;
+	u32 elapsed_ms = 0, idle_ms = 0, kbps = 0;
+	char data[256];
+	int len;
+
+	if (prog.last) {
+		elapsed_ms = jiffies_to_msecs(prog.last - prog.start);
+		idle_ms = jiffies_to_msecs(jiffies - prog.last);
+		if (elapsed_ms)
+			kbps = prog.bytes / elapsed_ms;
+	}
+
+	len = scnprintf(data, sizeof(data),
+			"start_offset 0x%x\nnext_offset 0x%x\nbytes %u\n"
+			"pages %u\nyields %u\nerrors %u\nlast_rc %d\n"
+			"elapsed_ms %u\nidle_ms %u\nkbytes_per_sec %u\n",
+			prog.start_offset, prog.next_offset, prog.bytes,
+			prog.pages, prog.yields, prog.errors, prog.last_rc,
+			elapsed_ms, idle_ms, kbps);
+
+	if (*ppos >= len)
+		return 0;
+
+	return bnx2x_dbg_external_cmd_read(filp, buffer, count, ppos, data,
+					   len);
+}
+
+static ssize_t bnx2x_dbg_tx_hang_read(struct file *filp,
+				      char __user *buffer,
+				      size_t count, loff_t *ppos)
+{
+	struct bnx2x *bp = (struct bnx2x *)filp->private_data;
+	struct bnx2x_txq_reset_stats *st = &bp->txq_reset;
+	struct bnx2x_fp_txdata *txdata;
+	unsigned long since;
+	char data[512];
+	int i, len;
+	u8 cos;
+
+	len = scnprintf(data, sizeof(data),
+			"hangs %u\ntimeouts %u\nresets %u\nescalated %u\n"
+			"last_queue %d\nlast_us %u\nmax_us %u\n",
+			st->hangs, st->timeouts, st->resets, st->escalated,
+			st->resets ? st->last_queue : -1, st->last_us,
+			st->max_us);
+	if (st->last)
+		len += scnprintf(data + len, sizeof(data) - len,
+				 "last_reset_ago_ms %u\n",
+				 jiffies_to_msecs(jiffies - st->last));
+
+	/* Rings the watchdog currently sees without progress */
+	if (bp->state == BNX2X_STATE_OPEN)
+		for_each_eth_queue(bp, i)
+			for_each_cos_in_tx_queue(&bp->fp[i], cos) {
+				txdata = bp->fp[i].txdata_ptr[cos];
+				since = txdata->hang_since;
+				if (!since)
+					continue;
+				len += scnprintf(data + len, sizeof(data) - len,
+						 "stalled %d.%d %u ms\n", i, cos,
+						 jiffies_to_msecs(jiffies -
+								  since));
+			}
+
+	if (*ppos >= len)
+		return 0;
+
+	return bnx2x_dbg_external_cmd_read(filp, buffer, count, ppos, data,
+					   len);
+}
+
+static ssize_t bnx2x_dbg_tx_done_read(struct file *filp,
+				      char __user *buffer,
+				      size_t count, loff_t *ppos)
+{
+	struct bnx2x *bp = (struct bnx2x *)filp->private_data;
+	u64 hist[BNX2X_TX_DONE_HIST] = {0}, calls = 0, deferred = 0;
+	struct bnx2x_fp_txdata *txdata;
+	char data[512];
+	int i, b, len;
+	u8 cos;
+
+	/* Summed over the Tx rings of all ETH queues */
+	if (bp->state == BNX2X_STATE_OPEN)
+		for_each_eth_queue(bp, i)
+			for_each_cos_in_tx_queue(&bp->fp[i], cos) {
+				txdata = bp->fp[i].txdata_ptr[cos];
+				for (b = 0; b < BNX2X_TX_DONE_HIST; b++) {
+					hist[b] += txdata->tx_done_hist[b];
+					calls += txdata->tx_done_hist[b];
+				}
+				deferred += txdata->tx_done_deferred;
+			}
+
+	len = scnprintf(data, sizeof(data),
+			"batch_threshold %u\nring_pct %u\nbatches %llu\n"
+			"deferred_polls %llu\n", tx_done_batch,
+			tx_done_ring_pct, calls, deferred);
+
+	for (b = 0; b < BNX2X_TX_DONE_HIST; b++)
+		if (b == BNX2X_TX_DONE_HIST - 1)
+			len += scnprintf(data + len, sizeof(data) - len,
+					 "pkts_%u+ %llu\n", 1 << b, hist[b]);
+		else
+			len += scnprintf(data + len, sizeof(data) - len,
+					 "pkts_%u-%u %llu\n", 1 << b,
+					 (2 << b) - 1, hist[b]);
+
+	if (*ppos >= len)
+		return 0;
+
+	return bnx2x_dbg_external_cmd_read(filp, buffer, count, ppos, data,
+					   len);
+}
+
 static int bnx2x_dbg_internal_trace_dump(struct bnx2x *bp)
 {
 	u32 buf_size;
@@ -81,7 +81,11 @@ static const struct {
 					8, "[%s]: tpa_aggregated_frames"},
 	{ Q_STATS_OFFSET32(total_tpa_bytes_hi),	8, "[%s]: tpa_bytes"},
 	{ Q_STATS_OFFSET32(driver_filtered_tx_pkt),
-					4, "[%s]: driver_filtered_tx_pkt" }
+					4, "[%s]: driver_filtered_tx_pkt" },
+	{ Q_STATS_OFFSET32(tx_bounce_pkts), 4, "[%s]: tx_bounce_packets" },
+	{ Q_STATS_OFFSET32(tx_bounce_bytes_hi), 8, "[%s]: tx_bounce_bytes" },
+	{ Q_STATS_OFFSET32(tx_lin_pkts), 4, "[%s]: tx_linearized_packets" },
+	{ Q_STATS_OFFSET32(tx_lin_bytes_hi), 8, "[%s]: tx_linearized_bytes" }
 };
 
 #define BNX2X_NUM_Q_STATS ARRAY_SIZE(bnx2x_q_stats_arr)
@@ -199,7 +203,15 @@ static const struct {
 	{ STATS_OFFSET32(eee_tx_lpi),
 			4, true, "Tx LPI entry count"},
 	{ STATS_OFFSET32(ptp_skip_txts),
-			4, false, "Tx timestamps skipped"}
+			4, false, "Tx timestamps skipped"},
+	{ STATS_OFFSET32(tx_bounce_pkts),
+			4, false, "tx_bounce_packets" },
+	{ STATS_OFFSET32(tx_bounce_bytes_hi),
+			8, false, "tx_bounce_bytes" },
+	{ STATS_OFFSET32(tx_lin_pkts),
+			4, false, "tx_linearized_packets" },
+	{ STATS_OFFSET32(tx_lin_bytes_hi),
+			8, false, "tx_linearized_bytes" }
 };
 
 #define BNX2X_NUM_STATS		ARRAY_SIZE(bnx2x_stats_arr)
@@ -695,9 +707,7 @@ static int bnx2x_set_link_ksettings(struct net_device *dev,
 	/* Set new config */
 	bp->link_params.multi_phy_config = new_multi_phy_config;
 	if (netif_running(dev)) {
-		bnx2x_stats_handle(bp, STATS_EVENT_STOP, true);
-		bnx2x_force_link_reset(bp);
-		bnx2x_link_set(bp);
+		bnx2x_link_reconfig(bp);
 	}
 
 	return 0;
@@ -1186,9 +1196,7 @@ static int bnx2x_set_settings(struct net_device *dev, struct ethtool_cmd *cmd)
 	/* Set new config */
 	bp->link_params.multi_phy_config = new_multi_phy_config;
 	if (netif_running(dev)) {
-		bnx2x_stats_handle(bp, STATS_EVENT_STOP, true);
-		bnx2x_force_link_reset(bp);
-		bnx2x_link_set(bp);
+		bnx2x_link_reconfig(bp);
 	}
 
 	return 0;
@@ -2006,11 +2014,12 @@ static int bnx2x_nvram_read_dword(struct bnx2x *bp, u32 offset, __be32 *ret_val,
 	if (CHIP_REV_IS_SLOW(bp))
 		count *= 100;
 
-	/* wait for completion */
+	/* wait for completion; dwords within a read sequence are usually
+	 * ready by the time the first poll reaches the chip
+	 */
 	*ret_val = 0;
 	rc = -EBUSY;
 	for (i = 0; i < count; i++) {
-		udelay(5);
 		val = REG_RD(bp, MCP_REG_MCPR_NVM_COMMAND);
 
 		if (val & MCPR_NVM_COMMAND_DONE) {
@@ -2023,6 +2032,7 @@ static int bnx2x_nvram_read_dword(struct bnx2x *bp, u32 offset, __be32 *ret_val,
 			rc = 0;
 			break;
 		}
+		udelay(5);
 	}
 	if (rc == -EBUSY)
 		DP(BNX2X_MSG_ETHTOOL | BNX2X_MSG_NVM,
@@ -2033,6 +2043,7 @@ static int bnx2x_nvram_read_dword(struct bnx2x *bp, u32 offset, __be32 *ret_val,
 int bnx2x_nvram_read(struct bnx2x *bp, u32 offset, u8 *ret_buf,
 		     int buf_size)
 {
+	unsigned long slice_end;
 	int rc;
 	u32 cmd_flags;
 	__be32 val;
@@ -2060,8 +2071,16 @@ int bnx2x_nvram_read(struct bnx2x *bp, u32 offset, u8 *ret_buf,
 	bnx2x_enable_nvram_access(bp);
 
 	/* read the first word(s) */
+	slice_end = jiffies + msecs_to_jiffies(BNX2X_NVRAM_SLICE_MS);
 	cmd_flags = MCPR_NVM_COMMAND_FIRST;
 	while ((buf_size > sizeof(u32)) && (rc == 0)) {
+		/* Close the read sequence before handing the interface back
+		 * to the MFW once the time slice is used up.
+		 */
+		if ((buf_size > 2 * sizeof(u32)) &&
+		    time_after_eq(jiffies, slice_end))
+			cmd_flags |= MCPR_NVM_COMMAND_LAST;
+
 		rc = bnx2x_nvram_read_dword(bp, offset, &val, cmd_flags);
 		memcpy(ret_buf, &val, 4);
 
@@ -2069,7 +2088,19 @@ int bnx2x_nvram_read(struct bnx2x *bp, u32 offset, u8 *ret_buf,
 		offset += sizeof(u32);
 		ret_buf += sizeof(u32);
 		buf_size -= sizeof(u32);
-		cmd_flags = 0;
+
+		if ((cmd_flags & MCPR_NVM_COMMAND_LAST) && (rc == 0)) {
+			bnx2x_release_nvram_lock(bp);
+			usleep_range(1000, 2000);
+			rc = bnx2x_acquire_nvram_lock(bp);
+			if (rc)
+				return rc;
+			slice_end = jiffies +
+				    msecs_to_jiffies(BNX2X_NVRAM_SLICE_MS);
+			cmd_flags = MCPR_NVM_COMMAND_FIRST;
+		} else {
+			cmd_flags = 0;
+		}
 	}
 
 	if (rc == 0) {
@@ -2102,14 +2133,12 @@ static int bnx2x_nvram_read32(struct bnx2x *bp, u32 offset, u32 *buf,
 	return rc;
 }
 
-#define BNX2X_EEPROM_CHUNK_SIZE 128
 #define BNX2X_REGADDR_MAGIC 0xcafecafe
 
 static int bnx2x_get_eeprom(struct net_device *dev,
 			    struct ethtool_eeprom *eeprom, u8 *eebuf)
 {
 	struct bnx2x *bp = netdev_priv(dev);
-	int rc, offset, len, remaining;
 
 	if (!bnx2x_is_nvm_accessible(bp)) {
 		DP(BNX2X_MSG_ETHTOOL  | BNX2X_MSG_NVM,
@@ -2142,23 +2171,34 @@ static int bnx2x_get_eeprom(struct net_device *dev,
 	} while (0);
 #endif
 
-	/* parameters already validated in ethtool_get_eeprom */
-	offset = 0;
-	remaining = eeprom->len;
-	while (remaining) {
-		len = remaining < BNX2X_EEPROM_CHUNK_SIZE ? remaining :
-					BNX2X_EEPROM_CHUNK_SIZE;
-		rc = bnx2x_nvram_read(bp, eeprom->offset + offset,
-				      eebuf + offset, len);
-		if (rc)
-			return rc;
+	/* parameters already validated in ethtool_get_eeprom; the whole range
+	 * is read as one sequence, bnx2x_nvram_read() yields the interface to
+	 * the MFW as needed
+	 */
+	return bnx2x_nvram_read(bp, eeprom->offset, eebuf, eeprom->len);
+}
 
-		offset += len;
-		remaining -= len;
-	}
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(3, 5, 0)) || (defined(_HAS_ETHTOOL_EXT_GET_MODULE_EEPROM)) || (defined(_HAS_ETHTOOL_EXT_GET_MODULE_INFO)) /* BNX2X_UPSTREAM */
+/* Serve module EEPROM reads from the sfp_dom_interval cache when possible;
+ * only a miss goes to the module under the PHY lock.
+ */
+static int bnx2x_get_module_bytes(struct bnx2x *bp, int phy_idx, u8 dev_addr,
+				  u16 addr, u16 len, u8 *data)
+{
+	int rc;
 
-	return 0;
+	if (bnx2x_sfp_cache_read(bp, dev_addr, addr, len, data))
+		return 0;
+
+	bnx2x_acquire_phy_lock(bp);
+	rc = bnx2x_read_sfp_module_eeprom(&bp->link_params.phy[phy_idx],
+					  &bp->link_params, dev_addr, addr,
+					  len, data);
+	bnx2x_release_phy_lock(bp);
+
+	return rc;
 }
+#endif
 
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(3, 5, 0)) || (defined(_HAS_ETHTOOL_EXT_GET_MODULE_EEPROM)) /* BNX2X_UPSTREAM */
 static int bnx2x_get_module_eeprom(struct net_device *dev,
@@ -2185,14 +2225,8 @@ static int bnx2x_get_module_eeprom(struct net_device *dev,
 			xfer_size = ETH_MODULE_SFF_8079_LEN - start_addr;
 		else
 			xfer_size = ee->len;
-		bnx2x_acquire_phy_lock(bp);
-		rc = bnx2x_read_sfp_module_eeprom(&bp->link_params.phy[phy_idx],
-						  &bp->link_params,
-						  I2C_DEV_ADDR_A0,
-						  start_addr,
-						  xfer_size,
-						  user_data);
-		bnx2x_release_phy_lock(bp);
+		rc = bnx2x_get_module_bytes(bp, phy_idx, I2C_DEV_ADDR_A0,
+					    start_addr, xfer_size, user_data);
 		if (rc) {
 			DP(BNX2X_MSG_ETHTOOL, "Failed reading A0 section\n");
 
@@ -2210,14 +2244,8 @@ static int bnx2x_get_module_eeprom(struct net_device *dev,
 		if (start_addr + xfer_size > ETH_MODULE_SFF_8472_LEN)
 			xfer_size = ETH_MODULE_SFF_8472_LEN - start_addr;
 		start_addr -= ETH_MODULE_SFF_8079_LEN;
-		bnx2x_acquire_phy_lock(bp);
-		rc = bnx2x_read_sfp_module_eeprom(&bp->link_params.phy[phy_idx],
-						  &bp->link_params,
-						  I2C_DEV_ADDR_A2,
-						  start_addr,
-						  xfer_size,
-						  user_data);
-		bnx2x_release_phy_lock(bp);
+		rc = bnx2x_get_module_bytes(bp, phy_idx, I2C_DEV_ADDR_A2,
+					    start_addr, xfer_size, user_data);
 		if (rc) {
 			DP(BNX2X_MSG_ETHTOOL, "Failed reading A2 section\n");
 			return -EINVAL;
@@ -2241,27 +2269,19 @@ static int bnx2x_get_module_info(struct net_device *dev,
 		return -EAGAIN;
 	}
 	phy_idx = bnx2x_get_cur_phy_idx(bp);
-	bnx2x_acquire_phy_lock(bp);
-	rc = bnx2x_read_sfp_module_eeprom(&bp->link_params.phy[phy_idx],
-					  &bp->link_params,
-					  I2C_DEV_ADDR_A0,
-					  SFP_EEPROM_SFF_8472_COMP_ADDR,
-					  SFP_EEPROM_SFF_8472_COMP_SIZE,
-					  &sff8472_comp);
-	bnx2x_release_phy_lock(bp);
+	rc = bnx2x_get_module_bytes(bp, phy_idx, I2C_DEV_ADDR_A0,
+				    SFP_EEPROM_SFF_8472_COMP_ADDR,
+				    SFP_EEPROM_SFF_8472_COMP_SIZE,
+				    &sff8472_comp);
 	if (rc) {
 		DP(BNX2X_MSG_ETHTOOL, "Failed reading SFF-8472 comp field\n");
 		return -EINVAL;
 	}
 
-	bnx2x_acquire_phy_lock(bp);
-	rc = bnx2x_read_sfp_module_eeprom(&bp->link_params.phy[phy_idx],
-					  &bp->link_params,
-					  I2C_DEV_ADDR_A0,
-					  SFP_EEPROM_DIAG_TYPE_ADDR,
-					  SFP_EEPROM_DIAG_TYPE_SIZE,
-					  &diag_type);
-	bnx2x_release_phy_lock(bp);
+	rc = bnx2x_get_module_bytes(bp, phy_idx, I2C_DEV_ADDR_A0,
+				    SFP_EEPROM_DIAG_TYPE_ADDR,
+				    SFP_EEPROM_DIAG_TYPE_SIZE,
+				    &diag_type);
 	if (rc) {
 		DP(BNX2X_MSG_ETHTOOL, "Failed reading Diag Type field\n");
 		return -EINVAL;
@@ -2372,13 +2392,79 @@ static int bnx2x_nvram_write1(struct bnx2x *bp, u32 offset, u8 *data_buf,
 	return rc;
 }
 
+/* Program the dwords of a single NVRAM page; the range must not cross a
+ * page boundary.
+ */
+static int bnx2x_nvram_write_page(struct bnx2x *bp, u32 offset, u8 *data_buf,
+				  int len)
+{
+	u32 cmd_flags = MCPR_NVM_COMMAND_FIRST;
+	int rc = 0;
+	u32 val;
+
+	while (len && (rc == 0)) {
+		if (len == sizeof(u32))
+			cmd_flags |= MCPR_NVM_COMMAND_LAST;
+
+		memcpy(&val, data_buf, 4);
+
+		/* Notice unlike bnx2x_nvram_read_dword() this will will not
+		 * change val using be32_to_cpu(), which causes data to flip
+		 * if the eeprom is read and then written back. This is due
+		 * to tools utilizing this functionality that would break
+		 * if this would be resolved.
+		 */
+		rc = bnx2x_nvram_write_dword(bp, offset, val, cmd_flags);
+
+		/* advance to the next dword */
+		offset += sizeof(u32);
+		data_buf += sizeof(u32);
+		len -= sizeof(u32);
+		cmd_flags = 0;
+	}
+
+	return rc;
+}
+
+static void bnx2x_nvram_wr_begin(struct bnx2x *bp, u32 offset)
+{
+	struct bnx2x_nvram_wr_prog *prog = &bp->nvram_wr;
+
+	if (prog->last && offset == prog->next_offset &&
+	    time_before(jiffies, prog->last + BNX2X_NVRAM_WR_SESSION_GAP))
+		return;
+
+	prog->start_offset = offset;
+	prog->bytes = 0;
+	prog->pages = 0;
+	prog->yields = 0;
+	prog->errors = 0;
+	prog->last_rc = 0;
+	prog->start = jiffies;
+}
+
+static void bnx2x_nvram_wr_end(struct bnx2x *bp, u32 offset, int rc)
+{
+	struct bnx2x_nvram_wr_prog *prog = &bp->nvram_wr;
+
+	prog->next_offset = offset;
+	prog->last = jiffies;
+	prog->last_rc = rc;
+	if (rc)
+		prog->errors++;
+
+	DP(BNX2X_MSG_ETHTOOL | BNX2X_MSG_NVM,
+	   "NVRAM update from 0x%x: %u bytes, %u pages, %u yields in %u ms, rc %d\n",
+	   prog->start_offset, prog->bytes, prog->pages, prog->yields,
+	   jiffies_to_msecs(prog->last - prog->start), rc);
+}
+
 static int bnx2x_nvram_write(struct bnx2x *bp, u32 offset, u8 *data_buf,
 			     int buf_size)
 {
-	int rc;
-	u32 cmd_flags;
-	u32 val;
-	u32 written_so_far;
+	struct bnx2x_nvram_wr_prog *prog = &bp->nvram_wr;
+	unsigned long slice_end;
+	int rc, written_so_far, len;
 
 	if (buf_size == 1)	/* ethtool */
 		return bnx2x_nvram_write1(bp, offset, data_buf, buf_size);
@@ -2397,61 +2483,59 @@ static int bnx2x_nvram_write(struct bnx2x *bp, u32 offset, u8 *data_buf,
 		return -EINVAL;
 	}
 
+	bnx2x_nvram_wr_begin(bp, offset);
+
 	/* request access to nvram interface */
 	rc = bnx2x_acquire_nvram_lock(bp);
 	if (rc)
-		return rc;
+		goto out;
 
 	/* enable access to nvram interface */
 	bnx2x_enable_nvram_access(bp);
 
+	slice_end = jiffies + msecs_to_jiffies(BNX2X_NVRAM_SLICE_MS);
 	written_so_far = 0;
-	cmd_flags = MCPR_NVM_COMMAND_FIRST;
 	while ((written_so_far < buf_size) && (rc == 0)) {
-		if (written_so_far == (buf_size - sizeof(u32)))
-			cmd_flags |= MCPR_NVM_COMMAND_LAST;
-		else if (((offset + 4) % BNX2X_NVRAM_PAGE_SIZE) == 0)
-			cmd_flags |= MCPR_NVM_COMMAND_LAST;
-		else if ((offset % BNX2X_NVRAM_PAGE_SIZE) == 0)
-			cmd_flags |= MCPR_NVM_COMMAND_FIRST;
-
-		memcpy(&val, data_buf, 4);
-
-		/* Notice unlike bnx2x_nvram_read_dword() this will will not
-		 * change val using be32_to_cpu(), which causes data to flip
-		 * if the eeprom is read and then written back. This is due
-		 * to tools utilizing this functionality that would break
-		 * if this would be resolved.
-		 */
-		rc = bnx2x_nvram_write_dword(bp, offset, val, cmd_flags);
+		len = min_t(int, buf_size - written_so_far,
+			    BNX2X_NVRAM_PAGE_SIZE -
+			    (offset % BNX2X_NVRAM_PAGE_SIZE));
 
-		/* advance to the next dword */
-		offset += sizeof(u32);
-		data_buf += sizeof(u32);
-		written_so_far += sizeof(u32);
+		rc = bnx2x_nvram_write_page(bp, offset, data_buf, len);
+		if (rc)
+			break;
 
-		/* At end of each 4Kb page, release nvram lock to allow MFW
-		 * chance to take it for its own use.
+		offset += len;
+		data_buf += len;
+		written_so_far += len;
+		prog->bytes += len;
+		prog->pages++;
+
+		/* Once the time slice is used up, release the nvram lock at
+		 * the page boundary to allow MFW a chance to take it for its
+		 * own use.
 		 */
-		if ((cmd_flags & MCPR_NVM_COMMAND_LAST) &&
-		    (written_so_far < buf_size)) {
+		if ((written_so_far < buf_size) &&
+		    time_after_eq(jiffies, slice_end)) {
 			DP(BNX2X_MSG_ETHTOOL | BNX2X_MSG_NVM,
 			   "Releasing NVM lock after offset 0x%x\n",
 			   (u32)(offset - sizeof(u32)));
 			bnx2x_release_nvram_lock(bp);
+			prog->yields++;
 			usleep_range(1000, 2000);
 			rc = bnx2x_acquire_nvram_lock(bp);
 			if (rc)
-				return rc;
+				goto out;
+			slice_end = jiffies +
+				    msecs_to_jiffies(BNX2X_NVRAM_SLICE_MS);
 		}
-
-		cmd_flags = 0;
 	}
 
 	/* disable access to nvram interface */
 	bnx2x_disable_nvram_access(bp);
 	bnx2x_release_nvram_lock(bp);
 
+out:
+	bnx2x_nvram_wr_end(bp, offset, rc);
 	return rc;
 }
 
@@ -2633,6 +2717,51 @@ static int bnx2x_set_ringparam(struct net_device *dev,
 	return bnx2x_reload_if_running(dev);
 }
 
+#ifdef _HAS_ETHTOOL_TX_COPYBREAK /* BNX2X_UPSTREAM */
+static int bnx2x_get_tunable(struct net_device *dev,
+			     const struct ethtool_tunable *tuna, void *data)
+{
+	struct bnx2x *bp = netdev_priv(dev);
+
+	switch (tuna->id) {
+	case ETHTOOL_TX_COPYBREAK:
+		*(u32 *)data = bp->tx_copybreak;
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static int bnx2x_set_tunable(struct net_device *dev,
+			     const struct ethtool_tunable *tuna,
+			     const void *data)
+{
+	struct bnx2x *bp = netdev_priv(dev);
+	u32 val;
+	bool realloc;
+
+	switch (tuna->id) {
+	case ETHTOOL_TX_COPYBREAK:
+		val = *(const u32 *)data;
+		if (val > BNX2X_TX_COPYBREAK_MAX) {
+			DP(BNX2X_MSG_ETHTOOL,
+			   "tx-copybreak can't exceed %d\n",
+			   BNX2X_TX_COPYBREAK_MAX);
+			return -EINVAL;
+		}
+
+		/* the slab only exists while copybreak is enabled */
+		realloc = !bp->tx_copybreak != !val;
+		bp->tx_copybreak = val;
+		if (realloc)
+			return bnx2x_reload_if_running(dev);
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+#endif
+
 static void bnx2x_get_pauseparam(struct net_device *dev,
 				 struct ethtool_pauseparam *epause)
 {
@@ -2706,9 +2835,7 @@ static int bnx2x_set_pauseparam(struct net_device *dev,
 	   "req_flow_ctrl 0x%x\n", bp->link_params.req_flow_ctrl[cfg_idx]);
 
 	if (netif_running(dev)) {
-		bnx2x_stats_handle(bp, STATS_EVENT_STOP, true);
-		bnx2x_force_link_reset(bp);
-		bnx2x_link_set(bp);
+		bnx2x_link_reconfig(bp);
 	}
 
 	return 0;
@@ -3022,9 +3149,7 @@ static int bnx2x_set_eee(struct net_device *dev, struct ethtool_eee *edata)
 
 	/* Restart link to propagate changes */
 	if (netif_running(dev)) {
-		bnx2x_stats_handle(bp, STATS_EVENT_STOP, true);
-		bnx2x_force_link_reset(bp);
-		bnx2x_link_set(bp);
+		bnx2x_link_reconfig(bp);
 	}
 
 	return 0;
@@ -3483,10 +3608,10 @@ static int bnx2x_run_loopback(struct bnx2x *bp, int loopback_mode)
 		 * bnx2x_tx_int()), as both are taking netif_tx_lock().
 		 */
 		local_bh_disable();
-		bnx2x_tx_int(bp, txdata);
+		bnx2x_tx_int(bp, txdata, 0);
 		local_bh_enable();
 #else
-		bnx2x_tx_int(bp, txdata);
+		bnx2x_tx_int(bp, txdata, 0);
 #endif
 	}
 
@@ -3630,7 +3755,7 @@ struct code_entry {
 	 (code & CODE_IMAGE_LENGTH_MASK) != 0)
 
 #define CRC32_RESIDUAL			0xdebb20e3
-#define CRC_BUFF_SIZE			256
+#define CRC_BUFF_SIZE			4096
 
 static int bnx2x_nvram_crc(struct bnx2x *bp,
 			   int offset,
@@ -3861,12 +3986,143 @@ static int bnx2x_test_intr(struct bnx2x *bp)
 	return bnx2x_queue_state_change(bp, &params);
 }
 
+static void bnx2x_st_phase_done(struct bnx2x *bp, int phase, ktime_t start,
+				int rc)
+{
+	struct bnx2x_st_phase_stat *st = &bp->st_phase[phase];
+	u32 us = (u32)ktime_to_us(ktime_sub(ktime_get(), start));
+
+	st->runs++;
+	st->last_us = us;
+	if (us > st->max_us)
+		st->max_us = us;
+	st->rc = rc;
+
+	DP(BNX2X_MSG_ETHTOOL, "self-test phase %d took %u usec (rc %d)\n",
+	   phase, us, rc);
+}
+
+static int bnx2x_st_nvram(struct bnx2x *bp)
+{
+	ktime_t start = ktime_get();
+	int rc = bnx2x_test_nvram(bp);
+
+	bnx2x_st_phase_done(bp, BNX2X_ST_NVRAM, start, rc);
+	return rc;
+}
+
+static void bnx2x_st_nvram_result(struct bnx2x *bp,
+				  struct ethtool_test *etest, u64 *buf, int rc)
+{
+	if (rc == 0)
+		return;
+
+	if (!IS_MF(bp))
+		buf[4] = 1;
+	else
+		buf[0] = 1;
+	etest->flags |= ETH_TEST_FL_FAILED;
+}
+
+#ifdef BNX2X_ST_ASYNC_NVRAM
+static void bnx2x_st_nvram_task(struct work_struct *work)
+{
+	struct bnx2x *bp = container_of(work, struct bnx2x, st_nvram_work);
+
+	bp->st_nvram_rc = bnx2x_st_nvram(bp);
+}
+#endif
+
+/* Offline tests; returns false if the normal load could not be restored */
+static bool bnx2x_self_test_offline(struct bnx2x *bp,
+				    struct ethtool_test *etest, u64 *buf,
+				    u8 link_up, u8 is_serdes)
+{
+	int port = BP_PORT(bp);
+	ktime_t start;
+	u32 val;
+	int rc;
+
+	/* save current value of input enable for TX port IF */
+	val = REG_RD(bp, NIG_REG_EGRESS_UMP0_IN_EN + port*4);
+	/* disable input for TX port IF */
+	REG_WR(bp, NIG_REG_EGRESS_UMP0_IN_EN + port*4, 0);
+
+	start = ktime_get();
+	bnx2x_nic_unload(bp, UNLOAD_NORMAL, false);
+	rc = bnx2x_nic_load(bp, LOAD_DIAG);
+	bnx2x_st_phase_done(bp, BNX2X_ST_DIAG_LOAD, start, rc);
+	if (rc) {
+		/* skip the offline tests but still restore the normal load
+		 * so the online tests can run
+		 */
+		etest->flags |= ETH_TEST_FL_FAILED;
+		DP(BNX2X_MSG_ETHTOOL,
+		   "Can't perform offline self-test, nic_load (for offline) failed\n");
+		goto restore;
+	}
+
+	/* wait until link state is restored */
+	bnx2x_wait_for_link(bp, 1, is_serdes);
+
+	start = ktime_get();
+	rc = bnx2x_test_registers(bp);
+	bnx2x_st_phase_done(bp, BNX2X_ST_REGISTERS, start, rc);
+	if (rc) {
+		buf[0] = 1;
+		etest->flags |= ETH_TEST_FL_FAILED;
+	}
+
+	start = ktime_get();
+	rc = bnx2x_test_memory(bp);
+	bnx2x_st_phase_done(bp, BNX2X_ST_MEMORY, start, rc);
+	if (rc) {
+		buf[1] = 1;
+		etest->flags |= ETH_TEST_FL_FAILED;
+	}
+
+	start = ktime_get();
+	buf[2] = bnx2x_test_loopback(bp); /* internal LB */
+	bnx2x_st_phase_done(bp, BNX2X_ST_INT_LB, start, (int)buf[2]);
+	if (buf[2] != 0)
+		etest->flags |= ETH_TEST_FL_FAILED;
+
+	if (etest->flags & ETH_TEST_FL_EXTERNAL_LB) {
+		start = ktime_get();
+		buf[3] = bnx2x_test_ext_loopback(bp); /* external LB */
+		bnx2x_st_phase_done(bp, BNX2X_ST_EXT_LB, start, (int)buf[3]);
+		if (buf[3] != 0)
+			etest->flags |= ETH_TEST_FL_FAILED;
+		etest->flags |= ETH_TEST_FL_EXTERNAL_LB_DONE;
+	}
+
+	bnx2x_nic_unload(bp, UNLOAD_NORMAL, false);
+
+restore:
+	/* restore input for TX port IF */
+	REG_WR(bp, NIG_REG_EGRESS_UMP0_IN_EN + port*4, val);
+	start = ktime_get();
+	rc = bnx2x_nic_load(bp, LOAD_NORMAL);
+	bnx2x_st_phase_done(bp, BNX2X_ST_RELOAD, start, rc);
+	if (rc) {
+		etest->flags |= ETH_TEST_FL_FAILED;
+		DP(BNX2X_MSG_ETHTOOL,
+		   "Can't perform self-test, nic_load (for online) failed\n");
+		return false;
+	}
+	/* wait until link state is restored */
+	bnx2x_wait_for_link(bp, link_up, is_serdes);
+
+	return true;
+}
+
 void bnx2x_self_test(struct net_device *dev,
 			    struct ethtool_test *etest, u64 *buf)
 {
 	struct bnx2x *bp = netdev_priv(dev);
 	u8 is_serdes, link_up;
 	int rc, cnt = 0;
+	ktime_t start;
 
 	if (pci_num_vf(bp->pdev)) {
 		DP(BNX2X_MSG_IOV,
@@ -3888,22 +4144,17 @@ void bnx2x_self_test(struct net_device *dev,
 
 	memset(buf, 0, sizeof(u64) * BNX2X_NUM_TESTS(bp));
 
-	if (bnx2x_test_nvram(bp) != 0) {
-		if (!IS_MF(bp))
-			buf[4] = 1;
-		else
-			buf[0] = 1;
-		etest->flags |= ETH_TEST_FL_FAILED;
-	}
-
+	/* Only the NVRAM test can run without a loaded function */
 #ifdef __VMKLNX__ /* ! BNX2X_UPSTREAM */
 	if (bp->state == BNX2X_STATE_ERROR) {
+		bnx2x_st_nvram_result(bp, etest, buf, bnx2x_st_nvram(bp));
 		BNX2X_ERR("Cannot perform self tests in current HW state: 0x%x. Try again later.\n",
 			  bp->state);
 		return;
 	}
 #endif
 	if (!netif_running(dev)) {
+		bnx2x_st_nvram_result(bp, etest, buf, bnx2x_st_nvram(bp));
 		DP(BNX2X_MSG_ETHTOOL, "Interface is down\n");
 		return;
 	}
@@ -3912,62 +4163,29 @@ void bnx2x_self_test(struct net_device *dev,
 	link_up = bp->link_vars.link_up;
 	/* offline tests are not supported in MF mode */
 	if ((etest->flags & ETH_TEST_FL_OFFLINE) && !IS_MF(bp)) {
-		int port = BP_PORT(bp);
-		u32 val;
-
-		/* save current value of input enable for TX port IF */
-		val = REG_RD(bp, NIG_REG_EGRESS_UMP0_IN_EN + port*4);
-		/* disable input for TX port IF */
-		REG_WR(bp, NIG_REG_EGRESS_UMP0_IN_EN + port*4, 0);
-
-		bnx2x_nic_unload(bp, UNLOAD_NORMAL, false);
-		rc = bnx2x_nic_load(bp, LOAD_DIAG);
-		if (rc) {
-			etest->flags |= ETH_TEST_FL_FAILED;
-			DP(BNX2X_MSG_ETHTOOL,
-			   "Can't perform self-test, nic_load (for offline) failed\n");
-			return;
-		}
-
-		/* wait until link state is restored */
-		bnx2x_wait_for_link(bp, 1, is_serdes);
-
-		if (bnx2x_test_registers(bp) != 0) {
-			buf[0] = 1;
-			etest->flags |= ETH_TEST_FL_FAILED;
-		}
-		if (bnx2x_test_memory(bp) != 0) {
-			buf[1] = 1;
-			etest->flags |= ETH_TEST_FL_FAILED;
-		}
-
-		buf[2] = bnx2x_test_loopback(bp); /* internal LB */
-		if (buf[2] != 0)
-			etest->flags |= ETH_TEST_FL_FAILED;
-
-		if (etest->flags & ETH_TEST_FL_EXTERNAL_LB) {
-			buf[3] = bnx2x_test_ext_loopback(bp); /* external LB */
-			if (buf[3] != 0)
-				etest->flags |= ETH_TEST_FL_FAILED;
-			etest->flags |= ETH_TEST_FL_EXTERNAL_LB_DONE;
-		}
-
-		bnx2x_nic_unload(bp, UNLOAD_NORMAL, false);
-
-		/* restore input for TX port IF */
-		REG_WR(bp, NIG_REG_EGRESS_UMP0_IN_EN + port*4, val);
-		rc = bnx2x_nic_load(bp, LOAD_NORMAL);
-		if (rc) {
-			etest->flags |= ETH_TEST_FL_FAILED;
-			DP(BNX2X_MSG_ETHTOOL,
-			   "Can't perform self-test, nic_load (for online) failed\n");
+		if (!bnx2x_self_test_offline(bp, etest, buf, link_up,
+					     is_serdes)) {
+			/* the NVRAM test still runs with the function down */
+			bnx2x_st_nvram_result(bp, etest, buf,
+					      bnx2x_st_nvram(bp));
 			return;
 		}
-		/* wait until link state is restored */
-		bnx2x_wait_for_link(bp, link_up, is_serdes);
 	}
 
-	if (bnx2x_test_intr(bp) != 0) {
+	/* The online tests never unload the function. The NVRAM test only
+	 * touches the flash interface, so it runs alongside the others.
+	 */
+#ifdef BNX2X_ST_ASYNC_NVRAM
+	INIT_WORK(&bp->st_nvram_work, bnx2x_st_nvram_task);
+	schedule_work(&bp->st_nvram_work);
+#else
+	bnx2x_st_nvram_result(bp, etest, buf, bnx2x_st_nvram(bp));
+#endif
+
+	start = ktime_get();
+	rc = bnx2x_test_intr(bp);
+	bnx2x_st_phase_done(bp, BNX2X_ST_INTR, start, rc);
+	if (rc != 0) {
 		if (!IS_MF(bp))
 			buf[5] = 1;
 		else
@@ -3975,11 +4193,13 @@ void bnx2x_self_test(struct net_device *dev,
 		etest->flags |= ETH_TEST_FL_FAILED;
 	}
 
+	start = ktime_get();
 	if (link_up) {
 		cnt = 100;
 		while (bnx2x_link_test(bp, is_serdes) && --cnt)
 			msleep(20);
 	}
+	bnx2x_st_phase_done(bp, BNX2X_ST_LINK, start, cnt ? 0 : -ENOLINK);
 
 	if (!cnt) {
 		if (!IS_MF(bp))
@@ -3990,8 +4210,10 @@ void bnx2x_self_test(struct net_device *dev,
 	}
 #ifndef BNX2X_UPSTREAM /* ! BNX2X_UPSTREAM */
 	/* run the idle check twice */
+	start = ktime_get();
 	bnx2x_idle_chk(bp);
 	rc = bnx2x_idle_chk(bp);
+	bnx2x_st_phase_done(bp, BNX2X_ST_IDLE_CHK, start, rc);
 	if (!IS_MF(bp))
 		buf[7] = rc;
 	else
@@ -3999,6 +4221,11 @@ void bnx2x_self_test(struct net_device *dev,
 	if (rc)
 		etest->flags |= ETH_TEST_FL_FAILED;
 #endif
+
+#ifdef BNX2X_ST_ASYNC_NVRAM
+	flush_work(&bp->st_nvram_work);
+	bnx2x_st_nvram_result(bp, etest, buf, bp->st_nvram_rc);
+#endif
 }
 
 #define IS_PORT_STAT(i)		(bnx2x_stats_arr[i].is_port_stat)
@@ -4798,6 +5025,10 @@ static struct ethtool_ops bnx2x_ethtool_ops = {
 	.set_coalesce		= bnx2x_set_coalesce,
 	.get_ringparam		= bnx2x_get_ringparam,
 	.set_ringparam		= bnx2x_set_ringparam,
+#ifdef _HAS_ETHTOOL_TX_COPYBREAK /* BNX2X_UPSTREAM */
+	.get_tunable		= bnx2x_get_tunable,
+	.set_tunable		= bnx2x_set_tunable,
+#endif
 	.get_pauseparam		= bnx2x_get_pauseparam,
 	.set_pauseparam		= bnx2x_set_pauseparam,
 #if !(RHEL_STARTING_AT_VERSION(6, 6) && RHEL_PRE_VERSION(7, 0)) /* BNX2X_UPSTREAM */
@@ -2824,12 +2824,11 @@ static int bnx2x_cl22_read(struct bnx2x *bp,
 /******************************************************************/
 /*			CL45 access functions			  */
 /******************************************************************/
-static int bnx2x_cl45_read(struct bnx2x *bp, struct bnx2x_phy *phy,
-			   u8 devad, u16 reg, u16 *ret_val)
+/* Bus setup required by the MDC/MDIO workarounds. It only has to be done
+ * once around a sequence of accesses, see bnx2x_cl45_write_batch().
+ */
+static void bnx2x_cl45_access_start(struct bnx2x *bp, struct bnx2x_phy *phy)
 {
-	u32 val;
-	u16 i;
-	int rc = 0;
 	u32 chip_id;
 	if (phy->flags & FLAGS_MDC_MDIO_WA_G) {
 		chip_id = (REG_RD(bp, MISC_REG_CHIP_NUM) << 16) |
@@ -2840,6 +2839,21 @@ static int bnx2x_cl45_read(struct bnx2x *bp, struct bnx2x_phy *phy,
 	if (phy->flags & FLAGS_MDC_MDIO_WA_B0)
 		bnx2x_bits_en(bp, phy->mdio_ctrl + EMAC_REG_EMAC_MDIO_STATUS,
 			      EMAC_MDIO_STATUS_10MB);
+}
+
+static void bnx2x_cl45_access_end(struct bnx2x *bp, struct bnx2x_phy *phy)
+{
+	if (phy->flags & FLAGS_MDC_MDIO_WA_B0)
+		bnx2x_bits_dis(bp, phy->mdio_ctrl + EMAC_REG_EMAC_MDIO_STATUS,
+			       EMAC_MDIO_STATUS_10MB);
+}
+
+static int __bnx2x_cl45_read(struct bnx2x *bp, struct bnx2x_phy *phy,
+			     u8 devad, u16 reg, u16 *ret_val)
+{
+	u32 val;
+	u16 i;
+	int rc = 0;
 	/* Address */
 	val = ((phy->addr << 21) | (devad << 16) | reg |
 	       EMAC_MDIO_COMM_COMMAND_ADDRESS |
@@ -2889,32 +2903,18 @@ static int bnx2x_cl45_read(struct bnx2x *bp, struct bnx2x_phy *phy,
 		phy->flags ^= FLAGS_DUMMY_READ;
 		if (phy->flags & FLAGS_DUMMY_READ) {
 			u16 temp_val;
-			bnx2x_cl45_read(bp, phy, devad, 0xf, &temp_val);
+			__bnx2x_cl45_read(bp, phy, devad, 0xf, &temp_val);
 		}
 	}
-
-	if (phy->flags & FLAGS_MDC_MDIO_WA_B0)
-		bnx2x_bits_dis(bp, phy->mdio_ctrl + EMAC_REG_EMAC_MDIO_STATUS,
-			       EMAC_MDIO_STATUS_10MB);
 	return rc;
 }
 
-static int bnx2x_cl45_write(struct bnx2x *bp, struct bnx2x_phy *phy,
-			    u8 devad, u16 reg, u16 val)
+static int __bnx2x_cl45_write(struct bnx2x *bp, struct bnx2x_phy *phy,
+			      u8 devad, u16 reg, u16 val)
 {
 	u32 tmp;
 	u8 i;
 	int rc = 0;
-	u32 chip_id;
-	if (phy->flags & FLAGS_MDC_MDIO_WA_G) {
-		chip_id = (REG_RD(bp, MISC_REG_CHIP_NUM) << 16) |
-			  ((REG_RD(bp, MISC_REG_CHIP_REV) & 0xf) << 12);
-		bnx2x_set_mdio_clk(bp, chip_id, phy->mdio_ctrl);
-	}
-
-	if (phy->flags & FLAGS_MDC_MDIO_WA_B0)
-		bnx2x_bits_en(bp, phy->mdio_ctrl + EMAC_REG_EMAC_MDIO_STATUS,
-			      EMAC_MDIO_STATUS_10MB);
 
 	/* Address */
 	tmp = ((phy->addr << 21) | (devad << 16) | reg |
@@ -2963,12 +2963,73 @@ static int bnx2x_cl45_write(struct bnx2x *bp, struct bnx2x_phy *phy,
 		phy->flags ^= FLAGS_DUMMY_READ;
 		if (phy->flags & FLAGS_DUMMY_READ) {
 			u16 temp_val;
-			bnx2x_cl45_read(bp, phy, devad, 0xf, &temp_val);
+			__bnx2x_cl45_read(bp, phy, devad, 0xf, &temp_val);
 		}
 	}
-	if (phy->flags & FLAGS_MDC_MDIO_WA_B0)
-		bnx2x_bits_dis(bp, phy->mdio_ctrl + EMAC_REG_EMAC_MDIO_STATUS,
-			       EMAC_MDIO_STATUS_10MB);
+	return rc;
+}
+
+static int bnx2x_cl45_read(struct bnx2x *bp, struct bnx2x_phy *phy,
+			   u8 devad, u16 reg, u16 *ret_val)
+{
+	int rc;
+
+	bnx2x_cl45_access_start(bp, phy);
+	rc = __bnx2x_cl45_read(bp, phy, devad, reg, ret_val);
+	bnx2x_cl45_access_end(bp, phy);
+	return rc;
+}
+
+static int bnx2x_cl45_write(struct bnx2x *bp, struct bnx2x_phy *phy,
+			    u8 devad, u16 reg, u16 val)
+{
+	int rc;
+
+	bnx2x_cl45_access_start(bp, phy);
+	rc = __bnx2x_cl45_write(bp, phy, devad, reg, val);
+	bnx2x_cl45_access_end(bp, phy);
+	return rc;
+}
+
+/* Issue a table of writes back to back, setting up the bus only once. A
+ * timed out access aborts the rest of the table, as the bus is not going
+ * to recover within the batch anyway.
+ */
+static int bnx2x_cl45_write_batch(struct bnx2x *bp, struct bnx2x_phy *phy,
+				  const struct bnx2x_reg_set *regs, u32 cnt)
+{
+	int rc = 0;
+	u32 i;
+
+	bnx2x_cl45_access_start(bp, phy);
+	for (i = 0; i < cnt && !rc; i++)
+		rc = __bnx2x_cl45_write(bp, phy, regs[i].devad, regs[i].reg,
+					regs[i].val);
+	bnx2x_cl45_access_end(bp, phy);
+	return rc;
+}
+
+/* Same as bnx2x_cl45_write_batch() for read-modify-write sequences; each
+ * register gets (val & ~clr) | set.
+ */
+static int bnx2x_cl45_rmw_batch(struct bnx2x *bp, struct bnx2x_phy *phy,
+				const struct bnx2x_reg_rmw *ops, u32 cnt)
+{
+	int rc = 0;
+	u16 val;
+	u32 i;
+
+	bnx2x_cl45_access_start(bp, phy);
+	for (i = 0; i < cnt && !rc; i++) {
+		rc = __bnx2x_cl45_read(bp, phy, ops[i].devad, ops[i].reg,
+				       &val);
+		if (rc)
+			break;
+		val = (val & ~ops[i].clr) | ops[i].set;
+		rc = __bnx2x_cl45_write(bp, phy, ops[i].devad, ops[i].reg,
+					val);
+	}
+	bnx2x_cl45_access_end(bp, phy);
 	return rc;
 }
 
@@ -3809,7 +3870,6 @@ static void bnx2x_warpcore_enable_AN_KR2(struct bnx2x_phy *phy,
 					 struct link_vars *vars)
 {
 	struct bnx2x *bp = params->bp;
-	u16 i;
 	static struct bnx2x_reg_set reg_set[] = {
 		/* Step 1 - Program the TX/RX alignment markers */
 		{MDIO_WC_DEVAD, MDIO_WC_REG_CL82_USERB1_TX_CTRL5, 0xa157},
@@ -3834,9 +3894,7 @@ static void bnx2x_warpcore_enable_AN_KR2(struct bnx2x_phy *phy,
 	bnx2x_cl45_read_or_write(bp, phy, MDIO_WC_DEVAD,
 				 MDIO_WC_REG_CL49_USERB0_CTRL, (3<<6));
 
-	for (i = 0; i < ARRAY_SIZE(reg_set); i++)
-		bnx2x_cl45_write(bp, phy, reg_set[i].devad, reg_set[i].reg,
-				 reg_set[i].val);
+	bnx2x_cl45_write_batch(bp, phy, reg_set, ARRAY_SIZE(reg_set));
 
 	/* Start KR2 work-around timer which handles BCM8073 link-parner */
 	params->link_attr_sync |= LINK_ATTR_SYNC_KR2_ENABLE;
@@ -3848,7 +3906,6 @@ static void bnx2x_disable_kr2(struct link_params *params,
 			      struct bnx2x_phy *phy)
 {
 	struct bnx2x *bp = params->bp;
-	int i;
 	static struct bnx2x_reg_set reg_set[] = {
 		/* Step 1 - Program the TX/RX alignment markers */
 		{MDIO_WC_DEVAD, MDIO_WC_REG_CL82_USERB1_TX_CTRL5, 0x7690},
@@ -3869,9 +3926,7 @@ static void bnx2x_disable_kr2(struct link_params *params,
 	};
 	DP(NETIF_MSG_LINK, "Disabling 20G-KR2\n");
 
-	for (i = 0; i < ARRAY_SIZE(reg_set); i++)
-		bnx2x_cl45_write(bp, phy, reg_set[i].devad, reg_set[i].reg,
-				 reg_set[i].val);
+	bnx2x_cl45_write_batch(bp, phy, reg_set, ARRAY_SIZE(reg_set));
 	params->link_attr_sync &= ~LINK_ATTR_SYNC_KR2_ENABLE;
 	bnx2x_update_link_attr(params, params->link_attr_sync);
 
@@ -3908,7 +3963,7 @@ static void bnx2x_warpcore_restart_AN_KR(struct bnx2x_phy *phy,
 static void bnx2x_warpcore_enable_AN_KR(struct bnx2x_phy *phy,
 					struct link_params *params,
 					struct link_vars *vars) {
-	u16 lane, i, cl72_ctrl, an_adv = 0, val;
+	u16 lane, cl72_ctrl, an_adv = 0, val;
 	u32 wc_lane_config;
 	struct bnx2x *bp = params->bp;
 	static struct bnx2x_reg_set reg_set[] = {
@@ -3923,9 +3978,7 @@ static void bnx2x_warpcore_enable_AN_KR(struct bnx2x_phy *phy,
 	};
 	DP(NETIF_MSG_LINK, "Enable Auto Negotiation for KR\n");
 	/* Set to default registers that may be overriden by 10G force */
-	for (i = 0; i < ARRAY_SIZE(reg_set); i++)
-		bnx2x_cl45_write(bp, phy, reg_set[i].devad, reg_set[i].reg,
-				 reg_set[i].val);
+	bnx2x_cl45_write_batch(bp, phy, reg_set, ARRAY_SIZE(reg_set));
 
 	bnx2x_cl45_read(bp, phy, MDIO_WC_DEVAD,
 			MDIO_WC_REG_CL72_USERB0_CL72_MISC1_CONTROL, &cl72_ctrl);
@@ -4062,7 +4115,7 @@ static void bnx2x_warpcore_set_10G_KR(struct bnx2x_phy *phy,
 				      struct link_vars *vars)
 {
 	struct bnx2x *bp = params->bp;
-	u16 val16, i, lane;
+	u16 val16, lane;
 	static struct bnx2x_reg_set reg_set[] = {
 		/* Disable Autoneg */
 		{MDIO_WC_DEVAD, MDIO_WC_REG_SERDESDIGITAL_CONTROL1000X2, 0x7},
@@ -4076,9 +4129,7 @@ static void bnx2x_warpcore_set_10G_KR(struct bnx2x_phy *phy,
 		{MDIO_PMA_DEVAD, MDIO_WC_REG_PMD_KR_CONTROL, 0x2}
 	};
 
-	for (i = 0; i < ARRAY_SIZE(reg_set); i++)
-		bnx2x_cl45_write(bp, phy, reg_set[i].devad, reg_set[i].reg,
-				 reg_set[i].val);
+	bnx2x_cl45_write_batch(bp, phy, reg_set, ARRAY_SIZE(reg_set));
 
 	lane = bnx2x_get_warpcore_lane(phy, params);
 	/* Global registers */
@@ -4479,7 +4530,6 @@ static void bnx2x_warpcore_clear_regs(struct bnx2x_phy *phy,
 				      u16 lane)
 {
 	struct bnx2x *bp = params->bp;
-	u16 i;
 	static struct bnx2x_reg_set wc_regs[] = {
 		{MDIO_AN_DEVAD, MDIO_AN_REG_CTRL, 0},
 		{MDIO_WC_DEVAD, MDIO_WC_REG_FX100_CTRL1, 0x014a},
@@ -4500,9 +4550,7 @@ static void bnx2x_warpcore_clear_regs(struct bnx2x_phy *phy,
 	bnx2x_cl45_read_or_write(bp, phy, MDIO_WC_DEVAD,
 				 MDIO_WC_REG_RX66_CONTROL, (3<<13));
 
-	for (i = 0; i < ARRAY_SIZE(wc_regs); i++)
-		bnx2x_cl45_write(bp, phy, wc_regs[i].devad, wc_regs[i].reg,
-				 wc_regs[i].val);
+	bnx2x_cl45_write_batch(bp, phy, wc_regs, ARRAY_SIZE(wc_regs));
 
 	lane = bnx2x_get_warpcore_lane(phy, params);
 	bnx2x_cl45_write(bp, phy, MDIO_WC_DEVAD,
@@ -6818,6 +6866,99 @@ int bnx2x_test_link(struct link_params *params, struct link_vars *vars,
 	return -ESRCH;
 }
 
+/******************************************************************/
+/*			Link bring-up profile			  */
+/******************************************************************/
+static u32 bnx2x_link_prof_now(struct link_params *params)
+{
+	u32 usec = (u32)ktime_to_us(ktime_sub(ktime_get(),
+					      params->prof.start));
+
+	/* Zero is reserved for "phase not reached" */
+	return usec ? usec : 1;
+}
+
+static void bnx2x_link_prof_start(struct link_params *params, u8 path)
+{
+	struct link_prof *prof = &params->prof;
+
+	prof->start = ktime_get();
+	memset(prof->phase_us, 0, sizeof(prof->phase_us));
+	prof->link_up_us = 0;
+	prof->wait_link_up = 1;
+	prof->path = path;
+	prof->runs++;
+}
+
+static void bnx2x_link_prof_mark(struct link_params *params,
+				 enum bnx2x_link_prof_phase phase)
+{
+	params->prof.phase_us[phase] = bnx2x_link_prof_now(params);
+}
+
+static void bnx2x_link_prof_link_up(struct link_params *params)
+{
+	struct link_prof *prof = &params->prof;
+
+	prof->link_up_us = bnx2x_link_prof_now(params);
+	if (prof->link_up_us > prof->link_up_max_us)
+		prof->link_up_max_us = prof->link_up_us;
+	prof->wait_link_up = 0;
+	DP(NETIF_MSG_LINK, "Link up %u usec after phy init (path %d)\n",
+	   prof->link_up_us, prof->path);
+}
+
+static void bnx2x_phy_config_init_prof(struct bnx2x_phy *phy,
+				       struct link_params *params,
+				       struct link_vars *vars, u8 phy_index)
+{
+	struct link_prof *prof = &params->prof;
+	ktime_t start = ktime_get();
+	u32 usec;
+
+	phy->config_init(phy, params, vars);
+
+	usec = (u32)ktime_to_us(ktime_sub(ktime_get(), start));
+	prof->phy_type[phy_index] = phy->type;
+	prof->phy_cfg_us[phy_index] = usec;
+	if (usec > prof->phy_cfg_max_us[phy_index])
+		prof->phy_cfg_max_us[phy_index] = usec;
+}
+
+static void bnx2x_link_req_fill(struct link_params *params,
+				struct link_req_snap *snap)
+{
+	memset(snap, 0, sizeof(*snap));
+	memcpy(snap->req_duplex, params->req_duplex,
+	       sizeof(snap->req_duplex));
+	memcpy(snap->req_flow_ctrl, params->req_flow_ctrl,
+	       sizeof(snap->req_flow_ctrl));
+	memcpy(snap->req_line_speed, params->req_line_speed,
+	       sizeof(snap->req_line_speed));
+	memcpy(snap->speed_cap_mask, params->speed_cap_mask,
+	       sizeof(snap->speed_cap_mask));
+	snap->req_fc_auto_adv = params->req_fc_auto_adv;
+	snap->eee_mode = params->eee_mode;
+	snap->multi_phy_config = params->multi_phy_config;
+	snap->feature_config_flags = params->feature_config_flags;
+	snap->loopback_mode = params->loopback_mode;
+	snap->valid = 1;
+}
+
+u8 bnx2x_link_req_unchanged(struct link_params *params,
+			    struct link_vars *vars)
+{
+	struct link_req_snap cur;
+
+	if (!params->req_snap.valid || !vars->link_up ||
+	    !(params->link_flags & PHY_INITIALIZED) ||
+	    (params->loopback_mode != LOOPBACK_NONE))
+		return 0;
+
+	bnx2x_link_req_fill(params, &cur);
+	return !memcmp(&cur, &params->req_snap, sizeof(cur));
+}
+
 static int bnx2x_link_initialize(struct link_params *params,
 				 struct link_vars *vars)
 {
@@ -6849,7 +6990,8 @@ static int bnx2x_link_initialize(struct link_params *params,
 		     CHIP_IS_E2(bp)))
 			bnx2x_set_parallel_detection(phy, params);
 		if (params->phy[INT_PHY].config_init)
-			params->phy[INT_PHY].config_init(phy, params, vars);
+			bnx2x_phy_config_init_prof(phy, params, vars,
+						   INT_PHY);
 	}
 
 	/* Re-read this value in case it was changed inside config_init due to
@@ -6882,9 +7024,9 @@ static int bnx2x_link_initialize(struct link_params *params,
 				continue;
 			}
 			if (params->phy[phy_index].config_init) {
-				params->phy[phy_index].config_init(
+				bnx2x_phy_config_init_prof(
 					&params->phy[phy_index],
-					params, vars);
+					params, vars, phy_index);
 			}
 		}
 	}
@@ -7337,6 +7479,9 @@ int bnx2x_link_update(struct link_params *params, struct link_vars *vars)
 			  SINGLE_MEDIA_DIRECT(params)) &&
 			 (phy_vars[active_external_phy].fault_detected == 0));
 
+	if (vars->link_up && params->prof.wait_link_up)
+		bnx2x_link_prof_link_up(params);
+
 	/* Update the PFC configuration in case it was changed */
 	if (params->feature_config_flags & FEATURE_CONFIG_PFC_ENABLED)
 		vars->link_status |= LINK_STATUS_PFC_ENABLED;
@@ -9592,30 +9737,37 @@ static void bnx2x_8727_config_speed(struct bnx2x_phy *phy,
 				    struct link_params *params)
 {
 	struct bnx2x *bp = params->bp;
-	u16 tmp1, val;
+	static struct bnx2x_reg_set force_1g[] = {
+		{MDIO_PMA_DEVAD, MDIO_PMA_REG_CTRL, 0x40},
+		{MDIO_PMA_DEVAD, MDIO_PMA_REG_10G_CTRL2, 0xD}
+	};
+	static struct bnx2x_reg_set cl37_1g[] = {
+		{MDIO_AN_DEVAD, MDIO_AN_REG_8727_MISC_CTRL, 0},
+		{MDIO_AN_DEVAD, MDIO_AN_REG_CL37_AN, 0x1300}
+	};
+	static struct bnx2x_reg_set force_10g[] = {
+		{MDIO_AN_DEVAD, MDIO_AN_REG_8727_MISC_CTRL, 0x0020},
+		{MDIO_AN_DEVAD, MDIO_AN_REG_CL37_AN, 0x0100},
+		{MDIO_PMA_DEVAD, MDIO_PMA_REG_CTRL, 0x2040},
+		{MDIO_PMA_DEVAD, MDIO_PMA_REG_10G_CTRL2, 0x0008}
+	};
+	u16 tmp1;
 	/* Set option 1G speed */
 	if ((phy->req_line_speed == SPEED_1000) ||
 	    (phy->media_type == ETH_PHY_SFP_1G_FIBER)) {
 		DP(NETIF_MSG_LINK, "Setting 1G force\n");
-		bnx2x_cl45_write(bp, phy,
-				 MDIO_PMA_DEVAD, MDIO_PMA_REG_CTRL, 0x40);
-		bnx2x_cl45_write(bp, phy,
-				 MDIO_PMA_DEVAD, MDIO_PMA_REG_10G_CTRL2, 0xD);
+		bnx2x_cl45_write_batch(bp, phy, force_1g,
+				       ARRAY_SIZE(force_1g));
 		bnx2x_cl45_read(bp, phy,
 				MDIO_PMA_DEVAD, MDIO_PMA_REG_10G_CTRL2, &tmp1);
 		DP(NETIF_MSG_LINK, "1.7 = 0x%x\n", tmp1);
 		/* Power down the XAUI until link is up in case of dual-media
 		 * and 1G
 		 */
-		if (DUAL_MEDIA(params)) {
-			bnx2x_cl45_read(bp, phy,
-					MDIO_PMA_DEVAD,
-					MDIO_PMA_REG_8727_PCS_GP, &val);
-			val |= (3<<10);
-			bnx2x_cl45_write(bp, phy,
-					 MDIO_PMA_DEVAD,
-					 MDIO_PMA_REG_8727_PCS_GP, val);
-		}
+		if (DUAL_MEDIA(params))
+			bnx2x_cl45_read_or_write(bp, phy, MDIO_PMA_DEVAD,
+						 MDIO_PMA_REG_8727_PCS_GP,
+						 (3<<10));
 	} else if ((phy->req_line_speed == SPEED_AUTO_NEG) &&
 		   ((phy->speed_cap_mask &
 		     PORT_HW_CFG_SPEED_CAPABILITY_D0_1G)) &&
@@ -9624,24 +9776,13 @@ static void bnx2x_8727_config_speed(struct bnx2x_phy *phy,
 		   PORT_HW_CFG_SPEED_CAPABILITY_D0_10G)) {
 
 		DP(NETIF_MSG_LINK, "Setting 1G clause37\n");
-		bnx2x_cl45_write(bp, phy,
-				 MDIO_AN_DEVAD, MDIO_AN_REG_8727_MISC_CTRL, 0);
-		bnx2x_cl45_write(bp, phy,
-				 MDIO_AN_DEVAD, MDIO_AN_REG_CL37_AN, 0x1300);
+		bnx2x_cl45_write_batch(bp, phy, cl37_1g, ARRAY_SIZE(cl37_1g));
 	} else {
 		/* Since the 8727 has only single reset pin, need to set the 10G
 		 * registers although it is default
 		 */
-		bnx2x_cl45_write(bp, phy,
-				 MDIO_AN_DEVAD, MDIO_AN_REG_8727_MISC_CTRL,
-				 0x0020);
-		bnx2x_cl45_write(bp, phy,
-				 MDIO_AN_DEVAD, MDIO_AN_REG_CL37_AN, 0x0100);
-		bnx2x_cl45_write(bp, phy,
-				 MDIO_PMA_DEVAD, MDIO_PMA_REG_CTRL, 0x2040);
-		bnx2x_cl45_write(bp, phy,
-				 MDIO_PMA_DEVAD, MDIO_PMA_REG_10G_CTRL2,
-				 0x0008);
+		bnx2x_cl45_write_batch(bp, phy, force_10g,
+				       ARRAY_SIZE(force_10g));
 	}
 }
 
@@ -9650,8 +9791,12 @@ static int bnx2x_8727_config_init(struct bnx2x_phy *phy,
 				  struct link_vars *vars)
 {
 	u32 tx_en_mode;
-	u16 tmp1, mod_abs, tmp2;
+	u16 tmp1, mod_abs;
 	struct bnx2x *bp = params->bp;
+	static struct bnx2x_reg_rmw txonoff_pwrdn_dis[] = {
+		{MDIO_PMA_DEVAD, MDIO_PMA_REG_8727_OPT_CFG_REG, 0x0010, 0x1000},
+		{MDIO_PMA_DEVAD, MDIO_PMA_REG_PHY_IDENTIFIER, 0x8000, 0}
+	};
 	/* Enable PMD link, MOD_ABS_FLT, and 1G link alarm */
 
 	bnx2x_wait_reset_complete(bp, phy, params);
@@ -9714,18 +9859,8 @@ static int bnx2x_8727_config_init(struct bnx2x_phy *phy,
 	if (tx_en_mode == PORT_HW_CFG_TX_LASER_GPIO0) {
 
 		DP(NETIF_MSG_LINK, "Enabling TXONOFF_PWRDN_DIS\n");
-		bnx2x_cl45_read(bp, phy,
-			MDIO_PMA_DEVAD, MDIO_PMA_REG_8727_OPT_CFG_REG, &tmp2);
-		tmp2 |= 0x1000;
-		tmp2 &= 0xFFEF;
-		bnx2x_cl45_write(bp, phy,
-			MDIO_PMA_DEVAD, MDIO_PMA_REG_8727_OPT_CFG_REG, tmp2);
-		bnx2x_cl45_read(bp, phy,
-				MDIO_PMA_DEVAD, MDIO_PMA_REG_PHY_IDENTIFIER,
-				&tmp2);
-		bnx2x_cl45_write(bp, phy,
-				 MDIO_PMA_DEVAD, MDIO_PMA_REG_PHY_IDENTIFIER,
-				 (tmp2 & 0x7fff));
+		bnx2x_cl45_rmw_batch(bp, phy, txonoff_pwrdn_dis,
+				     ARRAY_SIZE(txonoff_pwrdn_dis));
 	}
 
 	return 0;
@@ -10005,7 +10140,7 @@ static void bnx2x_save_848xx_spirom_version(struct bnx2x_phy *phy,
 					    struct bnx2x *bp,
 					    u8 port)
 {
-	u16 val, fw_ver2, cnt, i;
+	u16 val, fw_ver2, cnt;
 	static struct bnx2x_reg_set reg_set[] = {
 		{MDIO_PMA_DEVAD, 0xA819, 0x0014},
 		{MDIO_PMA_DEVAD, 0xA81A, 0xc200},
@@ -10023,9 +10158,7 @@ static void bnx2x_save_848xx_spirom_version(struct bnx2x_phy *phy,
 	} else {
 		/* For 32-bit registers in 848xx, access via MDIO2ARM i/f. */
 		/* (1) set reg 0xc200_0014(SPI_BRIDGE_CTRL_2) to 0x03000000 */
-		for (i = 0; i < ARRAY_SIZE(reg_set); i++)
-			bnx2x_cl45_write(bp, phy, reg_set[i].devad,
-					 reg_set[i].reg, reg_set[i].val);
+		bnx2x_cl45_write_batch(bp, phy, reg_set, ARRAY_SIZE(reg_set));
 
 		for (cnt = 0; cnt < 100; cnt++) {
 			bnx2x_cl45_read(bp, phy, MDIO_PMA_DEVAD, 0xA818, &val);
@@ -10073,7 +10206,7 @@ static void bnx2x_save_848xx_spirom_version(struct bnx2x_phy *phy,
 static void bnx2x_848xx_set_led(struct bnx2x *bp,
 				struct bnx2x_phy *phy)
 {
-	u16 val, led3_blink_rate, offset, i;
+	u16 val, led3_blink_rate, offset;
 	static struct bnx2x_reg_set reg_set[] = {
 		{MDIO_PMA_DEVAD, MDIO_PMA_REG_8481_LED1_MASK, 0x0080},
 		{MDIO_PMA_DEVAD, MDIO_PMA_REG_8481_LED2_MASK, 0x0018},
@@ -10112,9 +10245,7 @@ static void bnx2x_848xx_set_led(struct bnx2x *bp,
 			 MDIO_PMA_DEVAD,
 			 MDIO_PMA_REG_8481_LINK_SIGNAL, val);
 
-	for (i = 0; i < ARRAY_SIZE(reg_set); i++)
-		bnx2x_cl45_write(bp, phy, reg_set[i].devad, reg_set[i].reg,
-				 reg_set[i].val);
+	bnx2x_cl45_write_batch(bp, phy, reg_set, ARRAY_SIZE(reg_set));
 
 	if (bnx2x_is_8483x_8485x(phy))
 		offset = MDIO_PMA_REG_84833_CTL_LED_CTL_1;
@@ -10344,6 +10475,28 @@ static int bnx2x_8481_config_init(struct bnx2x_phy *phy,
 	(PHY848xx_CMDHDLR_WAIT / CMDHDLR_SLEEP)
 #define PHY848xx_CMDHDLR_MAX_ARGS 5
 
+/* Load the mailbox arguments followed by the command code as one batch */
+static int bnx2x_848xx_cmd_post(struct bnx2x *bp, struct bnx2x_phy *phy,
+				u16 fw_cmd, u16 cmd_args[], int argc)
+{
+	struct bnx2x_reg_set regs[PHY848xx_CMDHDLR_MAX_ARGS + 1];
+	int idx;
+
+	if (argc > PHY848xx_CMDHDLR_MAX_ARGS)
+		return -EINVAL;
+
+	for (idx = 0; idx < argc; idx++) {
+		regs[idx].devad = MDIO_CTL_DEVAD;
+		regs[idx].reg = MDIO_848xx_CMD_HDLR_DATA1 + idx;
+		regs[idx].val = cmd_args[idx];
+	}
+	regs[argc].devad = MDIO_CTL_DEVAD;
+	regs[argc].reg = MDIO_848xx_CMD_HDLR_COMMAND;
+	regs[argc].val = fw_cmd;
+
+	return bnx2x_cl45_write_batch(bp, phy, regs, argc + 1);
+}
+
 static int bnx2x_84858_cmd_hdlr(struct bnx2x_phy *phy,
 					   struct link_params *params,
 					   u16 fw_cmd,
@@ -10375,19 +10528,13 @@ static int bnx2x_84858_cmd_hdlr(struct bnx2x_phy *phy,
 
 	/* Step2: If any parameters are required for the function, write them
 	 * to the required DATA registers
-	 */
-
-	for (idx = 0; idx < argc; idx++) {
-		bnx2x_cl45_write(bp, phy, MDIO_CTL_DEVAD,
-				 MDIO_848xx_CMD_HDLR_DATA1 + idx,
-				 cmd_args[idx]);
-	}
-
-	/* Step3: When the firmware is ready for commands, write the 'Command
+	 * Step3: When the firmware is ready for commands, write the 'Command
 	 * code' to the CMD register
 	 */
-	bnx2x_cl45_write(bp, phy, MDIO_CTL_DEVAD,
-			 MDIO_848xx_CMD_HDLR_COMMAND, fw_cmd);
+	if (bnx2x_848xx_cmd_post(bp, phy, fw_cmd, cmd_args, argc)) {
+		DP(NETIF_MSG_LINK, "FW cmd: failed to post command.\n");
+		return -EINVAL;
+	}
 
 	/* Step4: Once the command has been written, poll the STATUS register
 	 * to check whether the command has completed (CMD_COMPLETED_PASS/
@@ -10472,23 +10619,11 @@ static int bnx2x_84833_cmd_hdlr(struct bnx2x_phy *phy,
 		return -EINVAL;
 	}
 
-	if (process == PHY84833_MB_PROCESS1 ||
-	    process == PHY84833_MB_PROCESS2) {
-		/* Prepare argument(s) */
-		for (idx = 0; idx < argc; idx++) {
-			if (bnx2x_cl45_write(bp, phy, MDIO_CTL_DEVAD,
-					     MDIO_848xx_CMD_HDLR_DATA1 + idx,
-					     cmd_args[idx])) {
-				return -EINVAL;
-			}
-		}
-	}
-
-	/* Issue command */
-	if (bnx2x_cl45_write(bp, phy, MDIO_CTL_DEVAD,
-			     MDIO_848xx_CMD_HDLR_COMMAND, fw_cmd)) {
+	/* Prepare argument(s) and issue command */
+	if (bnx2x_848xx_cmd_post(bp, phy, fw_cmd, cmd_args,
+				 (process == PHY84833_MB_PROCESS1 ||
+				  process == PHY84833_MB_PROCESS2) ? argc : 0))
 		return -EINVAL;
-	}
 	for (idx = 0; idx < PHY848xx_CMDHDLR_WAIT_LOOP; idx++) {
 		if (bnx2x_cl45_read(bp, phy, MDIO_CTL_DEVAD,
 				    MDIO_848xx_CMD_HDLR_STATUS, &val)) {
@@ -13600,9 +13735,11 @@ static void bnx2x_cannot_avoid_link_flap(struct link_params *params,
 
 int bnx2x_phy_init(struct link_params *params, struct link_vars *vars)
 {
-	int lfa_status;
+	int lfa_status, rc;
 	struct bnx2x *bp = params->bp;
 	DP(NETIF_MSG_LINK, "Phy Initialization started\n");
+	bnx2x_link_prof_start(params, LINK_PROF_PATH_FULL);
+	params->req_snap.valid = 0;
 	DP(NETIF_MSG_LINK, "(1) req_speed %d, req_flowctrl %d\n",
 		   params->req_line_speed[0], params->req_flow_ctrl[0]);
 	DP(NETIF_MSG_LINK, "(2) req_speed %d, req_flowctrl %d\n",
@@ -13635,15 +13772,25 @@ int bnx2x_phy_init(struct link_params *params, struct link_vars *vars)
 
 	/* Check if link flap can be avoided */
 	lfa_status = bnx2x_check_lfa(params);
+	bnx2x_link_prof_mark(params, LINK_PROF_LFA_CHECK);
 	ADD_DBG_DATA_BITS(params, LFA_RESULT, lfa_status);
 	if (lfa_status == 0) {
 		DP(NETIF_MSG_LINK, "Link Flap Avoidance in progress\n");
-		return bnx2x_avoid_link_flap(params, vars);
+		params->prof.path = LINK_PROF_PATH_LFA;
+		params->prof.lfa_runs++;
+		rc = bnx2x_avoid_link_flap(params, vars);
+		bnx2x_link_prof_mark(params, LINK_PROF_INT_ENABLE);
+		if (!rc)
+			bnx2x_link_req_fill(params, &params->req_snap);
+		if (vars->link_up)
+			bnx2x_link_prof_link_up(params);
+		return rc;
 	}
 
 	DP(NETIF_MSG_LINK, "Cannot avoid link flap lfa_sta=0x%x\n",
 		       lfa_status);
 	bnx2x_cannot_avoid_link_flap(params, vars, lfa_status);
+	bnx2x_link_prof_mark(params, LINK_PROF_LINK_RESET);
 
 	/* Disable attentions */
 	bnx2x_bits_dis(bp, NIG_REG_MASK_INTERRUPT_PORT0 + params->port*4,
@@ -13657,6 +13804,7 @@ int bnx2x_phy_init(struct link_params *params, struct link_vars *vars)
 #endif
 
 	bnx2x_emac_init(params, vars);
+	bnx2x_link_prof_mark(params, LINK_PROF_MAC_INIT);
 
 	if (params->feature_config_flags & FEATURE_CONFIG_PFC_ENABLED)
 		vars->link_status |= LINK_STATUS_PFC_ENABLED;
@@ -13704,8 +13852,11 @@ int bnx2x_phy_init(struct link_params *params, struct link_vars *vars)
 				bnx2x_serdes_deassert(bp, params->port);
 		}
 		bnx2x_link_initialize(params, vars);
+		bnx2x_link_prof_mark(params, LINK_PROF_PHY_CONFIG);
 		msleep(30);
 		bnx2x_link_int_enable(params);
+		bnx2x_link_prof_mark(params, LINK_PROF_INT_ENABLE);
+		bnx2x_link_req_fill(params, &params->req_snap);
 		break;
 	}
 	bnx2x_update_mng(params, vars->link_status);
@@ -13720,6 +13871,7 @@ int bnx2x_link_reset(struct link_params *params, struct link_vars *vars,
 	struct bnx2x *bp = params->bp;
 	u8 phy_index, port = params->port, clear_latch_ind = 0;
 	DP(NETIF_MSG_LINK, "Resetting the link of port %d\n", port);
+	params->req_snap.valid = 0;
 	/* Disable attentions */
 	vars->link_status = 0;
 	bnx2x_chng_link_count(params, 1);
@@ -13825,6 +13977,7 @@ int bnx2x_lfa_reset(struct link_params *params,
 	vars->link_up = 0;
 	vars->phy_flags = 0;
 	params->link_flags &= ~PHY_INITIALIZED;
+	params->req_snap.valid = 0;
 	if (!params->lfa_base)
 		return bnx2x_link_reset(params, vars, 1);
 	/*
@@ -126,6 +126,9 @@
 #define SFP_EEPROM_A2_TX_POWER_SIZE		2
 #define SFP_EEPROM_A2_RX_POWER_ADDR		0x68
 #define SFP_EEPROM_A2_RX_POWER_SIZE		2
+/* Diagnostics, status/control and alarm/warning flags */
+#define SFP_EEPROM_A2_DYN_ADDR			0x60
+#define SFP_EEPROM_A2_DYN_SIZE			0x20
 
 #define PWR_FLT_ERR_MSG_LEN			250
 
@@ -205,6 +208,13 @@ struct bnx2x_reg_set {
 	u16 val;
 };
 
+struct bnx2x_reg_rmw {
+	u8  devad;
+	u16 reg;
+	u16 clr;
+	u16 set;
+};
+
 struct bnx2x_phy {
 	u32 type;
 
@@ -300,6 +310,53 @@ struct mfw_debug_data {
 	u32 *fw_dbg_data_buf;
 };
 
+/* Link bring-up profile. Phase offsets are in usec from the start of the
+ * last bnx2x_phy_init(); a zero offset means the phase was not reached.
+ */
+enum bnx2x_link_prof_phase {
+	LINK_PROF_LFA_CHECK,
+	LINK_PROF_LINK_RESET,
+	LINK_PROF_MAC_INIT,
+	LINK_PROF_PHY_CONFIG,
+	LINK_PROF_INT_ENABLE,
+	LINK_PROF_MAX
+};
+
+#define LINK_PROF_PATH_FULL	0
+#define LINK_PROF_PATH_LFA	1
+#define LINK_PROF_PATH_FAST	2
+
+struct link_prof {
+	ktime_t start;
+	u32 phase_us[LINK_PROF_MAX];
+	u32 link_up_us;		/* phy_init start to first link up */
+	u32 link_up_max_us;
+	u8 path;
+	u8 wait_link_up;
+	u16 rsrv;
+	u32 phy_type[MAX_PHYS];
+	u32 phy_cfg_us[MAX_PHYS];	/* last config_init duration */
+	u32 phy_cfg_max_us[MAX_PHYS];
+	u32 runs;
+	u32 lfa_runs;
+	u32 fast_runs;
+};
+
+/* Requested link parameters as applied by the last successful phy_init */
+struct link_req_snap {
+	u16 req_duplex[LINK_CONFIG_SIZE];
+	u16 req_flow_ctrl[LINK_CONFIG_SIZE];
+	u16 req_line_speed[LINK_CONFIG_SIZE];
+	u16 req_fc_auto_adv;
+	u32 speed_cap_mask[LINK_CONFIG_SIZE];
+	u32 eee_mode;
+	u32 multi_phy_config;
+	u32 feature_config_flags;
+	u8 loopback_mode;
+	u8 valid;
+	u16 rsrv;
+};
+
 /* Inputs parameters to the CLC */
 struct link_params {
 
@@ -411,6 +468,10 @@ struct link_params {
 
 	struct mfw_debug_data *mfw_dbg_data;
 	u32 *fw_dbg_data_buf;
+
+	/* Filled by the CLC, read by the driver */
+	struct link_prof prof;
+	struct link_req_snap req_snap;
 };
 
 /* DEBUG_DATA header format for Driver Mbox */
@@ -610,6 +671,10 @@ int bnx2x_phy_init(struct link_params *params, struct link_vars *vars);
 int bnx2x_link_reset(struct link_params *params, struct link_vars *vars,
 		     u8 reset_ext_phy);
 int bnx2x_lfa_reset(struct link_params *params, struct link_vars *vars);
+/* Returns 1 if the link is up and was brought up with the currently requested
+   parameters, i.e. a phy_init would only reprogram the same settings */
+u8 bnx2x_link_req_unchanged(struct link_params *params,
+			    struct link_vars *vars);
 /* bnx2x_link_update should be called upon link interrupt */
 int bnx2x_link_update(struct link_params *params, struct link_vars *vars);
 
@@ -334,6 +334,40 @@ static int intr_mitigation;
 module_param(intr_mitigation, uint, 0644);
 MODULE_PARM_DESC(intr_mitigation, "When set to '1' will enable the interrupt mitigation; 0 by Default");
 
+uint pfc_storm_timeout;
+module_param(pfc_storm_timeout, uint, 0644);
+MODULE_PARM_DESC(pfc_storm_timeout, " Seconds a PFC paused traffic class may stay stuck before its Tx queues are stopped until the storm ends; 0 (default) only counts pauses");
+
+static uint sfp_dom_interval;
+module_param(sfp_dom_interval, uint, 0644);
+MODULE_PARM_DESC(sfp_dom_interval, " Seconds between background refreshes of the cached SFP module EEPROM and DOM data; 0 (default) reads the module on every request");
+
+static uint parity_scope = 1;
+module_param(parity_scope, uint, 0644);
+MODULE_PARM_DESC(parity_scope, " Recover parity errors in block-local sources by reloading the function when it is the only one loaded on the path, without a path reset; 0 always resets the whole path. Default:1");
+
+uint tx_hang_timeout = 3;
+module_param(tx_hang_timeout, uint, 0644);
+MODULE_PARM_DESC(tx_hang_timeout, " Seconds a Tx ring may hold pending packets without completions before only its queue is reset; 0 disables the watchdog and Tx timeouts always reload the function. Default:3");
+
+uint tx_done_batch;
+module_param(tx_done_batch, uint, 0644);
+MODULE_PARM_DESC(tx_done_batch, " While NAPI keeps polling for Rx, defer Tx completions until this many packets are done or the ring is tx_done_ring_pct full; 0 (default) reclaims on every poll");
+
+uint tx_done_ring_pct = 25;
+module_param(tx_done_ring_pct, uint, 0644);
+MODULE_PARM_DESC(tx_done_ring_pct, " Tx ring usage (percent) above which Tx completions are never deferred. Default:25");
+
+static uint link_fast_reconnect = 1;
+module_param(link_fast_reconnect, uint, 0644);
+MODULE_PARM_DESC(link_fast_reconnect, " Skip the link reset on ethtool link requests that leave the applied link parameters unchanged. Default:1");
+
+#ifdef BCM_PTP /* BNX2X_UPSTREAM */
+static uint phc_extrapolate_us = 1000;
+module_param(phc_extrapolate_us, uint, 0644);
+MODULE_PARM_DESC(phc_extrapolate_us, " Max age (usec) of a PHC sample which PHC reads may extrapolate from; 0 reads the HW on every call. Default:1000");
+#endif
+
 static struct workqueue_struct *bnx2x_wq;
 struct workqueue_struct *bnx2x_iov_wq;
 
@@ -976,13 +1010,13 @@ void bnx2x_write_dmae(struct bnx2x *bp, dma_addr_t dma_addr, u32 dst_addr,
 	}
 }
 
-void bnx2x_read_dmae(struct bnx2x *bp, u32 src_addr, u32 len32)
+static void __bnx2x_read_dmae(struct bnx2x *bp, u32 src_addr, u32 *data,
+			      dma_addr_t mapping, u32 len32)
 {
 	int rc;
 	struct dmae_command dmae;
 
 	if (!bp->dmae_ready) {
-		u32 *data = bnx2x_sp(bp, wb_data[0]);
 		int i;
 
 		if (CHIP_IS_E1(bp))
@@ -1001,8 +1035,8 @@ void bnx2x_read_dmae(struct bnx2x *bp, u32 src_addr, u32 len32)
 	/* fill in addresses and len */
 	dmae.src_addr_lo = src_addr >> 2;
 	dmae.src_addr_hi = 0;
-	dmae.dst_addr_lo = U64_LO(bnx2x_sp_mapping(bp, wb_data));
-	dmae.dst_addr_hi = U64_HI(bnx2x_sp_mapping(bp, wb_data));
+	dmae.dst_addr_lo = U64_LO(mapping);
+	dmae.dst_addr_hi = U64_HI(mapping);
 	dmae.len = len32;
 
 	/* issue the command and wait for completion */
@@ -1016,6 +1050,26 @@ void bnx2x_read_dmae(struct bnx2x *bp, u32 src_addr, u32 len32)
 	}
 }
 
+void bnx2x_read_dmae(struct bnx2x *bp, u32 src_addr, u32 len32)
+{
+	__bnx2x_read_dmae(bp, src_addr, bnx2x_sp(bp, wb_data[0]),
+			  bnx2x_sp_mapping(bp, wb_data), len32);
+}
+
+#ifndef BNX2X_UPSTREAM /* ! BNX2X_UPSTREAM */
+/* Read up to DMAE_LEN32_RD_MAX consecutive dwords in a single DMAE command.
+ * The returned buffer is valid until the next bulk read.
+ */
+u32 *bnx2x_read_dmae_bulk(struct bnx2x *bp, u32 src_addr, u32 len32)
+{
+	u32 *data = bnx2x_sp(bp, bulk_data[0]);
+
+	__bnx2x_read_dmae(bp, src_addr, data, bnx2x_sp_mapping(bp, bulk_data),
+			  min_t(u32, len32, DMAE_LEN32_RD_MAX));
+	return data;
+}
+#endif
+
 static void bnx2x_write_dmae_phys_len(struct bnx2x *bp, dma_addr_t phys_addr,
 				      u32 addr, u32 len)
 {
@@ -3003,6 +3057,32 @@ void bnx2x_force_link_reset(struct bnx2x *bp)
 	bnx2x_release_phy_lock(bp);
 }
 
+void bnx2x_link_reconfig(struct bnx2x *bp)
+{
+	u8 unchanged = 0;
+
+	if (link_fast_reconnect) {
+		bnx2x_acquire_phy_lock(bp);
+		unchanged = bnx2x_link_req_unchanged(&bp->link_params,
+						     &bp->link_vars);
+		if (unchanged) {
+			bp->link_params.prof.path = LINK_PROF_PATH_FAST;
+			bp->link_params.prof.fast_runs++;
+		}
+		bnx2x_release_phy_lock(bp);
+	}
+
+	if (unchanged) {
+		DP(NETIF_MSG_LINK,
+		   "Link parameters unchanged - keeping the link up\n");
+		return;
+	}
+
+	bnx2x_stats_handle(bp, STATS_EVENT_STOP, true);
+	bnx2x_force_link_reset(bp);
+	bnx2x_link_set(bp);
+}
+
 u8 bnx2x_link_test(struct bnx2x *bp, u8 is_serdes)
 {
 	u8 rc = 0;
@@ -4146,8 +4226,10 @@ static void bnx2x_e1h_enable(struct bnx2x *bp)
 	if (!(IS_MF_UFP(bp) && BNX2X_IS_MF_SD_PROTOCOL_FCOE(bp)))
 		REG_WR(bp, NIG_REG_LLH0_FUNC_EN + port*8, 1);
 
-	/* Tx queue should be only re-enabled */
-	netif_tx_wake_all_queues(bp->dev);
+	/* Tx queue should be only re-enabled, TCs held for DCBX or a PFC
+	 * storm stay stopped
+	 */
+	bnx2x_tx_wake_all_unheld(bp);
 
 #if defined(BNX2X_ESX_CNA) /* ! BNX2X_UPSTREAM */
 	if (bp->flags & CNA_ENABLED &&
@@ -5465,6 +5547,20 @@ static bool bnx2x_get_load_status(struct bnx2x *bp, int engine)
 	return val != 0;
 }
 
+/* True if a function of this path other than bp is loaded */
+static bool bnx2x_path_others_loaded(struct bnx2x *bp)
+{
+	u32 mask = BP_PATH(bp) ? BNX2X_PATH1_LOAD_CNT_MASK :
+			     BNX2X_PATH0_LOAD_CNT_MASK;
+	u32 shift = BP_PATH(bp) ? BNX2X_PATH1_LOAD_CNT_SHIFT :
+			     BNX2X_PATH0_LOAD_CNT_SHIFT;
+	u32 val = REG_RD(bp, BNX2X_RECOVERY_GLOB_REG);
+
+	val = (val & mask) >> shift;
+
+	return (val & ~(1 << bp->pf_num)) != 0;
+}
+
 static void _print_parity(struct bnx2x *bp, u32 reg)
 {
 	pr_cont(" [0x%08x] ", REG_RD(bp, reg));
@@ -5892,47 +5988,272 @@ static bool bnx2x_parity_attn(struct bnx2x *bp, bool *global, bool print,
 	return res;
 }
 
-/**
- * bnx2x_chk_parity_attn - checks for parity attentions.
- *
- * @bp:		driver handle
- * @global:	true if there was a global attention
- * @print:	show parity attention in syslog
- */
-bool bnx2x_chk_parity_attn(struct bnx2x *bp, bool *global, bool print)
+/* Read the after-invert AEU parity signals of this port */
+static void bnx2x_parity_sig(struct bnx2x *bp, u32 *sig)
 {
-	struct attn_route attn = { {0} };
 	int port = BP_PORT(bp);
 
-	attn.sig[0] = REG_RD(bp,
+	sig[0] = REG_RD(bp,
 		MISC_REG_AEU_AFTER_INVERT_1_FUNC_0 +
 			     port*4);
-	attn.sig[1] = REG_RD(bp,
+	sig[1] = REG_RD(bp,
 		MISC_REG_AEU_AFTER_INVERT_2_FUNC_0 +
 			     port*4);
-	attn.sig[2] = REG_RD(bp,
+	sig[2] = REG_RD(bp,
 		MISC_REG_AEU_AFTER_INVERT_3_FUNC_0 +
 			     port*4);
-	attn.sig[3] = REG_RD(bp,
+	sig[3] = REG_RD(bp,
 		MISC_REG_AEU_AFTER_INVERT_4_FUNC_0 +
 			     port*4);
 	/* Since MCP attentions can't be disabled inside the block, we need to
 	 * read AEU registers to see whether they're currently disabled
 	 */
-	attn.sig[3] &= ((REG_RD(bp,
-				!port ? MISC_REG_AEU_ENABLE4_FUNC_0_OUT_0
-				      : MISC_REG_AEU_ENABLE4_FUNC_1_OUT_0) &
-			 MISC_AEU_ENABLE_MCP_PRTY_BITS) |
-			~MISC_AEU_ENABLE_MCP_PRTY_BITS);
+	sig[3] &= ((REG_RD(bp,
+			   !port ? MISC_REG_AEU_ENABLE4_FUNC_0_OUT_0
+				 : MISC_REG_AEU_ENABLE4_FUNC_1_OUT_0) &
+		    MISC_AEU_ENABLE_MCP_PRTY_BITS) |
+		   ~MISC_AEU_ENABLE_MCP_PRTY_BITS);
 
 	if (!CHIP_IS_E1x(bp))
-		attn.sig[4] = REG_RD(bp,
+		sig[4] = REG_RD(bp,
 			MISC_REG_AEU_AFTER_INVERT_5_FUNC_0 +
 				     port*4);
+}
+
+/**
+ * bnx2x_chk_parity_attn - checks for parity attentions.
+ *
+ * @bp:		driver handle
+ * @global:	true if there was a global attention
+ * @print:	show parity attention in syslog
+ */
+bool bnx2x_chk_parity_attn(struct bnx2x *bp, bool *global, bool print)
+{
+	struct attn_route attn = { {0} };
+
+	bnx2x_parity_sig(bp, attn.sig);
 
 	return bnx2x_parity_attn(bp, global, print, attn.sig);
 }
 
+/* Start a parity recovery history record, unless a recovery is already
+ * running.
+ */
+static void bnx2x_par_rec_begin(struct bnx2x *bp, bool scoped, bool global)
+{
+	struct bnx2x_par_rec_event *ev = &bp->par_rec_cur;
+	u32 sig[5] = {0};
+
+	if (bp->recovery_state != BNX2X_RECOVERY_DONE || bp->par_rec_active)
+		return;
+
+	bnx2x_parity_sig(bp, sig);
+
+	memset(ev, 0, sizeof(*ev));
+	ev->jiffies = jiffies;
+	ev->sig[0] = sig[0] & HW_PRTY_ASSERT_SET_0;
+	ev->sig[1] = sig[1] & HW_PRTY_ASSERT_SET_1;
+	ev->sig[2] = sig[2] & HW_PRTY_ASSERT_SET_2;
+	ev->sig[3] = sig[3] & HW_PRTY_ASSERT_SET_3_WITHOUT_SCPAD;
+	ev->sig[4] = sig[4] & HW_PRTY_ASSERT_SET_4;
+	ev->scoped = scoped;
+	ev->global = global;
+	bp->par_rec_start = ktime_get();
+	bp->par_rec_active = true;
+}
+
+static void bnx2x_par_rec_end(struct bnx2x *bp, u8 outcome)
+{
+	static const char * const outcomes[] = {
+		[BNX2X_PAR_REC_OK]		= "completed",
+		[BNX2X_PAR_REC_ESCALATED]	= "escalated",
+		[BNX2X_PAR_REC_FAILED]		= "failed",
+	};
+	struct bnx2x_par_rec_event *ev = &bp->par_rec_cur;
+
+	/* Recoveries not started by a parity attention are not recorded */
+	if (!bp->par_rec_active)
+		return;
+
+	bp->par_rec_active = false;
+	ev->outcome = outcome;
+	ev->duration_us = (u32)ktime_to_us(ktime_sub(ktime_get(),
+						     bp->par_rec_start));
+	bp->par_rec_hist[bp->par_rec_cnt++ % BNX2X_PAR_REC_HIST] = *ev;
+
+	netdev_info(bp->dev, "%s parity recovery %s after %u usec\n",
+		    ev->scoped ? "Scoped" : "Full", outcomes[outcome],
+		    ev->duration_us);
+}
+
+/* Parity sources which are recovered by a plain unload and load of the
+ * function that saw the attention, without the "process kill". These blocks
+ * keep nothing but the configuration written by the init flow, so the common
+ * reset and init done by the reload of the last function on the path is
+ * enough. There is no per-block re-init: with other functions of the path
+ * loaded the common blocks are not reset, so that case escalates. Any other
+ * parity source, or a block which fires again within
+ * BNX2X_PAR_SCOPED_HOLDOFF, goes through the "process kill" flow which
+ * resets the whole path.
+ */
+static const struct {
+	u8	sig_idx;
+	u32	bit;
+	u32	block;
+	u32	mask_addr;
+	u32	sts_clr_addr;
+	bool	l2_only;	/* holds CNIC state of other functions */
+} bnx2x_par_scoped_blocks[] = {
+	{ 0, AEU_INPUTS_ATTN_BITS_PARSER_PARITY_ERROR, BLOCK_PRS,
+	  PRS_REG_PRS_PRTY_MASK, PRS_REG_PRS_PRTY_STS_CLR, false },
+	{ 0, AEU_INPUTS_ATTN_BITS_SEARCHER_PARITY_ERROR, BLOCK_SRC,
+	  SRC_REG_SRC_PRTY_MASK, SRC_REG_SRC_PRTY_STS_CLR, true },
+};
+
+#define BNX2X_PAR_SCOPED_HOLDOFF	(10 * HZ)
+
+static void bnx2x_par_scoped_mask(struct bnx2x *bp, u32 mask_addr,
+				  bool enable)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(bnx2x_blocks_parity_data); i++) {
+		u32 reg_mask;
+
+		if (bnx2x_blocks_parity_data[i].mask_addr != mask_addr)
+			continue;
+
+		reg_mask = bnx2x_parity_reg_mask(bp, i);
+		REG_WR(bp, mask_addr, enable ?
+		       bnx2x_blocks_parity_data[i].en_mask & reg_mask :
+		       reg_mask);
+		return;
+	}
+}
+
+/**
+ * bnx2x_par_scoped_start - try to confine a parity attention to its block.
+ *
+ * @bp:		driver handle
+ * @global:	true if there was a global attention
+ *
+ * Returns true if all the asserted parity sources are block-local. Their
+ * parity is then masked and cleared, so the attention is handled as usual,
+ * and the block re-initialization is scheduled on the sp_rtnl task.
+ */
+static bool bnx2x_par_scoped_start(struct bnx2x *bp, bool global)
+{
+#if defined(BNX2X_STOP_ON_ERROR) || defined(__VMKLNX__)
+	return false;
+#else
+	u32 sig[5] = {0}, pending = 0;
+	int i;
+
+	if (!parity_scope || global || bp->state != BNX2X_STATE_OPEN ||
+	    bp->recovery_state != BNX2X_RECOVERY_DONE ||
+	    bp->par_scoped_pending)
+		return false;
+
+	if (bp->par_scoped_last &&
+	    time_before(jiffies,
+			bp->par_scoped_last + BNX2X_PAR_SCOPED_HOLDOFF)) {
+		BNX2X_ERR("Parity attention again within %d sec of a scoped recovery\n",
+			  BNX2X_PAR_SCOPED_HOLDOFF / HZ);
+		return false;
+	}
+
+	bnx2x_parity_sig(bp, sig);
+	sig[0] &= HW_PRTY_ASSERT_SET_0;
+	sig[1] &= HW_PRTY_ASSERT_SET_1;
+	sig[2] &= HW_PRTY_ASSERT_SET_2;
+	sig[3] &= HW_PRTY_ASSERT_SET_3_WITHOUT_SCPAD;
+	sig[4] &= HW_PRTY_ASSERT_SET_4;
+
+	for (i = 0; i < ARRAY_SIZE(bnx2x_par_scoped_blocks); i++) {
+		u8 idx = bnx2x_par_scoped_blocks[i].sig_idx;
+		u32 bit = bnx2x_par_scoped_blocks[i].bit;
+
+		if (!(sig[idx] & bit))
+			continue;
+
+		if (bnx2x_par_scoped_blocks[i].l2_only && CNIC_SUPPORT(bp))
+			return false;
+
+		sig[idx] &= ~bit;
+		pending |= 1 << i;
+	}
+
+	if (sig[0] || sig[1] || sig[2] || sig[3] || sig[4])
+		return false;
+
+	/* Another function of the path has already taken the block */
+	if (!pending) {
+		DP(NETIF_MSG_HW, "Parity attention already cleared\n");
+		return true;
+	}
+
+	/* The blocks are common to the path. They may only be re-initialized
+	 * once every function has unloaded, otherwise the parity is left
+	 * asserted for the path-wide recovery the other functions join.
+	 */
+	if (bnx2x_path_others_loaded(bp)) {
+		DP(NETIF_MSG_HW, "Other functions loaded, resetting the path\n");
+		return false;
+	}
+
+	bnx2x_par_rec_begin(bp, true, false);
+
+	for (i = 0; i < ARRAY_SIZE(bnx2x_par_scoped_blocks); i++) {
+		if (!(pending & (1 << i)))
+			continue;
+
+		bnx2x_par_scoped_mask(bp, bnx2x_par_scoped_blocks[i].mask_addr,
+				      false);
+		REG_RD(bp, bnx2x_par_scoped_blocks[i].sts_clr_addr);
+	}
+
+	bp->par_scoped_pending = pending;
+	bp->par_scoped_last = jiffies;
+	bnx2x_schedule_sp_rtnl(bp, BNX2X_SP_RTNL_PARITY_SCOPED, NETIF_MSG_HW);
+
+	return true;
+#endif
+}
+
+/**
+ * bnx2x_par_scoped_cancel - drop a scoped recovery that will not run.
+ *
+ * @bp:		driver handle
+ * @outcome:	outcome recorded in the parity recovery history
+ *
+ * Unmasks the parity of the blocks masked by bnx2x_par_scoped_start(), so
+ * a later attention on them is seen again, and closes the history record.
+ */
+static void bnx2x_par_scoped_cancel(struct bnx2x *bp, u8 outcome)
+{
+	u32 pending = bp->par_scoped_pending;
+	int i;
+
+	clear_bit(BNX2X_SP_RTNL_PARITY_SCOPED, &bp->sp_rtnl_state);
+	if (!pending)
+		return;
+
+	DP(NETIF_MSG_HW, "Scoped parity recovery of blocks 0x%x cancelled\n",
+	   pending);
+
+	for (i = 0; i < ARRAY_SIZE(bnx2x_par_scoped_blocks); i++) {
+		if (!(pending & (1 << i)))
+			continue;
+
+		REG_RD(bp, bnx2x_par_scoped_blocks[i].sts_clr_addr);
+		bnx2x_par_scoped_mask(bp, bnx2x_par_scoped_blocks[i].mask_addr,
+				      true);
+	}
+
+	bp->par_scoped_pending = 0;
+	bnx2x_par_rec_end(bp, outcome);
+}
+
 static void bnx2x_attn_int_deasserted4(struct bnx2x *bp, u32 attn)
 {
 	u32 val;
@@ -6000,13 +6321,15 @@ static void bnx2x_attn_int_deasserted(struct bnx2x *bp, u32 deasserted)
 	   try to handle this event */
 	bnx2x_acquire_alr(bp);
 
-	if (bnx2x_chk_parity_attn(bp, &global, true)) {
+	if (bnx2x_chk_parity_attn(bp, &global, true) &&
+	    !bnx2x_par_scoped_start(bp, global)) {
 #ifndef BNX2X_STOP_ON_ERROR
 		if (bnx2x_esx_parity_error(bp)) {
 			bnx2x_release_alr(bp);
 			return;
 		}
 
+		bnx2x_par_rec_begin(bp, false, global);
 #ifndef __VMKLNX__ /* BNX2X_UPSTREAM */
 		bnx2x_start_recovery(bp);
 #else
@@ -6807,6 +7130,64 @@ static void bnx2x_detect_tx_hang(struct bnx2x *bp)
 		}
 	}
 }
+#else
+/*
+ * Detect Tx rings whose HW consumer has not moved for tx_hang_timeout seconds
+ * while packets are pending. Rings held by DCBX, of a TC paused by PFC, or
+ * stalled while link level pause frames are being received are not tracked.
+ * The queue of a hung ring is reset from bnx2x_sp_rtnl_task().
+ */
+static void bnx2x_detect_tx_hang(struct bnx2x *bp)
+{
+	struct bnx2x_eth_stats *estats = &bp->eth_stats;
+	u64 pause_rx = HILO_U64(estats->pause_frames_received_hi,
+				estats->pause_frames_received_lo);
+	bool paused = pause_rx != bp->txq_reset.pause_rx;
+	bool hung = false;
+	u16 hw_cons;
+	int i;
+	u8 cos;
+
+	bp->txq_reset.pause_rx = pause_rx;
+
+	for_each_eth_queue(bp, i) {
+		struct bnx2x_fastpath *fp = &bp->fp[i];
+
+		for_each_cos_in_tx_queue(fp, cos) {
+			struct bnx2x_fp_txdata *txdata = fp->txdata_ptr[cos];
+
+			hw_cons = le16_to_cpu(*txdata->tx_cons_sb);
+			if (paused || txdata->tx_held ||
+			    bp->pfc_tc_stats[cos].paused_since ||
+			    hw_cons != txdata->hang_wd_cons ||
+			    hw_cons == txdata->tx_pkt_prod) {
+				txdata->hang_wd_cons = hw_cons;
+				txdata->hang_since = 0;
+				continue;
+			}
+
+			if (!txdata->hang_since) {
+				txdata->hang_since = jiffies ? : 1;
+				continue;
+			}
+
+			if (fp->tx_hang_reset ||
+			    time_before(jiffies, txdata->hang_since +
+					tx_hang_timeout * HZ))
+				continue;
+
+			BNX2X_ERR("Tx queue %d.%d hung: hw_cons %d, tx_pkt_cons %d, tx_pkt_prod %d\n",
+				  i, cos, hw_cons, txdata->tx_pkt_cons,
+				  txdata->tx_pkt_prod);
+			bp->txq_reset.hangs++;
+			fp->tx_hang_reset = true;
+			hung = true;
+		}
+	}
+
+	if (hung)
+		bnx2x_schedule_sp_rtnl(bp, BNX2X_SP_RTNL_TX_QUEUE_RESET, 0);
+}
 #endif
 
 #ifdef _HAS_TIMER_SETUP /* BNX2X_UPSTREAM */
@@ -6828,7 +7209,7 @@ static void bnx2x_timer(unsigned long data)
 		struct bnx2x_fastpath *fp = &bp->fp[0];
 
 		for_each_cos_in_tx_queue(fp, cos)
-			bnx2x_tx_int(bp, fp->txdata_ptr[cos]);
+			bnx2x_tx_int(bp, fp->txdata_ptr[cos], 0);
 		bnx2x_rx_int(fp, 1000);
 	}
 #endif
@@ -6874,6 +7255,9 @@ static void bnx2x_timer(unsigned long data)
 #if defined(__VMKLNX__) /* ! BNX2X_UPSTREAM */
 	if (!bp->esx.error_status && bp->esx.tx_to_delay)
 		bnx2x_detect_tx_hang(bp);
+#else
+	if (tx_hang_timeout && IS_PF(bp) && bp->state == BNX2X_STATE_OPEN)
+		bnx2x_detect_tx_hang(bp);
 #endif
 
 	mod_timer(&bp->timer, jiffies + bp->current_interval);
@@ -7536,6 +7920,12 @@ _UP_STATIC void bnx2x_init_tx_ring_one(struct bnx2x_fp_txdata *txdata)
 	txdata->tx_bd_prod = 0;
 	txdata->tx_bd_cons = 0;
 	txdata->tx_pkt = 0;
+	txdata->tx_held = 0;
+	txdata->pfc_wd_cons = 0;
+	txdata->hang_wd_cons = 0;
+	txdata->hang_since = 0;
+	txdata->tx_bounce_prod = 0;
+	txdata->tx_bounce_cons = 0;
 #if defined(__VMKLNX__) /* ! BNX2X_UPSTREAM */
 	txdata->prev_tx_pkt_cons = 0;
 	txdata->queue_stuck = 0;
@@ -7558,6 +7948,12 @@ static void bnx2x_init_tx_rings(struct bnx2x *bp)
 	for_each_eth_queue(bp, i)
 		for_each_cos_in_tx_queue(&bp->fp[i], cos)
 			bnx2x_init_tx_ring_one(bp->fp[i].txdata_ptr[cos]);
+
+	/* The rings start empty: no TC is paused or held */
+	for (cos = 0; cos < DCBX_COS_MAX_NUM; cos++) {
+		bp->pfc_tc_stats[cos].paused_since = 0;
+		bp->pfc_tc_stats[cos].storm = false;
+	}
 }
 
 static void bnx2x_init_fcoe_fp(struct bnx2x *bp)
@@ -11273,6 +11669,200 @@ exit_leader_reset:
 	return rc;
 }
 
+/**
+ * bnx2x_par_scoped_recover - recover from a block-local parity error.
+ *
+ * @bp:		driver handle
+ *
+ * This is a reload of the single function loaded on the path, not a
+ * re-init of the affected block alone: the unload resets all common blocks,
+ * including the ones flagged by bnx2x_par_scoped_start(), and the load
+ * initializes them from scratch. The path is not process-killed.
+ * Falls back to the full recovery flow if another function has loaded in
+ * the meantime, or if the parity is still asserted after the reload.
+ *
+ * Runs under rtnl lock from bnx2x_sp_rtnl_task().
+ */
+static void bnx2x_par_scoped_recover(struct bnx2x *bp)
+{
+	u32 pending = bp->par_scoped_pending;
+	bool global = false, is_parity;
+	int i;
+
+	if (!pending)
+		return;
+
+	DP(NETIF_MSG_HW, "Scoped parity recovery of blocks 0x%x\n", pending);
+
+	bp->par_scoped_pending = 0;
+	bnx2x_nic_unload(bp, UNLOAD_NORMAL, true);
+
+	for (i = 0; i < ARRAY_SIZE(bnx2x_par_scoped_blocks); i++) {
+		if (!(pending & (1 << i)))
+			continue;
+
+		REG_RD(bp, bnx2x_par_scoped_blocks[i].sts_clr_addr);
+		bnx2x_par_scoped_mask(bp, bnx2x_par_scoped_blocks[i].mask_addr,
+				      true);
+	}
+
+	/* Another function loaded after the attention, so the unload did
+	 * not reset the common blocks. Re-initializing them now would do so
+	 * under that function's traffic.
+	 */
+	if (bnx2x_get_load_status(bp, BP_PATH(bp))) {
+		BNX2X_ERR("Other functions loaded during scoped parity recovery\n");
+		is_parity = true;
+	} else {
+		is_parity = bnx2x_chk_parity_attn(bp, &global, false);
+	}
+
+	if (bnx2x_nic_load(bp, LOAD_NORMAL)) {
+		netdev_err(bp->dev,
+			   "Failed to load after a scoped parity recovery\n");
+		bnx2x_par_rec_end(bp, BNX2X_PAR_REC_FAILED);
+		return;
+	}
+
+	if (!is_parity) {
+		bnx2x_par_rec_end(bp, BNX2X_PAR_REC_OK);
+		return;
+	}
+
+	BNX2X_ERR("Scoped parity recovery not possible, resetting the path\n");
+	bnx2x_par_rec_end(bp, BNX2X_PAR_REC_ESCALATED);
+#ifndef __VMKLNX__ /* BNX2X_UPSTREAM */
+	bnx2x_par_rec_begin(bp, false, global);
+	bnx2x_start_recovery(bp);
+#endif
+}
+
+#if !defined(__VMKLNX__) /* BNX2X_UPSTREAM */
+/**
+ * bnx2x_reset_eth_queue - recycle a single RSS queue.
+ *
+ * @bp:		driver handle
+ * @index:	queue index, never the leading queue
+ *
+ * Closes the queue connections through the queue state machine, frees what
+ * is still posted on its rings and sets it up again. The other queues, the
+ * classification and the RSS configuration are left alone; frames steered
+ * to the queue meanwhile are dropped by the FW.
+ */
+static int bnx2x_reset_eth_queue(struct bnx2x *bp, int index)
+{
+	struct bnx2x_fastpath *fp = &bp->fp[index];
+	struct bnx2x_fp_stats *fp_stats = bnx2x_fp_stats(bp, fp);
+	u8 held[BNX2X_MULTI_TX_COS];
+	ktime_t start = ktime_get();
+	struct netdev_queue *txq;
+	u32 us;
+	int rc;
+	u8 cos;
+
+	netdev_warn(bp->dev, "Resetting hung Tx queue %d\n", index);
+
+	for_each_cos_in_tx_queue(fp, cos) {
+		txq = netdev_get_tx_queue(bp->dev,
+					  fp->txdata_ptr[cos]->txq_index);
+		__netif_tx_lock_bh(txq);
+		netif_tx_stop_queue(txq);
+		__netif_tx_unlock_bh(txq);
+	}
+#ifdef BNX2X_NEW_NAPI /* BNX2X_UPSTREAM */
+	napi_disable(&bnx2x_fp(bp, index, napi));
+#else
+	netif_poll_disable(&bnx2x_fp(bp, index, dummy_netdev));
+#endif
+	/* The FW zeroes the queue statistics on SETUP; collect the last ones
+	 * before, and restart the deltas from zero after.
+	 */
+	bnx2x_stats_handle(bp, STATS_EVENT_STOP, true);
+
+	for_each_cos_in_tx_queue(fp, cos)
+		held[cos] = fp->txdata_ptr[cos]->tx_held;
+
+	rc = bnx2x_stop_queue(bp, index);
+	if (!rc)
+		rc = bnx2x_reinit_queue_rings(fp);
+	if (!rc)
+		rc = bnx2x_setup_queue(bp, fp, false);
+
+	memset(&fp_stats->old_tclient, 0, sizeof(fp_stats->old_tclient));
+	memset(&fp_stats->old_uclient, 0, sizeof(fp_stats->old_uclient));
+	memset(&fp_stats->old_xclient, 0, sizeof(fp_stats->old_xclient));
+
+#ifdef BNX2X_NEW_NAPI /* BNX2X_UPSTREAM */
+	napi_enable(&bnx2x_fp(bp, index, napi));
+#else
+	netif_poll_enable(&bnx2x_fp(bp, index, dummy_netdev));
+#endif
+	if (rc) {
+		BNX2X_ERR("Failed to reset queue %d, rc %d\n", index, rc);
+		return rc;
+	}
+
+	if (bp->link_vars.link_up)
+		bnx2x_stats_handle(bp, STATS_EVENT_LINK_UP, true);
+
+	for_each_cos_in_tx_queue(fp, cos) {
+		struct bnx2x_fp_txdata *txdata = fp->txdata_ptr[cos];
+
+		txdata->tx_held = held[cos];
+		if (!held[cos])
+			netif_tx_wake_queue(netdev_get_tx_queue(bp->dev,
+						txdata->txq_index));
+	}
+
+	us = (u32)ktime_to_us(ktime_sub(ktime_get(), start));
+	bp->txq_reset.resets++;
+	bp->txq_reset.last_us = us;
+	bp->txq_reset.max_us = max_t(u32, bp->txq_reset.max_us, us);
+	bp->txq_reset.last_queue = index;
+	bp->txq_reset.last = jiffies;
+
+	DP(NETIF_MSG_IFUP, "Queue %d reset in %u us\n", index, us);
+	return 0;
+}
+
+/**
+ * bnx2x_tx_hang_recover - reset the queues with a hung Tx ring.
+ *
+ * @bp:		driver handle
+ *
+ * Resets every queue flagged by bnx2x_detect_tx_hang() or bnx2x_tx_timeout().
+ * The leading queue carries the function classification and can't be
+ * recycled on its own; it, and a queue which fails to come back, fall back
+ * to the Tx timeout reload of the whole function.
+ *
+ * Runs under rtnl lock from bnx2x_sp_rtnl_task().
+ */
+static void bnx2x_tx_hang_recover(struct bnx2x *bp)
+{
+	bool reload = false;
+	int i;
+
+	for_each_eth_queue(bp, i) {
+		struct bnx2x_fastpath *fp = &bp->fp[i];
+
+		if (!fp->tx_hang_reset)
+			continue;
+		fp->tx_hang_reset = false;
+
+		if (reload || bp->state != BNX2X_STATE_OPEN)
+			continue;
+
+		if (!i || bnx2x_reset_eth_queue(bp, i)) {
+			bp->txq_reset.escalated++;
+			reload = true;
+		}
+	}
+
+	if (reload)
+		set_bit(BNX2X_SP_RTNL_TX_TIMEOUT, &bp->sp_rtnl_state);
+}
+#endif
+
 static void bnx2x_recovery_failed(struct bnx2x *bp)
 {
 	netdev_err(bp->dev, "Recovery has failed. Power cycle is needed.\n");
@@ -11296,6 +11886,7 @@ static void bnx2x_recovery_failed(struct bnx2x *bp)
 	bnx2x_set_power_state(bp, PCI_D3hot);
 
 	bp->recovery_state = BNX2X_RECOVERY_FAILED;
+	bnx2x_par_rec_end(bp, BNX2X_PAR_REC_FAILED);
 
 	smp_mb();
 }
@@ -11453,6 +12044,8 @@ _UP_STATIC void bnx2x_parity_recover(struct bnx2x *bp)
 						/* Shut down the power */
 						bnx2x_set_power_state(
 							bp, PCI_D3hot);
+						bnx2x_par_rec_end(bp,
+							BNX2X_PAR_REC_FAILED);
 						smp_mb();
 					} else {
 						bp->recovery_state =
@@ -11464,6 +12057,8 @@ _UP_STATIC void bnx2x_parity_recover(struct bnx2x *bp)
 #else
 						BNX2X_STOP_RECOVERY(bp);
 #endif
+						bnx2x_par_rec_end(bp,
+							BNX2X_PAR_REC_OK);
 						error_recovered++;
 						smp_mb();
 					}
@@ -11694,6 +12289,7 @@ static void bnx2x_sp_rtnl_task(void *data)
 	rtnl_lock();
 
 	if (!netif_running(bp->dev)) {
+		bnx2x_par_scoped_cancel(bp, BNX2X_PAR_REC_FAILED);
 		rtnl_unlock();
 		return;
 	}
@@ -11710,6 +12306,7 @@ static void bnx2x_sp_rtnl_task(void *data)
 		 * Clear all pending SP commands as we are going to reset the
 		 * function anyway.
 		 */
+		bnx2x_par_scoped_cancel(bp, BNX2X_PAR_REC_ESCALATED);
 		bp->sp_rtnl_state = 0;
 		smp_mb();
 
@@ -11721,6 +12318,9 @@ static void bnx2x_sp_rtnl_task(void *data)
 		return;
 	}
 
+	if (test_and_clear_bit(BNX2X_SP_RTNL_PARITY_SCOPED, &bp->sp_rtnl_state))
+		bnx2x_par_scoped_recover(bp);
+
 	if (test_and_clear_bit(BNX2X_SP_RTNL_OEM_EVENT, &bp->sp_rtnl_state)) {
 		if (CHIP_IS_E3(bp) && IS_MF(bp)) {
 			bool mf_dis, llh_en;
@@ -11743,6 +12343,11 @@ static void bnx2x_sp_rtnl_task(void *data)
 		}
 	}
 
+#if !defined(__VMKLNX__) /* BNX2X_UPSTREAM */
+	if (test_and_clear_bit(BNX2X_SP_RTNL_TX_QUEUE_RESET, &bp->sp_rtnl_state))
+		bnx2x_tx_hang_recover(bp);
+#endif
+
 	if (test_and_clear_bit(BNX2X_SP_RTNL_TX_TIMEOUT, &bp->sp_rtnl_state)) {
 		ESX_CHK_VF_COUNT_RTNL(bp, "Tx timeout");
 #ifndef BNX2X_UPSTREAM /* ! BNX2X_UPSTREAM */
@@ -11839,10 +12444,21 @@ sp_rtnl_not_reset:
 		bnx2x_pf_set_vfs_vlan(bp);
 
 	if (test_and_clear_bit(BNX2X_SP_RTNL_TX_STOP, &bp->sp_rtnl_state)) {
+		ktime_t start = ktime_get();
+
 		bnx2x_dcbx_stop_hw_tx(bp);
 		bnx2x_dcbx_resume_hw_tx(bp);
+
+		/* The whole function was stopped */
+		bnx2x_dcbx_account_pause(bp,
+			(1UL << bp->dcbx_port_params.ets.num_of_cos) - 1,
+			start);
 	}
 
+	if (test_and_clear_bit(BNX2X_SP_RTNL_DCBX_TC_UPDATE,
+			       &bp->sp_rtnl_state))
+		bnx2x_dcbx_update_tcs(bp);
+
 	if (test_and_clear_bit(BNX2X_SP_RTNL_GET_DRV_VERSION,
 			       &bp->sp_rtnl_state))
 		bnx2x_update_mng_version(bp);
@@ -11895,6 +12511,134 @@ sp_rtnl_not_reset:
 #endif
 }
 
+/* The SFP module EEPROM is sampled every sfp_dom_interval seconds by the
+ * PMF period task. A0 and the A2 thresholds are read once per module; later
+ * samples refresh the A2 diagnostics window and compare the A0 serial number
+ * to detect a module swap. Called under the PHY lock.
+ */
+static void bnx2x_sfp_sample(struct bnx2x *bp)
+{
+	struct bnx2x_sfp_cache *sc = &bp->sfp_cache;
+	struct bnx2x_phy *phy = &bp->link_params.phy[bnx2x_get_cur_phy_idx(bp)];
+	struct link_params *params = &bp->link_params;
+	bool full = !sc->a0_valid;
+	u8 a2_valid = sc->a2_valid;
+	int rc;
+
+	if (!full) {
+		rc = bnx2x_read_sfp_module_eeprom(phy, params, I2C_DEV_ADDR_A0,
+						  SFP_EEPROM_SERIAL_ADDR,
+						  SFP_EEPROM_SERIAL_SIZE,
+						  sc->buf);
+		if (rc)
+			goto err;
+		full = memcmp(sc->buf, sc->a0 + SFP_EEPROM_SERIAL_ADDR,
+			      SFP_EEPROM_SERIAL_SIZE) != 0;
+	}
+
+	if (full) {
+		rc = bnx2x_read_sfp_module_eeprom(phy, params, I2C_DEV_ADDR_A0,
+						  0, BNX2X_SFP_PAGE_LEN,
+						  sc->buf);
+		if (rc)
+			goto err;
+
+		spin_lock_bh(&sc->lock);
+		memcpy(sc->a0, sc->buf, BNX2X_SFP_PAGE_LEN);
+		sc->a0_valid = 1;
+		sc->a2_valid = 0;
+		spin_unlock_bh(&sc->lock);
+
+		/* Same conditions as bnx2x_get_module_info() */
+		a2_valid = sc->a0[SFP_EEPROM_SFF_8472_COMP_ADDR] &&
+			   !(sc->a0[SFP_EEPROM_DIAG_TYPE_ADDR] &
+			     SFP_EEPROM_DIAG_ADDR_CHANGE_REQ);
+		if (a2_valid) {
+			rc = bnx2x_read_sfp_module_eeprom(phy, params,
+							  I2C_DEV_ADDR_A2, 0,
+							  BNX2X_SFP_PAGE_LEN,
+							  sc->buf);
+			if (rc)
+				goto err;
+		}
+
+		spin_lock_bh(&sc->lock);
+		if (a2_valid)
+			memcpy(sc->a2, sc->buf, BNX2X_SFP_PAGE_LEN);
+		sc->a2_valid = a2_valid;
+		sc->jiffies = jiffies;
+		spin_unlock_bh(&sc->lock);
+	} else {
+		if (a2_valid) {
+			rc = bnx2x_read_sfp_module_eeprom(phy, params,
+							  I2C_DEV_ADDR_A2,
+							  SFP_EEPROM_A2_DYN_ADDR,
+							  SFP_EEPROM_A2_DYN_SIZE,
+							  sc->buf);
+			if (rc)
+				goto err;
+		}
+
+		spin_lock_bh(&sc->lock);
+		if (a2_valid)
+			memcpy(sc->a2 + SFP_EEPROM_A2_DYN_ADDR, sc->buf,
+			       SFP_EEPROM_A2_DYN_SIZE);
+		sc->jiffies = jiffies;
+		spin_unlock_bh(&sc->lock);
+	}
+
+	sc->samples++;
+	DP(NETIF_MSG_LINK, "SFP sample %u (%s)\n", sc->samples,
+	   full ? "full" : "diagnostics");
+	return;
+
+err:
+	spin_lock_bh(&sc->lock);
+	sc->a0_valid = 0;
+	sc->a2_valid = 0;
+	spin_unlock_bh(&sc->lock);
+	sc->errors++;
+	DP(NETIF_MSG_LINK, "SFP sample failed (%d)\n", rc);
+}
+
+/**
+ * bnx2x_sfp_cache_read - read the SFP module EEPROM from the cache.
+ *
+ * @bp:		driver handle
+ * @dev_addr:	I2C_DEV_ADDR_A0 or I2C_DEV_ADDR_A2
+ * @addr:	offset in the page
+ * @len:	number of bytes
+ * @data:	output buffer
+ *
+ * Returns true if the data was copied; the caller then skips the module
+ * access. Data older than two sampling periods is not used.
+ */
+bool bnx2x_sfp_cache_read(struct bnx2x *bp, u8 dev_addr, u16 addr,
+			  u16 len, u8 *data)
+{
+	struct bnx2x_sfp_cache *sc = &bp->sfp_cache;
+	bool hit = false;
+	u8 valid;
+
+	if (!sfp_dom_interval || addr + len > BNX2X_SFP_PAGE_LEN)
+		return false;
+
+	spin_lock_bh(&sc->lock);
+	valid = (dev_addr == I2C_DEV_ADDR_A0) ? sc->a0_valid : sc->a2_valid;
+	if (valid && time_before(jiffies, sc->jiffies +
+					  2 * sfp_dom_interval * HZ)) {
+		memcpy(data, ((dev_addr == I2C_DEV_ADDR_A0) ? sc->a0 :
+			      sc->a2) + addr, len);
+		hit = true;
+		sc->hits++;
+	} else {
+		sc->misses++;
+	}
+	spin_unlock_bh(&sc->lock);
+
+	return hit;
+}
+
 #if defined(INIT_DELAYED_WORK_DEFERRABLE) || defined(INIT_DEFERRABLE_WORK) || defined(INIT_WORK_NAR) || (defined(__VMKLNX__) && (VMWARE_ESX_DDK_VERSION >= 40000)) /* BNX2X_UPSTREAM */
 static void bnx2x_period_task(struct work_struct *work)
 {
@@ -11927,11 +12671,20 @@ static void bnx2x_period_task(void *data)
 	if (bp->port.pmf) {
 		bnx2x_period_func(&bp->link_params, &bp->link_vars);
 
+		if (sfp_dom_interval && (!bp->sfp_cache.next ||
+		    time_after_eq(jiffies, bp->sfp_cache.next))) {
+			bnx2x_sfp_sample(bp);
+			bp->sfp_cache.next = jiffies + sfp_dom_interval * HZ;
+		}
+
 		/* Re-queue task in 1 sec */
 		queue_delayed_work(bnx2x_wq, &bp->period_task, 1*HZ);
 	}
 
 	bnx2x_release_phy_lock(bp);
+
+	if (bp->port.pmf && bp->state == BNX2X_STATE_OPEN)
+		bnx2x_pfc_watchdog(bp);
 period_task_exit:
 	return;
 }
@@ -14184,9 +14937,13 @@ static int __devinit bnx2x_init_bp(struct bnx2x *bp)
 	mutex_init(&bp->port.phy_mutex);
 	mutex_init(&bp->fw_mb_mutex);
 	mutex_init(&bp->drv_info_mutex);
+	spin_lock_init(&bp->sfp_cache.lock);
 	sema_init(&bp->stats_lock, 1);
 	bp->drv_info_mng_owner = false;
 	INIT_LIST_HEAD(&bp->vlan_reg);
+#ifdef BCM_PTP /* BNX2X_UPSTREAM */
+	seqlock_init(&bp->phc_lock);
+#endif
 
 #ifdef __VMKLNX__ /* ! BNX2X_UPSTREAM */
 	mutex_init(&bp->esx.netq_lock);
@@ -14552,6 +15309,8 @@ int bnx2x_close(struct net_device *dev)
 	if ((bp->flags & CNA_ENABLED) && netif_running(bp->cnadev))
 		dev_close(bp->cnadev);
 #endif
+	bnx2x_par_scoped_cancel(bp, BNX2X_PAR_REC_FAILED);
+
 	/* Unload the driver, release IRQs */
 	return bnx2x_nic_unload(bp, UNLOAD_CLOSE, false);
 }
@@ -16146,6 +16905,16 @@ static int bnx2x_ptp_adjfreq(struct ptp_clock_info *ptp, s32 ppb)
 		return -EFAULT;
 	}
 
+	/* The PHC rate has changed by the difference between the old and the
+	 * new correction; carry the measured rate over and restart sampling.
+	 */
+	write_seqlock_bh(&bp->phc_lock);
+	ppb = drift_dir ? ppb : -ppb;
+	bp->phc_snap.rate_ppb += ppb - bp->phc_snap.adj_ppb;
+	bp->phc_snap.adj_ppb = ppb;
+	bp->phc_snap.valid = false;
+	write_sequnlock_bh(&bp->phc_lock);
+
 	DP(BNX2X_MSG_PTP, "Configured val = %d, period = %d\n", best_val,
 	   best_period);
 
@@ -16163,6 +16932,7 @@ static int bnx2x_ptp_adjtime(struct ptp_clock_info *ptp, s64 delta)
 	}
 
 	DP(BNX2X_MSG_PTP, "PTP adjtime called, delta = %llx\n", delta);
+	write_seqlock_bh(&bp->phc_lock);
 #ifdef _HAS_TIMECOUNTER_ADJTIME /* BNX2X_UPSTREAM */
 	timecounter_adjtime(&bp->timecounter, delta);
 #else
@@ -16174,10 +16944,96 @@ static int bnx2x_ptp_adjtime(struct ptp_clock_info *ptp, s64 delta)
 	timecounter_init(&bp->timecounter, &bp->cyclecounter, now);
 	}
 #endif
+	bp->phc_snap.valid = false;
+	write_sequnlock_bh(&bp->phc_lock);
 
 	return 0;
 }
 
+/* Read the PHC through the timecounter and refresh the snapshot used by the
+ * lock-free read path. Called with phc_lock held for writing.
+ */
+static u64 bnx2x_phc_sample(struct bnx2x *bp)
+{
+	struct bnx2x_phc_snap *snap = &bp->phc_snap;
+	u64 ns, pre, post;
+	s64 dphc, dsys;
+
+	pre = ktime_to_ns(ktime_get());
+	ns = timecounter_read(&bp->timecounter);
+	post = ktime_to_ns(ktime_get());
+
+	snap->phc_ns = ns;
+	snap->sys_ns = pre + ((post - pre) >> 1);
+
+	if (!snap->valid) {
+		snap->anchor_phc_ns = snap->phc_ns;
+		snap->anchor_sys_ns = snap->sys_ns;
+		snap->valid = true;
+		return ns;
+	}
+
+	/* Measure the PHC rate over a window long enough for the register
+	 * access latency to be negligible. Windows which are much longer than
+	 * that only restart the measurement.
+	 */
+	dsys = snap->sys_ns - snap->anchor_sys_ns;
+	if (dsys < BNX2X_PHC_RATE_WINDOW_NS)
+		return ns;
+
+	if (dsys <= 8 * BNX2X_PHC_RATE_WINDOW_NS) {
+		dphc = snap->phc_ns - snap->anchor_phc_ns;
+		snap->rate_ppb = div64_s64((dphc - dsys) * NSEC_PER_SEC, dsys);
+		snap->rate_ppb = clamp_t(s64, snap->rate_ppb,
+					 -BNX2X_MAX_PHC_DRIFT,
+					 BNX2X_MAX_PHC_DRIFT);
+	}
+
+	snap->anchor_phc_ns = snap->phc_ns;
+	snap->anchor_sys_ns = snap->sys_ns;
+
+	return ns;
+}
+
+/* Lock-free PHC read. Extrapolates the last hardware sample if it is recent
+ * enough; returns false if the caller has to read the hardware.
+ */
+static bool bnx2x_phc_extrapolate(struct bnx2x *bp, u64 *ns)
+{
+	const struct bnx2x_phc_snap *snap = &bp->phc_snap;
+	s64 age, max_age;
+	unsigned int seq;
+	bool valid;
+
+	max_age = (s64)min_t(uint, READ_ONCE(phc_extrapolate_us),
+			     BNX2X_PHC_MAX_EXTRAPOLATE_US) * NSEC_PER_USEC;
+
+	do {
+		seq = read_seqbegin(&bp->phc_lock);
+		age = ktime_to_ns(ktime_get()) - snap->sys_ns;
+		valid = snap->valid && age >= 0 && age <= max_age;
+		if (valid)
+			*ns = snap->phc_ns + age +
+			      div_s64(age * snap->rate_ppb, NSEC_PER_SEC);
+	} while (read_seqretry(&bp->phc_lock, seq));
+
+	return valid;
+}
+
+static u64 bnx2x_phc_read(struct bnx2x *bp)
+{
+	u64 ns;
+
+	if (bnx2x_phc_extrapolate(bp, &ns))
+		return ns;
+
+	write_seqlock_bh(&bp->phc_lock);
+	ns = bnx2x_phc_sample(bp);
+	write_sequnlock_bh(&bp->phc_lock);
+
+	return ns;
+}
+
 #ifdef _HAS_TIMESPEC64 /* BNX2X_UPSTREAM */
 static int bnx2x_ptp_gettime(struct ptp_clock_info *ptp, struct timespec64 *ts)
 #else
@@ -16193,7 +17049,7 @@ static int bnx2x_ptp_gettime(struct ptp_clock_info *ptp, struct timespec *ts)
 		return -ENETDOWN;
 	}
 
-	ns = timecounter_read(&bp->timecounter);
+	ns = bnx2x_phc_read(bp);
 
 	DP(BNX2X_MSG_PTP, "PTP gettime called, ns = %llu\n", ns);
 
@@ -16210,6 +17066,37 @@ static int bnx2x_ptp_gettime(struct ptp_clock_info *ptp, struct timespec *ts)
 	return 0;
 }
 
+#ifdef _HAS_PTP_GETTIMEX64 /* BNX2X_UPSTREAM */
+/* PTP_SYS_OFFSET_EXTENDED: always read the HW, with the system timestamps
+ * taken immediately around the PHC register access.
+ */
+static int bnx2x_ptp_gettimex(struct ptp_clock_info *ptp,
+			      struct timespec64 *ts,
+			      struct ptp_system_timestamp *sts)
+{
+	struct bnx2x *bp = container_of(ptp, struct bnx2x, ptp_clock_info);
+	u64 ns;
+
+	if (!netif_running(bp->dev)) {
+		DP(BNX2X_MSG_PTP,
+		   "PTP gettimex called while the interface is down\n");
+		return -ENETDOWN;
+	}
+
+	write_seqlock_bh(&bp->phc_lock);
+	bp->phc_sts = sts;
+	ns = bnx2x_phc_sample(bp);
+	bp->phc_sts = NULL;
+	write_sequnlock_bh(&bp->phc_lock);
+
+	DP(BNX2X_MSG_PTP, "PTP gettimex called, ns = %llu\n", ns);
+
+	*ts = ns_to_timespec64(ns);
+
+	return 0;
+}
+#endif
+
 #ifdef _HAS_TIMESPEC64 /* BNX2X_UPSTREAM */
 static int bnx2x_ptp_settime(struct ptp_clock_info *ptp,
 			     const struct timespec64 *ts)
@@ -16232,7 +17119,10 @@ static int bnx2x_ptp_settime(struct ptp_clock_info *ptp,
 	DP(BNX2X_MSG_PTP, "PTP settime called, ns = %llu\n", ns);
 
 	/* Re-init the timecounter */
+	write_seqlock_bh(&bp->phc_lock);
 	timecounter_init(&bp->timecounter, &bp->cyclecounter, ns);
+	bp->phc_snap.valid = false;
+	write_sequnlock_bh(&bp->phc_lock);
 
 	return 0;
 }
@@ -16262,6 +17152,9 @@ void bnx2x_register_phc(struct bnx2x *bp)
 #ifdef _HAS_CALLBACK_TIMESPEC64 /* BNX2X_UPSTREAM */
 	bp->ptp_clock_info.gettime64 = bnx2x_ptp_gettime;
 	bp->ptp_clock_info.settime64 = bnx2x_ptp_settime;
+#ifdef _HAS_PTP_GETTIMEX64 /* BNX2X_UPSTREAM */
+	bp->ptp_clock_info.gettimex64 = bnx2x_ptp_gettimex;
+#endif
 #else
 	bp->ptp_clock_info.gettime = bnx2x_ptp_gettime;
 	bp->ptp_clock_info.settime = bnx2x_ptp_settime;
@@ -16279,6 +17172,66 @@ void bnx2x_register_phc(struct bnx2x *bp)
 	}
 }
 
+/* Measure the cost of PHC reads and the error of the extrapolated value
+ * against the HW. Every 64th iteration is compared against a HW sample,
+ * which also refreshes the snapshot the way a periodic poller would.
+ * Returns the average gettime cost in nsec.
+ */
+int bnx2x_ptp_bench(struct bnx2x *bp, u32 iters)
+{
+	u64 t0, t1, cost, ns, hw_ns, sum = 0, cost_max = 0, hw_sum = 0;
+	u64 err_sum = 0, err_max = 0;
+	u32 i, fast = 0, hw_cnt = 0;
+	s64 err;
+
+	if (!bp->ptp_clock || !netif_running(bp->dev))
+		return -ENETDOWN;
+
+	if (!iters)
+		return -EINVAL;
+
+	for (i = 0; i < iters; i++) {
+		t0 = ktime_to_ns(ktime_get());
+		if (bnx2x_phc_extrapolate(bp, &ns)) {
+			fast++;
+		} else {
+			write_seqlock_bh(&bp->phc_lock);
+			ns = bnx2x_phc_sample(bp);
+			write_sequnlock_bh(&bp->phc_lock);
+		}
+		t1 = ktime_to_ns(ktime_get());
+
+		cost = t1 - t0;
+		sum += cost;
+		cost_max = max(cost_max, cost);
+
+		if (i & 63)
+			continue;
+
+		write_seqlock_bh(&bp->phc_lock);
+		hw_ns = bnx2x_phc_sample(bp);
+		err = (s64)(hw_ns - ns) - (s64)(bp->phc_snap.sys_ns - t1);
+		write_sequnlock_bh(&bp->phc_lock);
+		hw_sum += ktime_to_ns(ktime_get()) - t1;
+		hw_cnt++;
+
+		if (err < 0)
+			err = -err;
+		err_sum += err;
+		err_max = max_t(u64, err_max, err);
+
+		cond_resched();
+	}
+
+	netdev_info(bp->dev,
+		    "PHC bench: %u reads (%u extrapolated) avg %llu ns max %llu ns; HW read avg %llu ns; extrapolation error avg %llu ns max %llu ns\n",
+		    iters, fast, div_u64(sum, iters), cost_max,
+		    div_u64(hw_sum, hw_cnt), div_u64(err_sum, hw_cnt),
+		    err_max);
+
+	return div_u64(sum, iters);
+}
+
 #endif
 
 static void __devinit bnx2x_set_netdev_features(struct bnx2x *bp,
@@ -17932,6 +18885,9 @@ static int bnx2x_get_sfp_diagnostic(struct net_device *dev,
 	struct bnx2x *bp = netdev_priv(dev);
 	int phy_idx, rc, cfg_idx;
 	__be16 field;
+	/* temperature, vcc, tx bias, tx power and rx power */
+	u8 dom[SFP_EEPROM_A2_RX_POWER_ADDR + SFP_EEPROM_A2_RX_POWER_SIZE -
+	       SFP_EEPROM_A2_TEMPERATURE_ADDR];
 
 	if (!bnx2x_is_nvm_accessible(bp)) {
 		DP(BNX2X_MSG_NVM,
@@ -17939,12 +18895,23 @@ static int bnx2x_get_sfp_diagnostic(struct net_device *dev,
 		return -EAGAIN;
 	}
 
-	phy_idx = bnx2x_get_cur_phy_idx(bp);
-	bnx2x_acquire_phy_lock(bp);
-
 	/* Data read from SFP is going to be ordered in big-endian
 	 * and we'll need to convert it to host.
 	 */
+	if (bnx2x_sfp_cache_read(bp, I2C_DEV_ADDR_A2,
+				 SFP_EEPROM_A2_TEMPERATURE_ADDR,
+				 sizeof(dom), dom)) {
+		data->temperature = (dom[0] << 8) | dom[1];
+		data->vcc = (dom[2] << 8) | dom[3];
+		data->tx_bias = (dom[4] << 8) | dom[5];
+		data->tx_power = (dom[6] << 8) | dom[7];
+		data->rx_power = (dom[8] << 8) | dom[9];
+		goto dom_done;
+	}
+
+	phy_idx = bnx2x_get_cur_phy_idx(bp);
+	bnx2x_acquire_phy_lock(bp);
+
 	rc = bnx2x_read_sfp_module_eeprom(&bp->link_params.phy[phy_idx],
 					  &bp->link_params,
 					  I2C_DEV_ADDR_A2,
@@ -17996,6 +18963,7 @@ static int bnx2x_get_sfp_diagnostic(struct net_device *dev,
 	data->rx_power = be16_to_cpu(field);
 
 	bnx2x_release_phy_lock(bp);
+dom_done:
 	DP(BNX2X_MSG_NVM,
 	   "Temp: %08x\nVCC: %08x\nTx Bias: %08x\nTx Power: %08x\nRx Power: %08x\n",
 	   data->temperature, data->vcc, data->tx_bias, data->tx_power,
@@ -18915,6 +19883,19 @@ EXPORT_SYMBOL(bnx2x_dbg_write32_ind);
 
 #ifdef BCM_PTP /* BNX2X_UPSTREAM */
 
+static u64 bnx2x_phc_cyc2time(struct bnx2x *bp, u64 cycles)
+{
+	unsigned int seq;
+	u64 ns;
+
+	do {
+		seq = read_seqbegin(&bp->phc_lock);
+		ns = timecounter_cyc2time(&bp->timecounter, cycles);
+	} while (read_seqretry(&bp->phc_lock, seq));
+
+	return ns;
+}
+
 static void bnx2x_ptp_task(struct work_struct *work)
 {
 	struct bnx2x *bp = container_of(work, struct bnx2x, ptp_task);
@@ -18940,7 +19921,7 @@ static void bnx2x_ptp_task(struct work_struct *work)
 		/* Reset timestamp register to allow new timestamp */
 		REG_WR(bp, port ? NIG_REG_P1_TLLH_PTP_BUF_SEQID :
 		       NIG_REG_P0_TLLH_PTP_BUF_SEQID, 0x10000);
-		ns = timecounter_cyc2time(&bp->timecounter, timestamp);
+		ns = bnx2x_phc_cyc2time(bp, timestamp);
 
 		memset(&shhwtstamps, 0, sizeof(shhwtstamps));
 		shhwtstamps.hwtstamp = ns_to_ktime(ns);
@@ -18979,7 +19960,7 @@ void bnx2x_set_rx_ts(struct bnx2x *bp, struct sk_buff *skb)
 	REG_WR(bp, port ? NIG_REG_P1_LLH_PTP_HOST_BUF_SEQID :
 	       NIG_REG_P0_LLH_PTP_HOST_BUF_SEQID, 0x10000);
 
-	ns = timecounter_cyc2time(&bp->timecounter, timestamp);
+	ns = bnx2x_phc_cyc2time(bp, timestamp);
 
 	skb_hwtstamps(skb)->hwtstamp = ns_to_ktime(ns);
 
@@ -18999,8 +19980,14 @@ static cycle_t bnx2x_cyclecounter_read(const struct cyclecounter *cc)
 	u32 wb_data[2];
 	u64 phc_cycles;
 
+#ifdef _HAS_PTP_GETTIMEX64 /* BNX2X_UPSTREAM */
+	ptp_read_system_prets(bp->phc_sts);
+#endif
 	REG_RD_DMAE(bp, port ? NIG_REG_TIMESYNC_GEN_REG + tsgen_synctime_t1 :
 		    NIG_REG_TIMESYNC_GEN_REG + tsgen_synctime_t0, wb_data, 2);
+#ifdef _HAS_PTP_GETTIMEX64 /* BNX2X_UPSTREAM */
+	ptp_read_system_postts(bp->phc_sts);
+#endif
 	phc_cycles = wb_data[1];
 	phc_cycles = (phc_cycles << 32) + wb_data[0];
 
@@ -19265,11 +20252,20 @@ void bnx2x_init_ptp(struct bnx2x *bp)
 	 */
 	if (!bp->timecounter_init_done) {
 		bnx2x_init_cyclecounter(bp);
+		write_seqlock_bh(&bp->phc_lock);
 		timecounter_init(&bp->timecounter, &bp->cyclecounter,
 				 ktime_to_ns(ktime_get_real()));
+		write_sequnlock_bh(&bp->phc_lock);
 		bp->timecounter_init_done = 1;
 	}
 
+	/* The drift register was reset above */
+	write_seqlock_bh(&bp->phc_lock);
+	bp->phc_snap.rate_ppb -= bp->phc_snap.adj_ppb;
+	bp->phc_snap.adj_ppb = 0;
+	bp->phc_snap.valid = false;
+	write_sequnlock_bh(&bp->phc_lock);
+
 	DP(BNX2X_MSG_PTP, "PTP initialization ended successfully\n");
 }
 #endif
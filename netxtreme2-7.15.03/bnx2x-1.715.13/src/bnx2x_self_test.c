@@ -28,13 +28,6 @@
 static int idle_chk_errors;
 static int idle_chk_warnings;
 
-/* masks for all chip types */
-static int is_e1;
-static int is_e1h;
-static int is_e2;
-static int is_e3a0;
-static int is_e3b0;
-
 #define NA 0xCD
 
 #define IDLE_CHK_E1			0x01
@@ -155,19 +148,59 @@ static void bnx2x_self_test_log(struct bnx2x *bp, u8 severity, char *message)
 	}
 }
 
+/* Register values are read in batches: every range a record loops over is
+ * fetched up front (with DMAE when the range is contiguous and long enough)
+ * into bp->idle_chk and the predicate is then evaluated over the batch.
+ */
+#define IDLE_CHK_BULK_MIN		8
+#define IDLE_CHK_CFC_LCIDS		BNX2X_IDLE_CHK_CFC_LCIDS
+#define IDLE_CHK_BATCH_MAX		BNX2X_IDLE_CHK_BATCH_MAX
+
+/* read count registers starting at addr, stride bytes apart */
+static void bnx2x_idle_chk_rd(struct bnx2x *bp, u32 addr, u32 stride,
+			      u32 count, u32 *vals)
+{
+	u32 i, len;
+
+	if (bp->idle_chk.bulk && stride == 4 && count >= IDLE_CHK_BULK_MIN) {
+		for (i = 0; i < count; i += len) {
+			len = min_t(u32, count - i, DMAE_LEN32_RD_MAX);
+			memcpy(vals + i,
+			       bnx2x_read_dmae_bulk(bp, addr + i * 4, len),
+			       len * 4);
+			bp->idle_chk.dmae_reads++;
+		}
+		return;
+	}
+
+	for (i = 0; i < count; i++)
+		vals[i] = REG_RD(bp, addr + i * stride);
+	bp->idle_chk.grc_reads += count;
+}
+
 /*specific test for QM rd/wr pointers and rd/wr banks*/
 static void bnx2x_idle_chk6(struct bnx2x *bp,
 				struct st_record *rec, char *message)
 {
 	int i;
 	u32 rd_ptr, wr_ptr, rd_bank, wr_bank;
-	for (i = 0; i < rec->loop; i++) {
+	u32 *vals = bp->idle_chk.batch;
+
+	if (rec->loop * 2 > IDLE_CHK_BATCH_MAX)
+		return;
+
+	/* each entry is a pair of registers */
+	if (rec->incr == 8) {
+		bnx2x_idle_chk_rd(bp, rec->reg1, 4, rec->loop * 2, vals);
+	} else {
+		for (i = 0; i < rec->loop; i++)
+			bnx2x_idle_chk_rd(bp, rec->reg1 + i * rec->incr, 4, 2,
+					  vals + i * 2);
+	}
 
-		/* read regs */
-		rec->pred_args.val1 =
-			REG_RD(bp, rec->reg1 + i * rec->incr);
-		rec->pred_args.val2 =
-			REG_RD(bp, rec->reg1 + i * rec->incr + 4);
+	for (i = 0; i < rec->loop; i++) {
+		rec->pred_args.val1 = vals[i * 2];
+		rec->pred_args.val2 = vals[i * 2 + 1];
 
 		/* calc read and write pointers */
 		rd_ptr = ((rec->pred_args.val1 & 0x3FFFFFC0) >> 6);
@@ -196,40 +229,69 @@ static void bnx2x_idle_chk6(struct bnx2x *bp,
 	}
 }
 
+/* read the cid cam, the connection types of the cfc info ram and the
+ * activity counters once; all the macro 7 records check the same lcids
+ */
+static void bnx2x_idle_chk_cfc_snapshot(struct bnx2x *bp,
+					struct st_record *rec)
+{
+	struct bnx2x_idle_chk_buf *buf = &bp->idle_chk;
+	u32 *info = buf->batch;
+	int i;
+
+	bnx2x_idle_chk_rd(bp, rec->reg2, 4, rec->loop, buf->cfc_cam);
+	bnx2x_idle_chk_rd(bp, rec->reg3, 4, rec->loop, buf->cfc_ac);
+
+	/* info ram entries are wide-bus, all four dwords must be read */
+	if (rec->incr == 16)
+		bnx2x_idle_chk_rd(bp, rec->reg1, 4, rec->loop * 4, info);
+	else
+		for (i = 0; i < rec->loop; i++)
+			bnx2x_idle_chk_rd(bp, rec->reg1 + i * rec->incr, 4, 4,
+					  info + i * 4);
+
+	for (i = 0; i < rec->loop; i++) {
+		u32 type = info[i * 4 + 2];
+
+		/* obtain connection type */
+		if (CHIP_IS_E1x(bp)) {
+			/* E1 E1H (bits 4..7) */
+			type &= 0x78;
+			type >>= 3;
+		} else {
+			/* E2 E3A0 E3B0 (bits 26..29) */
+			type &= 0x1E000000;
+			type >>= 25;
+		}
+		buf->cfc_type[i] = type;
+	}
+
+	buf->cfc_addr = rec->reg1;
+}
+
 /* specific test for cfc info ram and cid cam*/
 static void bnx2x_idle_chk7(struct bnx2x *bp,
 				struct st_record *rec, char *message)
 {
 	/* declartaions */
+	struct bnx2x_idle_chk_buf *buf = &bp->idle_chk;
 	int i;
 
+	if (rec->loop > IDLE_CHK_CFC_LCIDS)
+		return;
+
+	if (buf->cfc_addr != rec->reg1)
+		bnx2x_idle_chk_cfc_snapshot(bp, rec);
+
 	/* iterate through lcids */
 	for (i = 0; i < rec->loop; i++) {
 
 		/* make sure cam entry is valid (bit 0) */
-		if ((REG_RD(bp, (rec->reg2 + i*4)) & 0x1) != 0x1)
+		if ((buf->cfc_cam[i] & 0x1) != 0x1)
 			continue;
 
-		/* get connection type (multiple reads due to widebus) */
-		REG_RD(bp, (rec->reg1 + i * rec->incr));
-		REG_RD(bp, (rec->reg1 + i * rec->incr + 4));
-		rec->pred_args.val1 =
-			REG_RD(bp, (rec->reg1 + i * rec->incr + 8));
-		REG_RD(bp, (rec->reg1 + i * rec->incr + 12));
-
-		/* obtain connection type */
-		if (is_e1 || is_e1h) {
-			/* E1 E1H (bits 4..7) */
-			rec->pred_args.val1 &= 0x78;
-			rec->pred_args.val1 >>= 3;
-		} else {
-			/* E2 E3A0 E3B0 (bits 26..29) */
-			rec->pred_args.val1 &= 0x1E000000;
-			rec->pred_args.val1 >>= 25;
-		}
-
-		/* get activity counter value */
-		rec->pred_args.val2 = REG_RD(bp, rec->reg3 + i * 4);
+		rec->pred_args.val1 = buf->cfc_type[i];
+		rec->pred_args.val2 = buf->cfc_ac[i];
 
 		/* validate ac value is legal for con_type at idle state */
 		if (rec->predicate(&rec->pred_args)) {
@@ -3088,50 +3150,113 @@ static struct st_record st_database[ST_DB_LINES] = {
 
 };
 
+/* Database lines applying to each chip revision, built on first use and
+ * shared by all the adapters. The build is serialized by st_db_lock and
+ * st_db_built[] is only set once the lines are in place.
+ */
+enum {
+	IDLE_CHK_REV_E1,
+	IDLE_CHK_REV_E1H,
+	IDLE_CHK_REV_E2,
+	IDLE_CHK_REV_E3A0,
+	IDLE_CHK_REV_E3B0,
+	IDLE_CHK_REVS
+};
+
+static u16 st_db_lines[IDLE_CHK_REVS][ST_DB_LINES];
+static u16 st_db_nlines[IDLE_CHK_REVS];
+static bool st_db_built[IDLE_CHK_REVS];
+static DEFINE_SPINLOCK(st_db_lock);
+
+static int bnx2x_idle_chk_rev(struct bnx2x *bp)
+{
+	if (CHIP_IS_E1(bp))
+		return IDLE_CHK_REV_E1;
+	if (CHIP_IS_E1H(bp))
+		return IDLE_CHK_REV_E1H;
+	if (CHIP_IS_E2(bp))
+		return IDLE_CHK_REV_E2;
+	if (CHIP_IS_E3A0(bp))
+		return IDLE_CHK_REV_E3A0;
+	if (CHIP_IS_E3B0(bp))
+		return IDLE_CHK_REV_E3B0;
+	return -1;
+}
+
+static void bnx2x_idle_chk_build_db(int rev)
+{
+	unsigned long flags;
+	u16 st_ind, n = 0;
+
+	if (st_db_built[rev]) {
+		smp_rmb();
+		return;
+	}
+
+	spin_lock_irqsave(&st_db_lock, flags);
+	if (!st_db_built[rev]) {
+		for (st_ind = 0; st_ind < ST_DB_LINES; st_ind++)
+			if (st_database[st_ind].chip_mask & (1 << rev))
+				st_db_lines[rev][n++] = st_ind;
+
+		st_db_nlines[rev] = n;
+		smp_wmb();
+		st_db_built[rev] = true;
+	}
+	spin_unlock_irqrestore(&st_db_lock, flags);
+}
+
 /* self test procedure
- * scan auto-generated database
+ * scan the database lines applying to the chip
  * for each line:
- * 1.	compare chip mask
- * 2.	determine type (according to maro number)
- * 3.	read registers
- * 4.	call predicate
- * 5.	collate results and statistics
+ * 1.	determine type (according to maro number)
+ * 2.	read registers (whole ranges at once)
+ * 3.	call predicate over the values read
+ * 4.	collate results and statistics
  */
 int bnx2x_idle_chk(struct bnx2x *bp)
 {
 	u16 i;				/* loop counter */
 	u16 st_ind;			/* self test database access index */
+	u16 line;			/* index into the chip's line list */
+	int rev;			/* chip revision */
 	struct st_record rec;		/* current record variable */
 	char message[MAX_FAIL_MSG];	/* message to log */
+	u32 last_addr = 0, last_val = 0;/* last single register read */
+	ktime_t start = ktime_get();
 
 	/*init stats*/
 	idle_chk_errors = 0;
 	idle_chk_warnings = 0;
+	bp->idle_chk.grc_reads = 0;
+	bp->idle_chk.dmae_reads = 0;
+	bp->idle_chk.cfc_addr = 0;
+
+	/* DMAE completion is polled under a BH lock */
+	bp->idle_chk.bulk = bp->dmae_ready && !in_interrupt();
 
-	/*create masks for all chip types*/
-	is_e1	= CHIP_IS_E1(bp);
-	is_e1h	= CHIP_IS_E1H(bp);
-	is_e2	= CHIP_IS_E2(bp);
-	is_e3a0	= CHIP_IS_E3A0(bp);
-	is_e3b0	= CHIP_IS_E3B0(bp);
+	rev = bnx2x_idle_chk_rev(bp);
+	if (rev < 0)
+		return 0;
+	bnx2x_idle_chk_build_db(rev);
 
 	/*database main loop*/
-	for (st_ind = 0; st_ind < ST_DB_LINES; st_ind++) {
+	for (line = 0; line < st_db_nlines[rev]; line++) {
+		st_ind = st_db_lines[rev][line];
 		rec = st_database[st_ind];
 
-		/*check if test applies to chip*/
-		if (!((rec.chip_mask & IDLE_CHK_E1) && is_e1)		&&
-		    !((rec.chip_mask & IDLE_CHK_E1H) && is_e1h)		&&
-		    !((rec.chip_mask & IDLE_CHK_E2) && is_e2)		&&
-		    !((rec.chip_mask & IDLE_CHK_E3A0) && is_e3a0)	&&
-		    !((rec.chip_mask & IDLE_CHK_E3B0) && is_e3b0))
-			continue;
-
 		/* identify macro */
 		switch (rec.macro) {
 		case 1:
-			/* read single reg and call predicate */
-			rec.pred_args.val1 = REG_RD(bp, rec.reg1);
+			/* read single reg and call predicate; consecutive
+			 * lines often check the same register
+			 */
+			if (rec.reg1 != last_addr) {
+				last_val = REG_RD(bp, rec.reg1);
+				last_addr = rec.reg1;
+				bp->idle_chk.grc_reads++;
+			}
+			rec.pred_args.val1 = last_val;
 			DP(BNX2X_MSG_IDLE, "mac1 add %x\n", rec.reg1);
 			if (rec.predicate(&rec.pred_args)) {
 				snprintf(message, sizeof(message),
@@ -3141,13 +3266,16 @@ int bnx2x_idle_chk(struct bnx2x *bp)
 			}
 			break;
 		case 2:
-			/* read repeatedly starting from reg1 and call
-			 * predicate after each read
+			/* read the whole range starting from reg1 and call
+			 * predicate for each value
 			 */
+			if (rec.loop > IDLE_CHK_BATCH_MAX)
+				break;
+			bnx2x_idle_chk_rd(bp, rec.reg1, rec.incr, rec.loop,
+					  bp->idle_chk.batch);
+			DP(BNX2X_MSG_IDLE, "mac2 add %x\n", rec.reg1);
 			for (i = 0; i < rec.loop; i++) {
-				rec.pred_args.val1 =
-					REG_RD(bp, rec.reg1 + i * rec.incr);
-				DP(BNX2X_MSG_IDLE, "mac2 add %x\n", rec.reg1);
+				rec.pred_args.val1 = bp->idle_chk.batch[i];
 				if (rec.predicate(&rec.pred_args)) {
 					snprintf(message, sizeof(message),
 						"%s. Value is 0x%x in "
@@ -3163,6 +3291,7 @@ int bnx2x_idle_chk(struct bnx2x *bp)
 			/* read two regs and call predicate */
 			rec.pred_args.val1 = REG_RD(bp, rec.reg1);
 			rec.pred_args.val2 = REG_RD(bp, rec.reg2);
+			bp->idle_chk.grc_reads += 2;
 			DP(BNX2X_MSG_IDLE, "mac3 add1 %x add2 %x\n",
 				rec.reg1, rec.reg2);
 			if (rec.predicate(&rec.pred_args)) {
@@ -3200,6 +3329,7 @@ int bnx2x_idle_chk(struct bnx2x *bp)
 			rec.pred_args.val2 = REG_RD(bp, rec.reg2);
 			DP(BNX2X_MSG_IDLE, "mac3 add1 %x add2 %x add3 %x\n",
 				rec.reg1, rec.reg2, rec.reg3);
+			bp->idle_chk.grc_reads += 3;
 			if (REG_RD(bp, rec.reg3) != 0) {
 				if (rec.predicate(&rec.pred_args)) {
 					snprintf(message, sizeof(message),
@@ -3227,6 +3357,12 @@ int bnx2x_idle_chk(struct bnx2x *bp)
 		}
 	}
 
+	DP(BNX2X_MSG_IDLE,
+	   "%d lines, %u GRC reads, %u DMAE reads, %lld usec\n",
+	   st_db_nlines[rev], bp->idle_chk.grc_reads,
+	   bp->idle_chk.dmae_reads,
+	   (long long)ktime_to_us(ktime_sub(ktime_get(), start)));
+
 	/* abort if interface is not running */
 	if (!netif_running(bp->dev))
 		return idle_chk_errors;
@@ -1208,6 +1208,10 @@ static void bnx2x_drv_stats_update(struct bnx2x *bp)
 		UPDATE_ESTAT_QSTAT(rx_skb_alloc_failed);
 		UPDATE_ESTAT_QSTAT(hw_csum_err);
 		UPDATE_ESTAT_QSTAT(driver_filtered_tx_pkt);
+		UPDATE_ESTAT_QSTAT(tx_bounce_pkts);
+		UPDATE_ESTAT_QSTAT_64(tx_bounce_bytes);
+		UPDATE_ESTAT_QSTAT(tx_lin_pkts);
+		UPDATE_ESTAT_QSTAT_64(tx_lin_bytes);
 	}
 }
 
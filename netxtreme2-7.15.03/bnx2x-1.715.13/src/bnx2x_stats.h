@@ -214,6 +214,14 @@ struct bnx2x_eth_stats {
 
 	/* Tx timestamps skipped */
 	u32 ptp_skip_txts;
+
+	/* Tx fetch window violations */
+	u32 tx_bounce_pkts;
+	u32 tx_bounce_bytes_hi;
+	u32 tx_bounce_bytes_lo;
+	u32 tx_lin_pkts;
+	u32 tx_lin_bytes_hi;
+	u32 tx_lin_bytes_lo;
 };
 
 struct bnx2x_eth_q_stats {
@@ -273,6 +281,16 @@ struct bnx2x_eth_q_stats {
 	u32 total_tpa_bytes_hi;
 	u32 total_tpa_bytes_lo;
 	u32 driver_filtered_tx_pkt;
+
+	/* Tx fetch window violations: frags copied to the bounce area vs
+	 * whole skb linearized
+	 */
+	u32 tx_bounce_pkts;
+	u32 tx_bounce_bytes_hi;
+	u32 tx_bounce_bytes_lo;
+	u32 tx_lin_pkts;
+	u32 tx_lin_bytes_hi;
+	u32 tx_lin_bytes_lo;
 };
 
 struct bnx2x_eth_stats_old {
@@ -325,6 +343,12 @@ struct bnx2x_eth_q_stats_old {
 	u32 rx_skb_alloc_failed_old;
 	u32 hw_csum_err_old;
 	u32 driver_filtered_tx_pkt_old;
+	u32 tx_bounce_pkts_old;
+	u32 tx_bounce_bytes_hi_old;
+	u32 tx_bounce_bytes_lo_old;
+	u32 tx_lin_pkts_old;
+	u32 tx_lin_bytes_hi_old;
+	u32 tx_lin_bytes_lo_old;
 };
 
 struct bnx2x_net_stats_old {